@@ -1,11 +1,19 @@
 @echo off
 setlocal
 
+:: Usage: compile.bat <generated dir>, the directory the build writes vertex_layouts.glsl and
+:: vertex_layouts.txt into (<build dir>\generated). Run by the build, so it never waits for a key.
+
 :: Check if VULKAN_SDK environment variable is set
 if "%VULKAN_SDK%"=="" (
     echo [ERROR] VULKAN_SDK environment variable is not set!
     echo Please set it to the Vulkan SDK installation path.
-    pause
+    exit /b 1
+)
+
+set GENERATED_DIR=%~1
+if not exist "%GENERATED_DIR%\vertex_layouts.txt" (
+    echo [ERROR] vertex_layouts.txt not found, pass the generated directory of a build.
     exit /b 1
 )
 
@@ -16,7 +24,14 @@ set GLSLC="%VULKAN_SDK%\Bin\glslc.exe"
 set SCRIPT_DIR=%~dp0
 
 :: Compile shaders
-%GLSLC% "%SCRIPT_DIR%shader.vert" -o "%SCRIPT_DIR%vert.spv"
+:: One vertex shader per layout of src/VertexLayout.h, listed as "<define> <name>" lines
+for /f "usebackq tokens=1,2" %%A in ("%GENERATED_DIR%\vertex_layouts.txt") do (
+    %GLSLC% -I "%GENERATED_DIR%" -D%%A "%SCRIPT_DIR%shader.vert" -o "%SCRIPT_DIR%vert_%%B.spv"
+)
 %GLSLC% "%SCRIPT_DIR%shader.frag" -o "%SCRIPT_DIR%frag.spv"
-
-pause
+%GLSLC% "%SCRIPT_DIR%cull.comp" -o "%SCRIPT_DIR%cull.spv"
+%GLSLC% -DOCCLUSION_CULLING "%SCRIPT_DIR%cull.comp" -o "%SCRIPT_DIR%cull_occlusion.spv"
+:: Depth pyramid: from a single sampled or multisampled depth attachment, and between levels
+%GLSLC% -DDEPTH_SOURCE "%SCRIPT_DIR%depth_pyramid.comp" -o "%SCRIPT_DIR%depth_pyramid_depth.spv"
+%GLSLC% -DDEPTH_SOURCE -DMULTISAMPLED "%SCRIPT_DIR%depth_pyramid.comp" -o "%SCRIPT_DIR%depth_pyramid_depth_ms.spv"
+%GLSLC% "%SCRIPT_DIR%depth_pyramid.comp" -o "%SCRIPT_DIR%depth_pyramid_reduce.spv"
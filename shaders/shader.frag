@@ -1,12 +1,31 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Every texture of the scene, texture 0 is the --texture image; only the first ones are written
+layout(binding = 1) uniform sampler2D textures[];
 
-layout(location = 0) in vec3 fragColor;
+// MaterialData in main.cpp
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+struct Material {
+    vec4 baseColor;
+    uint textureIndex;
+};
+
+layout(std430, binding = 4) readonly buffer MaterialBuffer {
+    Material materials[];
+};
+
+layout(location = 0) in vec3 fragNormal;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
-}
\ No newline at end of file
+    // one draw may cover faces of several materials, so the index is not uniform
+    Material material = materials[fragMaterial];
+    outColor = material.baseColor;
+    if (material.textureIndex != NO_TEXTURE)
+        outColor *= texture(textures[nonuniformEXT(material.textureIndex)], fragTexCoord);
+}
@@ -1,20 +1,91 @@
 #version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Compiled once per vertex layout with -DVERTEX_FORMAT_<NAME>, see compile.bat; the build generates
+// vertex_layouts.glsl into its own directory
+#include "vertex_layouts.glsl"
 
 layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
+    mat4 viewProj; // proj * view, multiplied once on the CPU
+    vec4 positionOffset;
+    vec4 positionScale;
 } ubo;
 
-layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inTexCoord;
+// --draw-data, see DrawDataMode in AppConfig.h; the branches not taken are removed when the pipeline is created
+layout(constant_id = 0) const int DRAW_DATA_MODE = 0;
+const int DRAW_DATA_STORAGE = 0;
+const int DRAW_DATA_PUSH_CONSTANTS = 1;
+const int DRAW_DATA_DYNAMIC_UNIFORM = 2;
+
+// DrawData in main.cpp: the full transform of one draw and the object it draws
+layout(push_constant) uniform PushConstants {
+    mat4 mvp;
+    uint objectIndex;
+} pushData;
+
+layout(binding = 3) uniform DrawData {
+    mat4 mvp;
+    uint objectIndex;
+} drawData;
+
+// per object data, see ObjectData in main.cpp. Every draw starts at its object's index as first instance,
+// instanced draws cover consecutive objects.
+struct ObjectData {
+    mat4 model;
+};
+
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+// Vertex::material of every vertex, two 16-bit indices per uint, see PackedMesh::vertexMaterials.
+// Without materials the buffer is a placeholder and every vertex has material 0.
+layout(constant_id = 1) const bool HAS_VERTEX_MATERIALS = false;
+
+layout(std430, binding = 5) readonly buffer VertexMaterialBuffer {
+    uint vertexMaterials[];
+};
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) out vec3 fragNormal;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterial;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.xy += vec2(normal.x >= 0.0 ? -fold : fold, normal.y >= 0.0 ? -fold : fold);
+    return normalize(normal);
+}
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
+    // identity offset/scale for float positions
+    vec3 position = ubo.positionOffset.xyz + ubo.positionScale.xyz * inPosition.xyz;
+    // ubo.model is the spin all objects share. Only matrix-vector products per vertex, the matrices
+    // themselves are multiplied on the CPU.
+    uint objectIndex = gl_InstanceIndex;
+    if (DRAW_DATA_MODE == DRAW_DATA_PUSH_CONSTANTS) {
+        objectIndex = pushData.objectIndex;
+        gl_Position = pushData.mvp * vec4(position, 1.0);
+    }
+    else if (DRAW_DATA_MODE == DRAW_DATA_DYNAMIC_UNIFORM) {
+        objectIndex = drawData.objectIndex;
+        gl_Position = drawData.mvp * vec4(position, 1.0);
+    }
+    else {
+        gl_Position = ubo.viewProj * (objects[objectIndex].model * (ubo.model * vec4(position, 1.0)));
+    }
+
+#if defined(VERTEX_NORMAL_OCTAHEDRAL)
+    vec3 normal = decodeOctahedral(inNormal.xy);
+#elif defined(VERTEX_HAS_NORMAL)
+    vec3 normal = inNormal.xyz;
+#else
+    vec3 normal = vec3(0.0, 0.0, 1.0);
+#endif
+    fragNormal = mat3(objects[objectIndex].model) * (mat3(ubo.model) * normal);
     fragTexCoord = inTexCoord;
-}
\ No newline at end of file
+    fragMaterial = HAS_VERTEX_MATERIALS ? (vertexMaterials[gl_VertexIndex >> 1] >> ((gl_VertexIndex & 1) * 16)) & 0xFFFFu : 0u;
+}
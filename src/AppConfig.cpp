@@ -0,0 +1,278 @@
+#include "AppConfig.h"
+
+#include <algorithm>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+namespace {
+    uint32_t parseUnsigned(const std::string& option, const std::string& value)
+    {
+        try {
+            size_t parsed{};
+            unsigned long result = std::stoul(value, &parsed);
+            if (parsed != value.size())
+                throw std::invalid_argument(value);
+
+            return static_cast<uint32_t>(result);
+        }
+        catch (const std::exception&) {
+            throw std::invalid_argument("invalid value for " + option + ": " + value);
+        }
+    }
+
+    float parseFloat(const std::string& option, const std::string& value)
+    {
+        try {
+            size_t parsed{};
+            float result = std::stof(value, &parsed);
+            if (parsed != value.size() || !(result >= 0.0f))
+                throw std::invalid_argument(value);
+
+            return result;
+        }
+        catch (const std::exception&) {
+            throw std::invalid_argument("invalid value for " + option + ": " + value);
+        }
+    }
+
+    VertexFormat parseVertexFormat(const std::string& option, const std::string& value)
+    {
+        std::optional<VertexFormat> format{};
+        forEachVertexLayout([&](auto layout) {
+            if (value == decltype(layout)::name)
+                format = decltype(layout)::format;
+        });
+
+        if (!format)
+            throw std::invalid_argument("invalid value for " + option + ": " + value);
+
+        return *format;
+    }
+
+    // "auto" picks the best supported KTX2 file, "rgba8" always decodes the source image
+    void parseTextureFormat(const std::string& option, const std::string& value, AppConfig& config)
+    {
+        config.compressedTextures = value != "rgba8";
+        config.textureCompression = std::nullopt;
+        if (value == "auto" || value == "rgba8")
+            return;
+
+        config.textureCompression = findTextureCompression(value);
+        if (!config.textureCompression)
+            throw std::invalid_argument("invalid value for " + option + ": " + value);
+    }
+
+    MipFilter parseMipFilter(const std::string& option, const std::string& value)
+    {
+        std::optional<MipFilter> filter = findMipFilter(value);
+        if (!filter)
+            throw std::invalid_argument("invalid value for " + option + ": " + value);
+
+        return *filter;
+    }
+
+    DrawDataMode parseDrawDataMode(const std::string& option, const std::string& value)
+    {
+        for (DrawDataMode mode : { DrawDataMode::Storage, DrawDataMode::PushConstants, DrawDataMode::DynamicUniform })
+            if (value == getDrawDataModeName(mode))
+                return mode;
+
+        throw std::invalid_argument("invalid value for " + option + ": " + value);
+    }
+
+    PresentMode parsePresentMode(const std::string& option, const std::string& value)
+    {
+        for (PresentMode mode : { PresentMode::Auto, PresentMode::Fifo, PresentMode::FifoRelaxed, PresentMode::Mailbox, PresentMode::Immediate })
+            if (value == getPresentModeName(mode))
+                return mode;
+
+        throw std::invalid_argument("invalid value for " + option + ": " + value);
+    }
+}
+
+const char* getDrawDataModeName(DrawDataMode mode)
+{
+    switch (mode) {
+    case DrawDataMode::PushConstants:
+        return "push";
+    case DrawDataMode::DynamicUniform:
+        return "dynamic";
+    default:
+        return "storage";
+    }
+}
+
+const char* getPresentModeName(PresentMode mode)
+{
+    switch (mode) {
+    case PresentMode::Fifo:
+        return "fifo";
+    case PresentMode::FifoRelaxed:
+        return "fifo-relaxed";
+    case PresentMode::Mailbox:
+        return "mailbox";
+    case PresentMode::Immediate:
+        return "immediate";
+    default:
+        return "auto";
+    }
+}
+
+AppConfig parseCommandLine(int argc, char** argv)
+{
+    AppConfig config{};
+
+    for (int idx = 1; idx < argc; idx++)
+    {
+        const std::string option = argv[idx];
+
+        // fetch the value that follows an option
+        auto nextValue = [&]() -> std::string {
+            if (idx + 1 >= argc)
+                throw std::invalid_argument("missing value for " + option);
+            return argv[++idx];
+        };
+
+        if (option == "--model")
+            config.modelPath = nextValue();
+        else if (option == "--texture")
+            config.texturePath = nextValue();
+        else if (option == "--no-mesh-cache")
+            config.useMeshCache = false;
+        else if (option == "--no-mesh-optimize")
+            config.optimizeMeshes = false;
+        else if (option == "--no-mesh-lods")
+            config.meshLods = false;
+        else if (option == "--lod-error")
+            config.lodErrorPixels = parseFloat(option, nextValue());
+        else if (option == "--vertex-format")
+            config.vertexFormat = parseVertexFormat(option, nextValue());
+        else if (option == "--texture-format")
+            parseTextureFormat(option, nextValue(), config);
+        else if (option == "--cpu-mips")
+            config.cpuMipGeneration = true;
+        else if (option == "--mip-filter")
+            config.mipFilter = parseMipFilter(option, nextValue());
+        else if (option == "--staging-size")
+            config.stagingBufferMiB = std::max(parseUnsigned(option, nextValue()), 1u);
+        else if (option == "--defragment")
+            config.defragmentMemory = true;
+        else if (option == "--pipeline-cache")
+            config.pipelineCachePath = nextValue();
+        else if (option == "--no-pipeline-cache")
+            config.pipelineCachePath.clear();
+        else if (option == "--objects")
+            config.objectCount = std::max(parseUnsigned(option, nextValue()), 1u);
+        else if (option == "--instanced")
+            config.instancing = true;
+        else if (option == "--gpu-culling")
+            config.gpuCulling = true;
+        else if (option == "--occlusion-culling") {
+            config.gpuCulling = true;
+            config.occlusionCulling = true;
+        }
+        else if (option == "--stress") {
+            config.objectCount = STRESS_OBJECT_COUNT;
+            config.instancing = true;
+        }
+        else if (option == "--draw-data")
+            config.drawData = parseDrawDataMode(option, nextValue());
+        else if (option == "--no-draw-sort")
+            config.sortDraws = false;
+        else if (option == "--record-threads")
+            config.recordThreads = std::max(parseUnsigned(option, nextValue()), 1u);
+        else if (option == "--frames-in-flight") {
+            const std::string value = nextValue();
+            config.framesInFlight = parseUnsigned(option, value);
+            if (config.framesInFlight < 1 || config.framesInFlight > MAX_FRAMES_IN_FLIGHT)
+                throw std::invalid_argument("invalid value for " + option + ": " + value);
+        }
+        else if (option == "--present-mode")
+            config.presentMode = parsePresentMode(option, nextValue());
+        else if (option == "--low-latency")
+            config.lowLatency = true;
+        else if (option == "--headless")
+            config.headless = true;
+        else if (option == "--frames")
+            config.frameCount = parseUnsigned(option, nextValue());
+        else if (option == "--screenshot")
+            config.screenshotPath = nextValue();
+        else if (option == "--frame-bench")
+            config.frameBenchmarkPath = nextValue();
+        else if (option == "--warmup")
+            config.warmupFrames = parseUnsigned(option, nextValue());
+        else if (option == "--trace")
+            config.tracePath = nextValue();
+        else if (option == "--pipeline-stats")
+            config.pipelineStatistics = true;
+        else if (option == "--serial-init")
+            config.serialInit = true;
+        else if (option == "--threads")
+            config.workerThreads = parseUnsigned(option, nextValue());
+        else if (option == "--bench")
+            config.benchmark = nextValue();
+        else if (option == "--iterations")
+            config.benchmarkIterations = parseUnsigned(option, nextValue());
+        else
+            throw std::invalid_argument("unknown option: " + option);
+    }
+
+    // only the offscreen images can be copied from, swapchain images are presentation only
+    if (!config.screenshotPath.empty() && !config.headless)
+        throw std::invalid_argument("--screenshot requires --headless");
+
+    return config;
+}
+
+void printUsage()
+{
+    std::cerr <<
+        "Options:\n"
+        "  --model <path>        OBJ file to load\n"
+        "  --texture <path>      texture to load\n"
+        "  --no-mesh-cache       always parse the OBJ instead of using the binary mesh cache\n"
+        "  --no-mesh-optimize    keep the OBJ triangle and vertex order\n"
+        "  --no-mesh-lods        always draw the full resolution mesh\n"
+        "  --lod-error <px>      largest screen space error a LOD may introduce, in pixels\n"
+        "  --vertex-format <f>   vertex buffer layout (float, packed, packed-half-uv, packed-normals)\n"
+        "  --texture-format <f>  texture upload format (auto, rgba8, bc7, astc, etc2, bc3, bc1)\n"
+        "  --cpu-mips            generate mips of uncompressed textures on the CPU instead of by blitting\n"
+        "  --mip-filter <f>      CPU mip filter (box, kaiser)\n"
+        "  --staging-size <MiB>  size of the staging ring buffer used for uploads (default 16)\n"
+        "  --defragment          compact the geometry memory pool after loading\n"
+        "  --pipeline-cache <p>  pipeline cache file (default ./pipeline_cache.bin)\n"
+        "  --no-pipeline-cache   compile pipelines without a cache, for cold start measurements\n"
+        "  --objects <n>         copies of the model to draw on a grid (default 1)\n"
+        "  --instanced           draw all objects with a single instanced draw\n"
+        "  --gpu-culling         frustum cull and pick LODs on the GPU, draw everything with one indirect draw\n"
+        "  --occlusion-culling   --gpu-culling plus culling against a depth pyramid of the previous frame's\n"
+        "                        visible objects, drawn in two phases\n"
+        "  --stress              stress scene: 100000 objects, instanced\n"
+        "  --draw-data <mode>    per draw transform without --instanced or --gpu-culling: storage (object\n"
+        "                        buffer), push (CPU computed MVP in push constants), dynamic (uniform\n"
+        "                        buffer ring with a dynamic offset per draw)\n"
+        "  --no-draw-sort        draw the objects in order instead of sorted front to back\n"
+        "  --record-threads <n>  record the draws in n slices of secondary command buffers on the\n"
+        "                        worker pool (1 = inline on the main thread)\n"
+        "  --frames-in-flight <n>\n"
+        "                        frames recorded ahead of the GPU, 1 to 4 (default 2)\n"
+        "  --present-mode <m>    auto (mailbox if available, else fifo), fifo, fifo-relaxed, mailbox,\n"
+        "                        immediate; unsupported modes fall back to fifo\n"
+        "  --low-latency         poll input and update the frame only once the previous one was presented\n"
+        "  --headless            render offscreen without a window or swapchain\n"
+        "  --frames <n>          frames to render before exiting (0 = until closed, default 1000 when\n"
+        "                        headless or measured)\n"
+        "  --screenshot <path>   write the last headless frame to a PNG file\n"
+        "  --frame-bench <path>  measure frame times on a fixed camera path, write a JSON report (- = stdout)\n"
+        "  --warmup <n>          frames rendered before --frame-bench starts measuring (default 100)\n"
+        "  --trace <path>        write CPU and GPU timings as a Chrome trace (chrome://tracing, Perfetto)\n"
+        "  --pipeline-stats      report vertex shader invocations per triangle and fragment shader invocations\n"
+        "                        per frame measured on the GPU\n"
+        "  --serial-init         run the startup steps one after another, to compare time to first frame\n"
+        "  --threads <n>         worker threads for asset processing (0 = all cores)\n"
+        "  --bench <name>        run an offline benchmark and exit (mesh-load, weld, vcache,\n"
+        "                        vertex-format, lod, texture, mips, transforms,\n"
+        "                        drawlist)\n"
+        "  --iterations <n>      repetitions per benchmark measurement\n";
+}
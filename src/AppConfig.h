@@ -0,0 +1,145 @@
+#pragma once
+
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include "VertexLayout.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+const std::string MODEL_PATH = "./models/viking_room.obj";
+const std::string TEXTURE_PATH = "./textures/viking_room.png";
+const std::string PIPELINE_CACHE_PATH = "./pipeline_cache.bin";
+
+// Frames rendered by runs that have to end on their own (headless, --frame-bench) unless --frames is given
+const uint32_t DEFAULT_FRAME_COUNT = 1000;
+
+// Objects in the --stress scene
+const uint32_t STRESS_OBJECT_COUNT = 100000;
+
+// Upper bound of --frames-in-flight
+const uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+// Where the vertex shader finds the transform of a draw of one object (--draw-data)
+enum class DrawDataMode {
+    Storage = 0,        // object index = gl_InstanceIndex, model matrix from the object storage buffer
+    PushConstants = 1,  // MVP computed on the CPU and the object index as push constants
+    DynamicUniform = 2, // the same written to a persistently mapped ring, bound with a dynamic offset per draw
+};
+
+const char* getDrawDataModeName(DrawDataMode mode);
+
+// Swapchain present mode (--present-mode), Auto = MAILBOX where the surface supports it, else FIFO
+enum class PresentMode {
+    Auto = 0,
+    Fifo = 1,        // waits for vertical blank, never tears
+    FifoRelaxed = 2, // FIFO, but a late frame is shown right away and may tear
+    Mailbox = 3,     // the newest frame replaces the queued one, never tears
+    Immediate = 4,   // shown right away, tears
+};
+
+const char* getPresentModeName(PresentMode mode);
+
+// Runtime settings, filled in from the command line
+struct AppConfig {
+    std::string modelPath{ MODEL_PATH };
+    std::string texturePath{ TEXTURE_PATH };
+
+    // Load meshes from the binary mesh cache instead of parsing the OBJ every launch
+    bool useMeshCache{ true };
+
+    // Reorder meshes for vertex cache, overdraw and vertex fetch efficiency after loading
+    bool optimizeMeshes{ true };
+
+    // Build a chain of simplified LODs and draw the coarsest one whose error stays below lodErrorPixels
+    bool meshLods{ true };
+    float lodErrorPixels{ 1.0f };
+
+    // Vertex buffer layout, see VertexLayout.h
+    VertexFormat vertexFormat{ VertexFormat::Packed };
+
+    // Load block compressed KTX2 textures written by TextureConverter before falling back to stb_image.
+    // textureCompression restricts the choice to one format, otherwise the first one the device supports wins.
+    bool compressedTextures{ true };
+    std::optional<TextureCompression> textureCompression{};
+
+    // Build the mip chain of uncompressed textures on the CPU instead of with linear blits on the GPU.
+    // Also used whenever the texture format does not support linear blits.
+    bool cpuMipGeneration{ false };
+    MipFilter mipFilter{ MipFilter::Kaiser };
+
+    // Size of the persistently mapped staging ring all uploads go through; larger uploads are split
+    uint32_t stagingBufferMiB{ 16 };
+
+    // Compact the vertex and index buffer memory pool after loading, see defragmentGeometry()
+    bool defragmentMemory{ false };
+
+    // File the VkPipelineCache is loaded from and saved to, empty = compile every pipeline from scratch
+    std::string pipelineCachePath{ PIPELINE_CACHE_PATH };
+
+    // Copies of the model drawn on a grid, one draw each unless instanced
+    uint32_t objectCount{ 1 };
+    // Draw all objects (or all of a --record-threads slice) with one instanced draw, reading the
+    // per-object data from a storage buffer by gl_InstanceIndex
+    bool instancing{ false };
+    // Cull against the view frustum and pick LODs in a compute pass that writes indirect draws, see GpuCulling.h.
+    // Replaces --instanced and --record-threads, the whole frame is one indirect draw.
+    bool gpuCulling{ false };
+    // On top of gpuCulling: cull objects hidden behind what was visible in the previous frame against a
+    // depth pyramid and draw the frame in two phases, see GpuCulling.h and DepthPyramid.h
+    bool occlusionCulling{ false };
+
+    // Per draw transform of the one-draw-per-object path; instanced and GPU culled draws always use Storage
+    DrawDataMode drawData{ DrawDataMode::Storage };
+    // Sort the draws of the one-draw-per-object path by LOD and depth, front to back (see DrawList.h);
+    // false draws them in object order, to compare overdraw with --pipeline-stats
+    bool sortDraws{ true };
+
+    // Slices of the draw list recorded in parallel into secondary command buffers on the worker pool,
+    // each with its own command pool per frame in flight; 1 = record everything inline on the main thread
+    uint32_t recordThreads{ 1 };
+
+    // Frames the CPU may record ahead of the GPU, 1 to MAX_FRAMES_IN_FLIGHT, each with its own command
+    // buffers, uniform buffers and sync objects
+    uint32_t framesInFlight{ 2 };
+    // Present mode of the swapchain; one the surface does not support falls back to FIFO
+    PresentMode presentMode{ PresentMode::Auto };
+    // Poll input and update the uniforms only once the previous frame was presented (VK_KHR_present_wait,
+    // or once its GPU work finished without it), so the frame shows input as recent as possible
+    bool lowLatency{ false };
+
+    // Render into offscreen images without a window, surface or swapchain, for benchmarking
+    bool headless{ false };
+    // Frames to render before exiting, 0 = until the window is closed (headless: DEFAULT_FRAME_COUNT)
+    uint32_t frameCount{ 0 };
+    // Headless only: write the last rendered frame to this PNG file before exiting
+    std::string screenshotPath{};
+
+    // Measure frame times along a fixed camera path and write percentiles and hitches as JSON to this
+    // file ("-" = stdout). frameCount frames are measured after warmupFrames frames that are discarded.
+    std::string frameBenchmarkPath{};
+    uint32_t warmupFrames{ 100 };
+
+    // Write CPU scopes and GPU timestamps of startup and every frame to this Chrome trace file
+    std::string tracePath{};
+
+    // Count vertex and fragment shader invocations per frame with a pipeline statistics query
+    bool pipelineStatistics{ false };
+
+    // Run every startup step in order on the main thread instead of overlapping asset loading,
+    // pipeline compilation and device setup, to measure what the overlap gains
+    bool serialInit{ false };
+
+    // Threads used for CPU side asset processing, 0 = one per hardware thread
+    uint32_t workerThreads{ 0 };
+
+    // Name of an offline benchmark to run instead of the renderer (see Benchmark.h)
+    std::string benchmark{};
+    uint32_t benchmarkIterations{ 5 };
+};
+
+// Throws std::invalid_argument on unknown or malformed options
+AppConfig parseCommandLine(int argc, char** argv);
+
+void printUsage();
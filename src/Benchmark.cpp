@@ -0,0 +1,570 @@
+#include "Benchmark.h"
+
+#include "DrawList.h"
+#include "Ktx2Texture.h"
+#include "MeshCache.h"
+#include "MeshLoader.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MipGenerator.h"
+#include "SceneGraph.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/hash.hpp>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct Timing {
+        double minMs{};
+        double avgMs{};
+    };
+
+    // Runs fn the given number of times and returns the fastest and average duration
+    Timing measure(uint32_t iterations, const std::function<void()>& fn)
+    {
+        Timing timing{};
+        timing.minMs = std::numeric_limits<double>::max();
+
+        for (uint32_t idx{}; idx < std::max(iterations, 1u); idx++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            fn();
+            auto end = std::chrono::high_resolution_clock::now();
+
+            double ms = std::chrono::duration<double, std::milli>(end - start).count();
+            timing.minMs = std::min(timing.minMs, ms);
+            timing.avgMs += ms;
+        }
+
+        timing.avgMs /= std::max(iterations, 1u);
+        return timing;
+    }
+
+    void printTiming(const std::string& label, const Timing& timing)
+    {
+        std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << timing.minMs << " ms min" << std::setw(12) << timing.avgMs << " ms avg\n";
+    }
+
+    // Compares parsing the OBJ against mapping the binary mesh cache.
+    // Both paths end with the vertex/index data copied into a staging-sized buffer.
+    void benchmarkMeshLoad(const AppConfig& config)
+    {
+        std::vector<std::byte> staging{};
+        auto copyToStaging = [&](const void* vertexData, size_t vertexBytes, const void* indexData, size_t indexBytes) {
+            staging.resize(vertexBytes + indexBytes);
+            memcpy(staging.data(), vertexData, vertexBytes);
+            memcpy(staging.data() + vertexBytes, indexData, indexBytes);
+        };
+
+        ThreadPool threadPool{ config.workerThreads };
+
+        PackedMesh packed{};
+        Timing objTiming = measure(config.benchmarkIterations, [&]() {
+            MeshData mesh = loadObjMesh(config.modelPath, &threadPool, hasVertexNormals(config.vertexFormat));
+            packed = packMesh(mesh, config.vertexFormat, &threadPool);
+            copyToStaging(packed.vertexData.data(), packed.vertexData.size(), packed.indexData.data(), packed.indexData.size());
+        });
+
+        const std::string cachePath = MeshCache::getCachePath(config.modelPath);
+        Timing writeTiming = measure(1, [&]() {
+            MeshCache::write(cachePath, config.modelPath, packed, config.vertexFormat, 0);
+        });
+
+        Timing cacheTiming = measure(config.benchmarkIterations, [&]() {
+            MeshCache cache{};
+            if (!cache.open(cachePath, config.modelPath, config.vertexFormat, 0))
+                throw std::runtime_error("freshly written mesh cache failed validation!");
+
+            copyToStaging(cache.getVertexData().data(), cache.getVertexData().size_bytes(), cache.getIndexData().data(), cache.getIndexData().size_bytes());
+        });
+
+        std::cout << "mesh-load: " << config.modelPath << " (" << packed.vertexCount << " vertices, "
+            << packed.indexCount << " indices, " << config.benchmarkIterations << " iterations)\n";
+        printTiming("OBJ parse + dedup + pack", objTiming);
+        printTiming("cache write", writeTiming);
+        printTiming("cache map + copy", cacheTiming);
+        std::cout << "  speedup: " << std::setprecision(1) << objTiming.avgMs / std::max(cacheTiming.avgMs, 1e-6) << "x\n";
+    }
+
+    // The XOR/shift hash Vertex used to have, kept as the baseline for the weld benchmark
+    struct LegacyVertexHash {
+        size_t operator()(Vertex const& vertex) const {
+            return ((std::hash<glm::vec3>()(vertex.pos) ^
+                (std::hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^
+                (std::hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+
+    MeshData weldLegacy(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes)
+    {
+        MeshData mesh{};
+        std::unordered_map<Vertex, uint32_t, LegacyVertexHash> uniqueVertices{};
+
+        for (const auto& shape : shapes) {
+            for (const auto& index : shape.mesh.indices) {
+                Vertex vertex{};
+                vertex.pos = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2] };
+                vertex.texCoord = { attrib.texcoords[2 * index.texcoord_index + 0], 1.0f - attrib.texcoords[2 * index.texcoord_index + 1] };
+
+                if (uniqueVertices.count(vertex) == 0) {
+                    uniqueVertices[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+                    mesh.vertices.push_back(vertex);
+                }
+
+                mesh.indices.push_back(uniqueVertices[vertex]);
+            }
+        }
+
+        return mesh;
+    }
+
+    bool isSameMesh(const MeshData& a, const MeshData& b)
+    {
+        return a.indices == b.indices && a.vertices == b.vertices;
+    }
+
+    // Vertex welding only (the OBJ is parsed once up front): the old unordered_map loop,
+    // the serial open-addressing table and the parallel path at increasing thread counts
+    void benchmarkWeld(const AppConfig& config)
+    {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, config.modelPath.c_str()))
+            throw std::runtime_error(warn + err);
+
+        // same as the renderer's default, the legacy loop never read normals
+        attrib.normals.clear();
+
+        MeshData reference{};
+        Timing legacyTiming = measure(config.benchmarkIterations, [&]() { reference = weldLegacy(attrib, shapes); });
+
+        std::cout << "weld: " << config.modelPath << " (" << reference.indices.size() << " corners -> "
+            << reference.vertices.size() << " vertices, " << config.benchmarkIterations << " iterations)\n";
+        printTiming("unordered_map (legacy)", legacyTiming);
+
+        MeshData mesh{};
+        Timing serialTiming = measure(config.benchmarkIterations, [&]() { mesh = weldObjMesh(attrib, shapes, nullptr); });
+        printTiming("weld table, serial", serialTiming);
+        if (!isSameMesh(mesh, reference))
+            throw std::runtime_error("serial weld output differs from the legacy path!");
+
+        const uint32_t maxThreads = config.workerThreads != 0 ? config.workerThreads : std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t threadCount = 2; threadCount < maxThreads * 2; threadCount *= 2)
+        {
+            ThreadPool threadPool{ std::min(threadCount, maxThreads) };
+
+            Timing parallelTiming = measure(config.benchmarkIterations, [&]() { mesh = weldObjMesh(attrib, shapes, &threadPool); });
+            printTiming("weld table, " + std::to_string(threadPool.getThreadCount()) + " threads", parallelTiming);
+            std::cout << "    scaling vs serial: " << std::setprecision(2) << serialTiming.avgMs / std::max(parallelTiming.avgMs, 1e-6) << "x\n";
+
+            if (!isSameMesh(mesh, reference))
+                throw std::runtime_error("parallel weld output differs from the serial path!");
+        }
+    }
+
+    void printCacheStats(const std::string& label, const MeshData& mesh)
+    {
+        VertexCacheStats fifo16 = analyzeVertexCache(mesh.indices, mesh.vertices.size(), 16);
+        VertexCacheStats fifo32 = analyzeVertexCache(mesh.indices, mesh.vertices.size(), 32);
+
+        std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << fifo16.acmr << std::setw(10) << fifo16.atvr
+            << std::setw(10) << fifo32.acmr << std::setw(10) << fifo32.atvr << "\n";
+    }
+
+    // Simulated post-transform cache efficiency (FIFO, 16 and 32 entries) after each
+    // optimizeMesh() stage, plus the time each stage takes
+    void benchmarkVertexCache(const AppConfig& config)
+    {
+        const MeshData source = loadObjMesh(config.modelPath);
+
+        std::cout << "vcache: " << config.modelPath << " (" << source.vertices.size() << " vertices, "
+            << source.indices.size() / 3 << " triangles)\n";
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right
+            << std::setw(10) << "ACMR/16" << std::setw(10) << "ATVR/16" << std::setw(10) << "ACMR/32" << std::setw(10) << "ATVR/32" << "\n";
+
+        MeshData mesh = source;
+        printCacheStats("original", mesh);
+
+        Timing cacheTiming = measure(config.benchmarkIterations, [&]() {
+            mesh.indices = source.indices;
+            optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        });
+        printCacheStats("vertex cache", mesh);
+
+        const std::vector<uint32_t> cacheOptimized = mesh.indices;
+        Timing overdrawTiming = measure(config.benchmarkIterations, [&]() {
+            mesh.indices = cacheOptimized;
+            optimizeOverdraw(mesh.indices, mesh.vertices);
+        });
+        printCacheStats("+ overdraw", mesh);
+
+        const MeshData overdrawOptimized = mesh;
+        Timing fetchTiming = measure(config.benchmarkIterations, [&]() {
+            mesh = overdrawOptimized;
+            optimizeVertexFetch(mesh.vertices, mesh.indices);
+        });
+        printCacheStats("+ vertex fetch", mesh);
+
+        std::cout << "\n";
+        printTiming("vertex cache", cacheTiming);
+        printTiming("overdraw", overdrawTiming);
+        printTiming("vertex fetch", fetchTiming);
+
+        const VkIndexType indexType = selectIndexType(mesh.vertices.size());
+        std::cout << "  index buffer: " << source.indices.size() * sizeof(uint32_t) << " -> "
+            << source.indices.size() * getIndexSize(indexType) << " bytes ("
+            << (indexType == VK_INDEX_TYPE_UINT16 ? "16" : "32") << "-bit indices)\n";
+    }
+
+    // Vertex buffer size and estimated fetch traffic of every vertex layout on the optimized mesh.
+    // Each vertex shader invocation (FIFO cache miss, 32 entries) fetches one whole vertex.
+    void benchmarkVertexFormats(const AppConfig& config)
+    {
+        // pos, color and texCoord as floats, the layout the renderer used to upload
+        constexpr uint32_t LEGACY_STRIDE = 32;
+
+        ThreadPool threadPool{ config.workerThreads };
+
+        MeshData mesh = loadObjMesh(config.modelPath, &threadPool);
+        optimizeMesh(mesh);
+        MeshData meshWithNormals = loadObjMesh(config.modelPath, &threadPool, true);
+        optimizeMesh(meshWithNormals);
+
+        auto printRow = [](const std::string& label, uint32_t stride, uint64_t bufferBytes, uint64_t fetchBytes, uint64_t legacyFetchBytes) {
+            std::cout << "  " << std::left << std::setw(28) << label << std::right << std::setw(6) << stride
+                << std::fixed << std::setprecision(1) << std::setw(14) << bufferBytes / 1024.0 << std::setw(14) << fetchBytes / 1024.0
+                << std::setw(9) << 100.0 * (1.0 - static_cast<double>(fetchBytes) / static_cast<double>(legacyFetchBytes)) << "%\n";
+        };
+
+        const VertexCacheStats stats = analyzeVertexCache(mesh.indices, mesh.vertices.size(), 32);
+        const uint64_t legacyFetchBytes = uint64_t{ stats.transformCount } * LEGACY_STRIDE;
+
+        std::cout << "vertex-format: " << config.modelPath << " (" << mesh.vertices.size() << " vertices, "
+            << meshWithNormals.vertices.size() << " with normals, " << mesh.indices.size() / 3 << " triangles)\n";
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(6) << "B/vtx"
+            << std::setw(14) << "buffer KiB" << std::setw(14) << "fetch KiB" << std::setw(10) << "saved" << "\n";
+        printRow("legacy pos/color/uv", LEGACY_STRIDE, uint64_t{ LEGACY_STRIDE } * mesh.vertices.size(), legacyFetchBytes, legacyFetchBytes);
+
+        std::vector<std::pair<std::string, Timing>> packTimings{};
+        forEachVertexLayout([&](auto layout) {
+            using Layout = decltype(layout);
+
+            const MeshData& source = Layout::hasSemantic(VertexSemantic::Normal) ? meshWithNormals : mesh;
+            const VertexCacheStats sourceStats = analyzeVertexCache(source.indices, source.vertices.size(), 32);
+
+            PackedMesh packed{};
+            Timing timing = measure(config.benchmarkIterations, [&]() { packed = packMesh(source, Layout::format, &threadPool); });
+
+            std::string label = Layout::name;
+            if (packed.vertexFormat != Layout::format)
+                label += std::string(" -> ") + getVertexFormatName(packed.vertexFormat);
+
+            const uint32_t stride = getVertexStride(packed.vertexFormat);
+            printRow(label, stride, packed.vertexData.size(), uint64_t{ sourceStats.transformCount } * stride, legacyFetchBytes);
+            packTimings.emplace_back(label, timing);
+
+            if (Layout::quantizesPositions) {
+                const VertexQuantization& quantization = packed.quantization;
+                const float step = std::max({ quantization.scale.x, quantization.scale.y, quantization.scale.z }) / 65535.0f;
+                std::cout << "    position step " << std::scientific << std::setprecision(2) << step << " (max error " << step * 0.5f << ")\n";
+            }
+        });
+
+        std::cout << "\n";
+        for (const auto& [label, timing] : packTimings)
+            printTiming("pack " + label, timing);
+    }
+
+    // Triangle count and error of every generated LOD, plus the time to build the chain.
+    // The error is also given relative to the bounds diagonal, which is what the LOD budget is based on.
+    void benchmarkLods(const AppConfig& config)
+    {
+        ThreadPool threadPool{ config.workerThreads };
+
+        const MeshData source = loadObjMesh(config.modelPath, &threadPool);
+
+        MeshData mesh{};
+        Timing timing = measure(config.benchmarkIterations, [&]() {
+            mesh = source;
+            generateMeshLods(mesh);
+        });
+
+        glm::vec3 minBounds{ std::numeric_limits<float>::max() };
+        glm::vec3 maxBounds{ std::numeric_limits<float>::lowest() };
+        for (const Vertex& vertex : mesh.vertices) {
+            minBounds = glm::min(minBounds, vertex.pos);
+            maxBounds = glm::max(maxBounds, vertex.pos);
+        }
+        const float diagonal = mesh.vertices.empty() ? 0.0f : glm::length(maxBounds - minBounds);
+
+        std::cout << "lod: " << config.modelPath << " (" << mesh.vertices.size() << " vertices, "
+            << source.indices.size() / 3 << " triangles, " << mesh.lods.size() << " LODs)\n";
+        std::cout << "  " << std::left << std::setw(8) << "LOD" << std::right << std::setw(12) << "triangles"
+            << std::setw(10) << "ratio" << std::setw(14) << "error" << std::setw(12) << "% diag" << "\n";
+
+        for (size_t lodIndex = 0; lodIndex < mesh.lods.size(); lodIndex++) {
+            const MeshLod& lod = mesh.lods[lodIndex];
+            std::cout << "  " << std::left << std::setw(8) << lodIndex << std::right << std::setw(12) << lod.indexCount / 3
+                << std::fixed << std::setprecision(3) << std::setw(10) << static_cast<double>(lod.indexCount) / static_cast<double>(source.indices.size())
+                << std::scientific << std::setprecision(2) << std::setw(14) << lod.error
+                << std::fixed << std::setprecision(3) << std::setw(12) << (diagonal > 0.0f ? 100.0f * lod.error / diagonal : 0.0f) << "\n";
+        }
+
+        std::cout << "  index buffer: " << source.indices.size() * sizeof(uint32_t) << " -> "
+            << mesh.indices.size() * sizeof(uint32_t) << " bytes (32-bit, all LODs)\n\n";
+        printTiming("generate LODs", timing);
+    }
+
+    // Compares decoding the source image with stb_image against mapping the KTX2 files from TextureConverter.
+    // Both paths end with every byte the upload needs copied into a staging-sized buffer; the stb path
+    // still has to build its mips on the GPU afterwards.
+    void benchmarkTextures(const AppConfig& config)
+    {
+        std::vector<std::byte> staging{};
+        int width{}, height{};
+
+        Timing stbTiming = measure(config.benchmarkIterations, [&]() {
+            int channels{};
+            stbi_uc* pixels = stbi_load(config.texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels)
+                throw std::runtime_error("failed to load texture image!");
+
+            staging.resize(size_t{ static_cast<uint32_t>(width) } * static_cast<uint32_t>(height) * 4);
+            memcpy(staging.data(), pixels, staging.size());
+            stbi_image_free(pixels);
+        });
+
+        const uint32_t levelCount = getMipLevelCount(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+        uint64_t uncompressedSize = 0;
+        for (uint32_t level = 0; level < levelCount; level++)
+            uncompressedSize += uint64_t{ std::max(static_cast<uint32_t>(width) >> level, 1u) } * std::max(static_cast<uint32_t>(height) >> level, 1u) * 4;
+
+        auto printRow = [uncompressedSize](const std::string& label, uint64_t imageSize) {
+            std::cout << "  " << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+                << std::setw(12) << imageSize / 1024.0 << std::setw(9) << 100.0 * static_cast<double>(imageSize) / static_cast<double>(uncompressedSize) << "%\n";
+        };
+
+        std::cout << "texture: " << config.texturePath << " (" << width << "x" << height << ", " << levelCount << " levels)\n";
+        std::cout << "  " << std::left << std::setw(28) << "" << std::right << std::setw(12) << "GPU KiB" << std::setw(10) << "size" << "\n";
+        printRow("rgba8 (stb_image)", uncompressedSize);
+
+        std::vector<std::pair<std::string, Timing>> loadTimings{};
+        loadTimings.emplace_back("stb_image decode", stbTiming);
+
+        for (TextureCompression compression : TEXTURE_COMPRESSIONS) {
+            const std::string path = getCompressedTexturePath(config.texturePath, compression);
+
+            Ktx2Texture texture{};
+            if (!texture.open(path)) {
+                std::cout << "  " << std::left << std::setw(28) << getTextureCompressionName(compression) << std::right << " missing " << path << ", run TextureConverter\n";
+                continue;
+            }
+            printRow(getTextureCompressionName(compression), texture.getDataSize());
+
+            Timing timing = measure(config.benchmarkIterations, [&]() {
+                Ktx2Texture file{};
+                if (!file.open(path))
+                    throw std::runtime_error("failed to open KTX2 texture: " + path);
+
+                staging.resize(file.getDataSize());
+                size_t offset = 0;
+                for (uint32_t level = 0; level < file.getLevelCount(); level++) {
+                    memcpy(staging.data() + offset, file.getLevelData(level).data(), file.getLevelData(level).size());
+                    offset += file.getLevelData(level).size();
+                }
+            });
+            loadTimings.emplace_back(std::string("ktx2 map + copy ") + getTextureCompressionName(compression), timing);
+        }
+
+        std::cout << "\n";
+        for (const auto& [label, timing] : loadTimings)
+            printTiming(label, timing);
+    }
+
+    // Times the CPU mip generator for every filter with and without SIMD, on one thread and on the pool,
+    // and reports how far the box filtered chain is from the Kaiser one
+    void benchmarkMips(const AppConfig& config)
+    {
+        int width{}, height{}, channels{};
+        stbi_uc* pixels = stbi_load(config.texturePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels)
+            throw std::runtime_error("failed to load texture image!");
+
+        ImageData image{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+        image.pixels.assign(pixels, pixels + size_t{ image.width } * image.height * 4);
+        stbi_image_free(pixels);
+
+        ThreadPool threadPool{ config.workerThreads };
+        std::cout << "mips: " << config.texturePath << " (" << width << "x" << height << ", " << getMipLevelCount(image.width, image.height)
+            << " levels), SIMD: " << getMipSimdName() << ", " << threadPool.getThreadCount() << " threads\n";
+
+        std::vector<ImageData> chains[2]{};
+        for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser }) {
+            for (bool useSimd : { false, true }) {
+                for (ThreadPool* pool : { static_cast<ThreadPool*>(nullptr), &threadPool }) {
+                    std::vector<ImageData>& chain = chains[static_cast<int>(filter)];
+                    Timing timing = measure(config.benchmarkIterations, [&]() { chain = generateMipChain(image, true, filter, pool, useSimd); });
+                    printTiming(std::string(getMipFilterName(filter)) + (useSimd ? ", simd" : ", scalar") + (pool ? ", pool" : ", 1 thread"), timing);
+                }
+            }
+        }
+
+        // mean absolute difference of the level 1 texels, how much sharper the Kaiser filter keeps the first mip
+        const std::vector<uint8_t>& box = chains[0][std::min<size_t>(1, chains[0].size() - 1)].pixels;
+        const std::vector<uint8_t>& kaiser = chains[1][std::min<size_t>(1, chains[1].size() - 1)].pixels;
+        uint64_t difference = 0;
+        for (size_t idx = 0; idx < box.size(); idx++)
+            difference += static_cast<uint64_t>(std::abs(box[idx] - kaiser[idx]));
+
+        std::cout << "\n  box vs kaiser, level 1: mean abs difference " << std::fixed << std::setprecision(2)
+            << static_cast<double>(difference) / static_cast<double>(std::max<size_t>(box.size(), 1)) << " / 255\n";
+    }
+
+    // Updates transform hierarchies of 10k, 100k and 1M nodes (eight children per node, built breadth
+    // first) with every node, 1% of the nodes and no node dirty, scalar and SIMD, on one thread and on the pool
+    void benchmarkTransforms(const AppConfig& config)
+    {
+        ThreadPool threadPool{ config.workerThreads };
+        std::cout << "transforms: SIMD: " << getTransformSimdName() << ", " << threadPool.getThreadCount() << " threads, "
+            << config.benchmarkIterations << " iterations\n";
+
+        for (uint32_t nodeCount : { 10000u, 100000u, 1000000u }) {
+            SceneGraph scene{};
+            scene.reserve(nodeCount);
+            for (uint32_t node = 0; node < nodeCount; node++) {
+                const float angle = static_cast<float>(node % 360);
+                const glm::mat4 local = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 0.5f, 0.25f)), glm::radians(angle), glm::vec3(0.0f, 0.0f, 1.0f));
+                scene.addNode(local, node == 0 ? SceneGraph::NO_PARENT : (node - 1) / 8);
+            }
+            scene.update();
+
+            std::cout << "\n  " << nodeCount << " nodes, " << scene.getLevelCount() << " levels\n";
+
+            std::vector<glm::mat4> scalarWorlds(nodeCount);
+            for (bool useSimd : { false, true }) {
+                for (ThreadPool* pool : { static_cast<ThreadPool*>(nullptr), &threadPool }) {
+                    Timing timing = measure(config.benchmarkIterations, [&]() {
+                        scene.markAllDirty();
+                        scene.update(pool, useSimd);
+                    });
+                    printTiming(std::string("all dirty") + (useSimd ? ", simd" : ", scalar") + (pool ? ", pool" : ", 1 thread"), timing);
+
+                    if (!useSimd && !pool) {
+                        for (uint32_t node = 0; node < nodeCount; node++)
+                            scalarWorlds[node] = scene.getWorld(node);
+                    }
+                }
+            }
+
+            // every 100th node moves, its subtree follows
+            size_t updated = 0;
+            Timing partialTiming = measure(config.benchmarkIterations, [&]() {
+                for (uint32_t node = 0; node < nodeCount; node += 100)
+                    scene.setLocal(node, scene.getLocal(node));
+                updated = scene.update(&threadPool);
+            });
+            printTiming("1% dirty, simd, pool", partialTiming);
+
+            Timing staticTiming = measure(config.benchmarkIterations, [&]() { scene.update(&threadPool); });
+            printTiming("static, simd, pool", staticTiming);
+
+            float difference = 0.0f;
+            for (uint32_t node = 0; node < nodeCount; node++)
+                for (int column = 0; column < 4; column++)
+                    difference = std::max(difference, glm::length(scene.getWorld(node)[column] - scalarWorlds[node][column]));
+
+            std::cout << "  1% dirty recomputes " << updated << " world matrices, simd vs scalar: max difference "
+                << std::scientific << std::setprecision(2) << difference << std::fixed << "\n";
+        }
+    }
+
+    // Sorts draw lists of 10k, 100k and 1M random keys (eight meshes, random depths, one pipeline and
+    // material like the renderer) with DrawList's radix sort and with std::stable_sort, and checks both
+    // give the same order
+    void benchmarkDrawList(const AppConfig& config)
+    {
+        std::cout << "drawlist: " << config.benchmarkIterations << " iterations\n";
+
+        for (uint32_t drawCount : { 10000u, 100000u, 1000000u }) {
+            std::mt19937 random{ drawCount };
+            std::uniform_int_distribution<uint32_t> meshDistribution{ 0, 7 };
+            std::uniform_real_distribution<float> depthDistribution{ 0.0f, 1.0f };
+
+            std::vector<std::pair<uint64_t, uint32_t>> unsorted(drawCount);
+            for (uint32_t draw = 0; draw < drawCount; draw++)
+                unsorted[draw] = { DrawList::makeKey(0, 0, meshDistribution(random), depthDistribution(random)), draw };
+
+            std::cout << "\n  " << drawCount << " draws\n";
+
+            DrawList drawList{};
+            Timing radixTiming = measure(config.benchmarkIterations, [&]() {
+                drawList.resize(drawCount);
+                for (uint32_t draw = 0; draw < drawCount; draw++)
+                    drawList.setDraw(draw, unsorted[draw].first, unsorted[draw].second);
+                drawList.sort();
+            });
+            printTiming("radix sort", radixTiming);
+
+            std::vector<std::pair<uint64_t, uint32_t>> sorted{};
+            Timing stableTiming = measure(config.benchmarkIterations, [&]() {
+                sorted = unsorted;
+                std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+            });
+            printTiming("std::stable_sort", stableTiming);
+
+            bool equal = true;
+            for (uint32_t draw = 0; draw < drawCount; draw++)
+                equal = equal && drawList.getKey(draw) == sorted[draw].first && drawList.getObject(draw) == sorted[draw].second;
+
+            std::cout << "  radix vs stable_sort: " << (equal ? "same order" : "ORDER DIFFERS") << "\n";
+        }
+    }
+}
+
+bool runBenchmark(const AppConfig& config)
+{
+    if (config.benchmark == "mesh-load")
+        benchmarkMeshLoad(config);
+    else if (config.benchmark == "weld")
+        benchmarkWeld(config);
+    else if (config.benchmark == "vcache")
+        benchmarkVertexCache(config);
+    else if (config.benchmark == "vertex-format")
+        benchmarkVertexFormats(config);
+    else if (config.benchmark == "lod")
+        benchmarkLods(config);
+    else if (config.benchmark == "texture")
+        benchmarkTextures(config);
+    else if (config.benchmark == "mips")
+        benchmarkMips(config);
+    else if (config.benchmark == "transforms")
+        benchmarkTransforms(config);
+    else if (config.benchmark == "drawlist")
+        benchmarkDrawList(config);
+    else
+        return false;
+
+    return true;
+}
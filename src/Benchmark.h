@@ -0,0 +1,8 @@
+#pragma once
+
+#include "AppConfig.h"
+
+// Offline CPU benchmarks that run without a window or Vulkan device.
+// Selected with --bench <name>; results are printed to stdout.
+// Returns false if the benchmark name is unknown.
+bool runBenchmark(const AppConfig& config);
@@ -0,0 +1,312 @@
+#include "DepthPyramid.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+namespace {
+    // Threads per workgroup in each direction, local_size_x/y in depth_pyramid.comp
+    const uint32_t PYRAMID_GROUP_SIZE = 8;
+
+    // Matches the push constants of depth_pyramid.comp
+    struct PyramidConstants {
+        uint32_t sourceWidth;
+        uint32_t sourceHeight;
+        uint32_t destinationWidth;
+        uint32_t destinationHeight;
+        uint32_t sampleCount;
+    };
+
+    uint32_t previousPowerOfTwo(uint32_t value)
+    {
+        uint32_t result = 1;
+        while (result * 2 <= value)
+            result *= 2;
+        return result;
+    }
+
+    VkImageMemoryBarrier makeImageBarrier(VkImage image, VkImageAspectFlags aspects, VkImageLayout oldLayout, VkImageLayout newLayout,
+        VkAccessFlags srcAccess, VkAccessFlags dstAccess, uint32_t baseLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = aspects;
+        barrier.subresourceRange.baseMipLevel = baseLevel;
+        barrier.subresourceRange.levelCount = levelCount;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        return barrier;
+    }
+}
+
+void DepthPyramid::init(VkDevice device, VmaAllocator allocator)
+{
+    this->device = device;
+    this->allocator = allocator;
+
+    // source level or depth attachment, destination level
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid descriptor set layout!");
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PyramidConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid pipeline layout!");
+
+    // only read with texelFetch, the filter does not matter
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid sampler!");
+}
+
+void DepthPyramid::createPipelines(VkShaderModule depthShader, VkShaderModule reduceShader, VkPipelineCache pipelineCache)
+{
+    std::array<VkComputePipelineCreateInfo, 2> pipelineInfos{};
+    const std::array<VkShaderModule, 2> shaderModules = { depthShader, reduceShader };
+    for (size_t idx = 0; idx < pipelineInfos.size(); idx++) {
+        pipelineInfos[idx].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfos[idx].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfos[idx].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfos[idx].stage.module = shaderModules[idx];
+        pipelineInfos[idx].stage.pName = "main";
+        pipelineInfos[idx].layout = pipelineLayout;
+    }
+
+    std::array<VkPipeline, 2> pipelines{};
+    if (vkCreateComputePipelines(device, pipelineCache, static_cast<uint32_t>(pipelineInfos.size()), pipelineInfos.data(), nullptr, pipelines.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid pipelines!");
+
+    depthPipeline = pipelines[0];
+    reducePipeline = pipelines[1];
+}
+
+void DepthPyramid::createResources(VkImage depthImage, VkImageView depthView, VkFormat depthFormat, VkExtent2D extent, VkSampleCountFlagBits samples)
+{
+    this->depthImage = depthImage;
+    depthExtent = extent;
+    depthSamples = static_cast<uint32_t>(samples);
+    depthAspects = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT)
+        depthAspects |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    pyramidExtent = { previousPowerOfTwo(extent.width), previousPowerOfTwo(extent.height) };
+    uint32_t levelCount = 1;
+    while ((std::max(pyramidExtent.width, pyramidExtent.height) >> levelCount) > 0)
+        levelCount++;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = { pyramidExtent.width, pyramidExtent.height, 1 };
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &pyramidImage, &pyramidAllocation, nullptr) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid image!");
+
+    // one view over all levels for the cull shader, one per level to build it
+    auto createView = [&](uint32_t baseLevel, uint32_t count) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = pyramidImage;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = VK_FORMAT_R32_SFLOAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = baseLevel;
+        viewInfo.subresourceRange.levelCount = count;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView view{};
+        if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+            throw std::runtime_error("failed to create depth pyramid image view!");
+        return view;
+    };
+
+    pyramidView = createView(0, levelCount);
+    levels.resize(levelCount);
+    for (uint32_t level = 0; level < levelCount; level++) {
+        levels[level].view = createView(level, 1);
+        levels[level].extent = { std::max(pyramidExtent.width >> level, 1u), std::max(pyramidExtent.height >> level, 1u) };
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = levelCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = levelCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = levelCount;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create depth pyramid descriptor pool!");
+
+    const std::vector<VkDescriptorSetLayout> layouts(levelCount, descriptorSetLayout);
+    std::vector<VkDescriptorSet> descriptorSets(levelCount);
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = levelCount;
+    setInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &setInfo, descriptorSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate depth pyramid descriptor sets!");
+
+    for (uint32_t level = 0; level < levelCount; level++) {
+        levels[level].descriptorSet = descriptorSets[level];
+
+        VkDescriptorImageInfo sourceInfo{};
+        sourceInfo.sampler = sampler;
+        sourceInfo.imageView = level == 0 ? depthView : levels[level - 1].view;
+        sourceInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo destinationInfo{};
+        destinationInfo.imageView = levels[level].view;
+        destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++) {
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = levels[level].descriptorSet;
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].descriptorCount = 1;
+        }
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[0].pImageInfo = &sourceInfo;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[1].pImageInfo = &destinationInfo;
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+}
+
+void DepthPyramid::destroyResources()
+{
+    if (pyramidImage == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    for (const Level& level : levels)
+        vkDestroyImageView(device, level.view, nullptr);
+    levels.clear();
+    vkDestroyImageView(device, pyramidView, nullptr);
+    vmaDestroyImage(allocator, pyramidImage, pyramidAllocation);
+
+    descriptorPool = VK_NULL_HANDLE;
+    pyramidView = VK_NULL_HANDLE;
+    pyramidImage = VK_NULL_HANDLE;
+    pyramidAllocation = VK_NULL_HANDLE;
+}
+
+void DepthPyramid::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    destroyResources();
+    vkDestroySampler(device, sampler, nullptr);
+    vkDestroyPipeline(device, depthPipeline, nullptr);
+    vkDestroyPipeline(device, reducePipeline, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    device = VK_NULL_HANDLE;
+}
+
+void DepthPyramid::record(VkCommandBuffer commandBuffer) const
+{
+    // the depth attachment becomes readable once the first phase has drawn; the pyramid's previous
+    // contents are discarded once the previous frame's culling has read them
+    const std::array<VkImageMemoryBarrier, 2> beginBarriers = {
+        makeImageBarrier(depthImage, depthAspects, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT),
+        makeImageBarrier(pyramidImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            0, VK_ACCESS_SHADER_WRITE_BIT),
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(beginBarriers.size()), beginBarriers.data());
+
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        const VkExtent2D sourceExtent = level == 0 ? depthExtent : levels[level - 1].extent;
+        const VkExtent2D extent = levels[level].extent;
+
+        PyramidConstants constants{};
+        constants.sourceWidth = sourceExtent.width;
+        constants.sourceHeight = sourceExtent.height;
+        constants.destinationWidth = extent.width;
+        constants.destinationHeight = extent.height;
+        constants.sampleCount = depthSamples;
+
+        if (level <= 1)
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, level == 0 ? depthPipeline : reducePipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levels[level].descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (extent.width + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, (extent.height + PYRAMID_GROUP_SIZE - 1) / PYRAMID_GROUP_SIZE, 1);
+
+        // read by the next level and, after the last one, by the cull shader
+        const VkImageMemoryBarrier levelBarrier = makeImageBarrier(pyramidImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+            VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, level, 1);
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+    }
+
+    // the second phase keeps drawing into the same depth attachment
+    const VkImageMemoryBarrier endBarrier = makeImageBarrier(depthImage, depthAspects, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0, 0, nullptr, 0, nullptr, 1, &endBarrier);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// Hierarchical depth buffer (Hi-Z) for --occlusion-culling. Level 0 is the largest power of two size
+// that fits into the depth attachment and keeps the farthest depth of the pixels and samples each of
+// its texels covers; every further level halves the size and keeps the farthest of 2x2 texels. An object
+// whose closest point is farther away than the pyramid texels covering its screen bounds is hidden.
+// Built by shaders/depth_pyramid.comp between the two culling phases of GpuCulling, from the depth the
+// objects visible in the previous frame left behind. Depends on the swapchain extent, so the resources
+// are recreated with the depth attachment.
+class DepthPyramid {
+public:
+    // Creates the descriptor set and pipeline layouts and the sampler
+    void init(VkDevice device, VmaAllocator allocator);
+    // May run on any thread once init() has returned. depthShader reads the depth attachment (the
+    // multisampled variant if it has more than one sample), reduceShader builds the further levels.
+    void createPipelines(VkShaderModule depthShader, VkShaderModule reduceShader, VkPipelineCache pipelineCache);
+    // depthImage needs VK_IMAGE_USAGE_SAMPLED_BIT, depthView the depth aspect only
+    void createResources(VkImage depthImage, VkImageView depthView, VkFormat depthFormat, VkExtent2D extent, VkSampleCountFlagBits samples);
+    void destroyResources();
+    void destroy();
+
+    // Outside of a render pass, after the depth attachment was written and left in
+    // DEPTH_STENCIL_ATTACHMENT_OPTIMAL, which it is returned to. Leaves the pyramid readable by compute shaders.
+    void record(VkCommandBuffer commandBuffer) const;
+
+    // All levels, in VK_IMAGE_LAYOUT_GENERAL, for texelFetch with getSampler()
+    VkImageView getView() const { return pyramidView; }
+    VkSampler getSampler() const { return sampler; }
+    VkExtent2D getExtent() const { return pyramidExtent; }
+    uint32_t getLevelCount() const { return static_cast<uint32_t>(levels.size()); }
+
+private:
+    struct Level {
+        VkImageView view{};
+        VkDescriptorSet descriptorSet{}; // previous level (or the depth attachment) and this one
+        VkExtent2D extent{};
+    };
+
+    VkDevice device{};
+    VmaAllocator allocator{};
+
+    VkDescriptorSetLayout descriptorSetLayout{};
+    VkPipelineLayout pipelineLayout{};
+    VkPipeline depthPipeline{};
+    VkPipeline reducePipeline{};
+    VkSampler sampler{};
+
+    VkImage depthImage{};
+    VkImageAspectFlags depthAspects{};
+    VkExtent2D depthExtent{};
+    uint32_t depthSamples{};
+
+    VkImage pyramidImage{};
+    VmaAllocation pyramidAllocation{};
+    VkImageView pyramidView{};
+    VkExtent2D pyramidExtent{};
+    std::vector<Level> levels{};
+    VkDescriptorPool descriptorPool{};
+};
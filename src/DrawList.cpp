@@ -0,0 +1,87 @@
+#include "DrawList.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+    constexpr uint32_t RADIX_BITS = 8;
+    constexpr uint32_t RADIX_DIGITS = 64 / RADIX_BITS;
+    constexpr uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+}
+
+uint64_t DrawList::makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth)
+{
+    constexpr uint32_t maxDepth = (1u << DEPTH_BITS) - 1;
+    // NaN fails the comparison and ends up in front
+    const float clamped = depth > 0.0f ? std::min(depth, 1.0f) : 0.0f;
+    const uint64_t quantizedDepth = static_cast<uint64_t>(std::lround(clamped * static_cast<float>(maxDepth)));
+
+    uint64_t key = pipeline & ((1u << PIPELINE_BITS) - 1);
+    key = (key << MATERIAL_BITS) | (material & ((1u << MATERIAL_BITS) - 1));
+    key = (key << MESH_BITS) | (mesh & ((1u << MESH_BITS) - 1));
+    return (key << DEPTH_BITS) | quantizedDepth;
+}
+
+void DrawList::sort()
+{
+    if (draws.size() < 2)
+        return;
+
+    // one pass over the keys counts the values of every digit
+    std::array<std::array<size_t, RADIX_SIZE>, RADIX_DIGITS> histograms{};
+    for (const Draw& draw : draws)
+        for (uint32_t digit = 0; digit < RADIX_DIGITS; digit++)
+            histograms[digit][(draw.key >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+
+    scratch.resize(draws.size());
+    for (uint32_t digit = 0; digit < RADIX_DIGITS; digit++) {
+        const uint32_t shift = digit * RADIX_BITS;
+        std::array<size_t, RADIX_SIZE>& histogram = histograms[digit];
+
+        // all keys share this byte, e.g. the pipeline and material bytes with one pipeline and material
+        if (histogram[(draws[0].key >> shift) & (RADIX_SIZE - 1)] == draws.size())
+            continue;
+
+        size_t offset = 0;
+        for (size_t& count : histogram) {
+            const size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (const Draw& draw : draws)
+            scratch[histogram[(draw.key >> shift) & (RADIX_SIZE - 1)]++] = draw;
+        draws.swap(scratch);
+    }
+}
+
+bool DrawStateTracker::update(bool changed)
+{
+    if (changed)
+        bindsIssued++;
+    else
+        bindsAvoided++;
+
+    return changed;
+}
+
+void DrawStateTracker::bindPipeline(VkPipeline newPipeline)
+{
+    if (!update(newPipeline != pipeline))
+        return;
+
+    pipeline = newPipeline;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+}
+
+void DrawStateTracker::bindDescriptorSet(VkPipelineLayout newLayout, VkDescriptorSet newDescriptorSet, uint32_t newDynamicOffset)
+{
+    if (!update(newLayout != layout || newDescriptorSet != descriptorSet || newDynamicOffset != dynamicOffset))
+        return;
+
+    layout = newLayout;
+    descriptorSet = newDescriptorSet;
+    dynamicOffset = newDynamicOffset;
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+}
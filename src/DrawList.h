@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draws of one frame ordered by a 64-bit sort key. From the most significant bits down the key holds
+// the pipeline, the material, the mesh and the view depth, so sorting groups draws sharing state and
+// draws the ones sharing everything front to back, which lets early depth testing reject more of the
+// farther ones. sort() is an LSD radix sort on bytes that skips the bytes all keys have in common,
+// linear in the draw count and stable, so equal keys keep the order they were added in.
+class DrawList {
+public:
+    static constexpr uint32_t PIPELINE_BITS = 8;
+    static constexpr uint32_t MATERIAL_BITS = 16;
+    static constexpr uint32_t MESH_BITS = 16;
+    static constexpr uint32_t DEPTH_BITS = 24;
+
+    // depth is clamped to [0, 1], 0 being the closest; the other fields are masked to their width
+    static uint64_t makeKey(uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+    static uint32_t getPipeline(uint64_t key) { return static_cast<uint32_t>(key >> (MATERIAL_BITS + MESH_BITS + DEPTH_BITS)); }
+    static uint32_t getMaterial(uint64_t key) { return static_cast<uint32_t>(key >> (MESH_BITS + DEPTH_BITS)) & ((1u << MATERIAL_BITS) - 1); }
+    static uint32_t getMesh(uint64_t key) { return static_cast<uint32_t>(key >> DEPTH_BITS) & ((1u << MESH_BITS) - 1); }
+
+    // Makes room for drawCount draws set with setDraw(), e.g. by several threads at once
+    void resize(size_t drawCount) { draws.resize(drawCount); }
+    void setDraw(size_t draw, uint64_t key, uint32_t object) { draws[draw] = { key, object }; }
+    void sort();
+
+    size_t size() const { return draws.size(); }
+    uint64_t getKey(size_t draw) const { return draws[draw].key; }
+    uint32_t getObject(size_t draw) const { return draws[draw].object; }
+
+private:
+    struct Draw {
+        uint64_t key;
+        uint32_t object;
+    };
+
+    std::vector<Draw> draws{};
+    std::vector<Draw> scratch{}; // the other buffer of the radix passes, kept between frames
+};
+
+// Binds of the state a draw list key selects, the pipeline and the descriptor set with its dynamic
+// offset, for the draws recorded into one command buffer, skipping every bind that would not change
+// what is already bound. Starts with nothing bound, like every command buffer. Counts the binds
+// issued and avoided for the per frame report.
+class DrawStateTracker {
+public:
+    explicit DrawStateTracker(VkCommandBuffer commandBuffer)
+        : commandBuffer{ commandBuffer }
+    {
+    }
+
+    void bindPipeline(VkPipeline pipeline);
+    // set 0 with its single dynamic offset
+    void bindDescriptorSet(VkPipelineLayout layout, VkDescriptorSet descriptorSet, uint32_t dynamicOffset);
+
+    uint64_t getBindsIssued() const { return bindsIssued; }
+    uint64_t getBindsAvoided() const { return bindsAvoided; }
+
+private:
+    // Returns whether the bind has to be issued and counts it either way
+    bool update(bool changed);
+
+    VkCommandBuffer commandBuffer{};
+    VkPipeline pipeline{};
+    VkPipelineLayout layout{};
+    VkDescriptorSet descriptorSet{};
+    uint32_t dynamicOffset{};
+    uint64_t bindsIssued{};
+    uint64_t bindsAvoided{};
+};
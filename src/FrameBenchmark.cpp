@@ -0,0 +1,130 @@
+#include "FrameBenchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+    // a frame is a hitch when it takes more than this many times the median frame
+    const double HITCH_FACTOR = 2.0;
+    // and a long frame when it misses 30 fps outright
+    const double LONG_FRAME_MS = 1000.0 / 30.0;
+
+    struct Summary {
+        double mean{};
+        double p50{};
+        double p95{};
+        double p99{};
+        double max{};
+    };
+
+    // Nearest rank percentile of sorted values
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        const size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    Summary summarize(std::vector<double> values)
+    {
+        Summary summary{};
+        if (values.empty())
+            return summary;
+
+        std::sort(values.begin(), values.end());
+        for (double value : values)
+            summary.mean += value;
+        summary.mean /= static_cast<double>(values.size());
+        summary.p50 = percentile(values, 0.50);
+        summary.p95 = percentile(values, 0.95);
+        summary.p99 = percentile(values, 0.99);
+        summary.max = values.back();
+        return summary;
+    }
+
+    void writeString(std::ostream& out, const std::string& value)
+    {
+        out << '"';
+        for (char c : value) {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20)
+                out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+            else
+                out << c;
+        }
+        out << '"';
+    }
+}
+
+FrameBenchmark::FrameBenchmark(uint32_t warmupFrames, uint32_t measuredFrames)
+    : warmupFrames{ warmupFrames }
+    , measuredFrames{ measuredFrames }
+{
+    timings.reserve(measuredFrames);
+}
+
+void FrameBenchmark::record(const FrameTiming& timing)
+{
+    if (recordedFrames++ >= warmupFrames && timings.size() < measuredFrames)
+        timings.push_back(timing);
+}
+
+void FrameBenchmark::writeJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& info) const
+{
+    auto collect = [&](double FrameTiming::* member) {
+        std::vector<double> values{};
+        values.reserve(timings.size());
+        for (const FrameTiming& timing : timings)
+            values.push_back(timing.*member);
+        return values;
+    };
+
+    const std::pair<const char*, double FrameTiming::*> metrics[] = {
+        { "frameMs", &FrameTiming::frameMs },
+        { "fenceWaitMs", &FrameTiming::fenceWaitMs },
+        { "acquireMs", &FrameTiming::acquireMs },
+        { "pacingMs", &FrameTiming::pacingMs },
+        { "recordMs", &FrameTiming::recordMs },
+        { "submitMs", &FrameTiming::submitMs },
+        { "presentMs", &FrameTiming::presentMs },
+    };
+
+    const Summary frames = summarize(collect(&FrameTiming::frameMs));
+    uint64_t hitches{};
+    uint64_t longFrames{};
+    for (const FrameTiming& timing : timings) {
+        hitches += timing.frameMs > HITCH_FACTOR * frames.p50 ? 1 : 0;
+        longFrames += timing.frameMs > LONG_FRAME_MS ? 1 : 0;
+    }
+
+    // keep the caller's number formatting, out may be std::cout
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(4);
+    out << "{\n  \"run\": {";
+    for (size_t idx = 0; idx < info.size(); idx++) {
+        out << (idx == 0 ? "\n    " : ",\n    ");
+        writeString(out, info[idx].first);
+        out << ": ";
+        writeString(out, info[idx].second);
+    }
+    out << "\n  },\n";
+    out << "  \"warmupFrames\": " << warmupFrames << ",\n";
+    out << "  \"measuredFrames\": " << timings.size() << ",\n";
+
+    out << "  \"metrics\": {";
+    for (size_t idx = 0; idx < std::size(metrics); idx++) {
+        const Summary summary = summarize(collect(metrics[idx].second));
+        out << (idx == 0 ? "\n    " : ",\n    ") << '"' << metrics[idx].first << "\": { \"mean\": " << summary.mean
+            << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << " }";
+    }
+    out << "\n  },\n";
+
+    out << "  \"hitches\": { \"thresholdMs\": " << HITCH_FACTOR * frames.p50 << ", \"count\": " << hitches
+        << ", \"longFrameMs\": " << LONG_FRAME_MS << ", \"longFrames\": " << longFrames << " }\n";
+    out << "}\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// CPU side timings of one rendered frame, in milliseconds
+struct FrameTiming {
+    double frameMs{};     // start of this frame to the start of the next one
+    double fenceWaitMs{}; // blocked waiting for the frame in flight's timeline value
+    double acquireMs{};   // blocked in vkAcquireNextImageKHR
+    double pacingMs{};    // --low-latency: blocked until the previous frame was presented
+    double recordMs{};    // uniform update and command buffer recording
+    double submitMs{};    // vkQueueSubmit
+    double presentMs{};   // vkQueuePresentKHR
+};
+
+// Collects FrameTimings for --frame-bench: the first warmupFrames are discarded (pipeline and
+// driver caches, upload batches still in flight), the next measuredFrames are kept.
+// The report holds mean, p50/p95/p99 and max of every timing plus hitch counts as JSON,
+// so runs can be diffed against a baseline by a script.
+class FrameBenchmark {
+public:
+    FrameBenchmark(uint32_t warmupFrames, uint32_t measuredFrames);
+
+    // Total number of frames the render loop has to run
+    uint32_t getFrameCount() const { return warmupFrames + measuredFrames; }
+    bool isFinished() const { return recordedFrames >= getFrameCount(); }
+
+    void record(const FrameTiming& timing);
+
+    // info is written as string members of a "run" object, e.g. device name and settings
+    void writeJson(std::ostream& out, const std::vector<std::pair<std::string, std::string>>& info) const;
+
+private:
+    uint32_t warmupFrames{};
+    uint32_t measuredFrames{};
+    uint32_t recordedFrames{};
+    std::vector<FrameTiming> timings{};
+};
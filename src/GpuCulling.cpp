@@ -0,0 +1,409 @@
+#include "GpuCulling.h"
+
+#include "DepthPyramid.h"
+#include "UploadEngine.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    // Threads per workgroup, local_size_x in cull.comp
+    const uint32_t CULL_GROUP_SIZE = 64;
+
+    // Matches the uniform block of cull.comp (std140)
+    struct CullUniforms {
+        alignas(16) glm::mat4 spin;
+        alignas(16) glm::mat4 view;
+        alignas(16) glm::vec4 frustumPlanes[6];
+        alignas(16) glm::vec4 boundingSphere;
+        float pixelsPerUnit; // at distance 1
+        float lodErrorPixels;
+        uint32_t objectCount;
+        uint32_t lodCount;
+        uint32_t compact;
+        uint32_t pyramidLevelCount;
+        glm::vec2 pyramidSize;
+        alignas(16) glm::vec4 projection; // proj[0][0], proj[1][1], proj[2][2], proj[3][2]
+    };
+
+    // Planes of the clip volume of viewProj in world space, normals pointing inwards and normalized so a
+    // plane equation gives the signed distance. Depth runs from 0 to 1 (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+    void extractFrustumPlanes(const glm::mat4& viewProj, glm::vec4 (&planes)[6])
+    {
+        const glm::vec4 row0{ viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0] };
+        const glm::vec4 row1{ viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1] };
+        const glm::vec4 row2{ viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2] };
+        const glm::vec4 row3{ viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3] };
+
+        planes[0] = row3 + row0; // left
+        planes[1] = row3 - row0; // right
+        planes[2] = row3 + row1; // bottom
+        planes[3] = row3 - row1; // top
+        planes[4] = row2;        // near
+        planes[5] = row3 - row2; // far
+
+        for (glm::vec4& plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    void createBuffer(VmaAllocator allocator, VkDeviceSize size, VkBufferUsageFlags usage, VmaAllocationCreateFlags flags, VkBuffer& buffer, VmaAllocation& allocation, void** mapped = nullptr)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = flags;
+
+        VmaAllocationInfo allocationInfo{};
+        if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo) != VK_SUCCESS)
+            throw std::runtime_error("failed to create buffer!");
+
+        if (mapped)
+            *mapped = allocationInfo.pMappedData;
+    }
+}
+
+void GpuCulling::init(VkDevice device, VmaAllocator allocator, uint32_t frameCount, PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount, bool occlusionCulling)
+{
+    this->device = device;
+    this->allocator = allocator;
+    this->drawIndexedIndirectCount = drawIndexedIndirectCount;
+    this->occlusionCulling = occlusionCulling;
+    frames.assign(frameCount, {});
+
+    // objects, LODs, draw commands, counters, uniforms, then visibility and depth pyramid for occlusion culling
+    std::array<VkDescriptorSetLayoutBinding, 7> bindings{};
+    for (uint32_t binding = 0; binding < bindings.size(); binding++) {
+        bindings[binding].binding = binding;
+        bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[binding].descriptorCount = 1;
+        bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = occlusionCulling ? 7 : 5;
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create culling descriptor set layout!");
+
+    // the phase
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create culling pipeline layout!");
+}
+
+void GpuCulling::createPipeline(VkShaderModule shaderModule, VkPipelineCache pipelineCache)
+{
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pipelineLayout;
+
+    if (vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        throw std::runtime_error("failed to create culling pipeline!");
+}
+
+void GpuCulling::createBuffers(UploadEngine& uploadEngine, uint32_t objectCount, std::span<const MeshLod> lods)
+{
+    this->objectCount = objectCount;
+    lodCount = static_cast<uint32_t>(lods.size());
+
+    // MeshLod is three 32 bit values, the same layout as the std430 array in cull.comp
+    static_assert(sizeof(MeshLod) == 3 * sizeof(uint32_t));
+    const std::span<const std::byte> lodData = std::as_bytes(lods);
+    createBuffer(allocator, lodData.size_bytes(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, lodBuffer, lodAllocation);
+    uploadEngine.uploadBuffer(lodBuffer, 0, lodData);
+    uploadEngine.releaseBuffer(lodBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    if (occlusionCulling) {
+        // nothing was visible before the first frame, its second phase draws everything in the frustum
+        const std::vector<uint32_t> visibility(objectCount, 0);
+        const std::span<const std::byte> visibilityData = std::as_bytes(std::span(visibility));
+        createBuffer(allocator, visibilityData.size_bytes(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, 0, visibilityBuffer, visibilityAllocation);
+        uploadEngine.uploadBuffer(visibilityBuffer, 0, visibilityData);
+        uploadEngine.releaseBuffer(visibilityBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    for (Frame& frame : frames) {
+        createBuffer(allocator, sizeof(VkDrawIndexedIndirectCommand) * objectCount * getPhaseCount(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            0, frame.drawBuffer, frame.drawAllocation);
+        createBuffer(allocator, getCounterSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            0, frame.counterBuffer, frame.counterAllocation);
+
+        void* readbackData{};
+        createBuffer(allocator, getCounterSize(), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            frame.readbackBuffer, frame.readbackAllocation, &readbackData);
+        frame.readbackData = static_cast<const uint32_t*>(readbackData);
+
+        createBuffer(allocator, sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT,
+            frame.uniformBuffer, frame.uniformAllocation, &frame.uniformData);
+    }
+}
+
+void GpuCulling::createDescriptorSets(VkBuffer objectBuffer)
+{
+    const uint32_t frameCount = static_cast<uint32_t>(frames.size());
+
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = 5 * frameCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = frameCount;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = frameCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = frameCount;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create culling descriptor pool!");
+
+    const std::vector<VkDescriptorSetLayout> layouts(frameCount, descriptorSetLayout);
+    std::vector<VkDescriptorSet> descriptorSets(frameCount);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = frameCount;
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate culling descriptor sets!");
+
+    for (uint32_t idx = 0; idx < frameCount; idx++) {
+        Frame& frame = frames[idx];
+        frame.descriptorSet = descriptorSets[idx];
+
+        const std::array<VkDescriptorBufferInfo, 6> bufferInfos = { {
+            { objectBuffer, 0, VK_WHOLE_SIZE },
+            { lodBuffer, 0, VK_WHOLE_SIZE },
+            { frame.drawBuffer, 0, VK_WHOLE_SIZE },
+            { frame.counterBuffer, 0, VK_WHOLE_SIZE },
+            { frame.uniformBuffer, 0, sizeof(CullUniforms) },
+            { visibilityBuffer, 0, VK_WHOLE_SIZE },
+        } };
+
+        std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+        for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++) {
+            descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet = frame.descriptorSet;
+            descriptorWrites[binding].dstBinding = binding;
+            descriptorWrites[binding].descriptorType = binding == 4 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+        }
+
+        vkUpdateDescriptorSets(device, occlusionCulling ? 6 : 5, descriptorWrites.data(), 0, nullptr);
+    }
+
+    writePyramidDescriptors();
+}
+
+void GpuCulling::setDepthPyramid(const DepthPyramid& depthPyramid)
+{
+    pyramidView = depthPyramid.getView();
+    pyramidSampler = depthPyramid.getSampler();
+    pyramidExtent = depthPyramid.getExtent();
+    pyramidLevelCount = depthPyramid.getLevelCount();
+
+    writePyramidDescriptors();
+}
+
+void GpuCulling::writePyramidDescriptors()
+{
+    // the pyramid and the descriptor sets are created in either order
+    if (!occlusionCulling || pyramidView == VK_NULL_HANDLE || descriptorPool == VK_NULL_HANDLE)
+        return;
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = pyramidSampler;
+    imageInfo.imageView = pyramidView;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    for (const Frame& frame : frames) {
+        VkWriteDescriptorSet descriptorWrite{};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = frame.descriptorSet;
+        descriptorWrite.dstBinding = 6;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+void GpuCulling::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    for (Frame& frame : frames) {
+        vmaDestroyBuffer(allocator, frame.drawBuffer, frame.drawAllocation);
+        vmaDestroyBuffer(allocator, frame.counterBuffer, frame.counterAllocation);
+        vmaDestroyBuffer(allocator, frame.readbackBuffer, frame.readbackAllocation);
+        vmaDestroyBuffer(allocator, frame.uniformBuffer, frame.uniformAllocation);
+    }
+    frames.clear();
+    vmaDestroyBuffer(allocator, lodBuffer, lodAllocation);
+    if (visibilityBuffer != VK_NULL_HANDLE)
+        vmaDestroyBuffer(allocator, visibilityBuffer, visibilityAllocation);
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyPipeline(device, pipeline, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    device = VK_NULL_HANDLE;
+}
+
+void GpuCulling::update(uint32_t frame, const Parameters& parameters)
+{
+    CullUniforms uniforms{};
+    uniforms.spin = parameters.spin;
+    uniforms.view = parameters.view;
+    extractFrustumPlanes(parameters.proj * parameters.view, uniforms.frustumPlanes);
+    uniforms.boundingSphere = parameters.boundingSphere;
+    // proj[1][1] is cot(fov / 2), half the viewport height covers one unit at distance 1
+    uniforms.pixelsPerUnit = std::abs(parameters.proj[1][1]) * 0.5f * parameters.viewportHeight;
+    uniforms.lodErrorPixels = parameters.lodErrorPixels;
+    uniforms.objectCount = objectCount;
+    uniforms.lodCount = lodCount;
+    uniforms.compact = isCompacting() ? 1 : 0;
+    uniforms.pyramidLevelCount = pyramidLevelCount;
+    uniforms.pyramidSize = glm::vec2(pyramidExtent.width, pyramidExtent.height);
+    uniforms.projection = glm::vec4(parameters.proj[0][0], parameters.proj[1][1], parameters.proj[2][2], parameters.proj[3][2]);
+
+    memcpy(frames[frame].uniformData, &uniforms, sizeof(uniforms));
+}
+
+void GpuCulling::recordCulling(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase)
+{
+    const Frame& current = frames[frame];
+
+    if (phase == 0) {
+        vkCmdFillBuffer(commandBuffer, current.counterBuffer, 0, getCounterSize(), 0);
+
+        VkBufferMemoryBarrier clearBarrier{};
+        clearBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        clearBarrier.buffer = current.counterBuffer;
+        clearBarrier.offset = 0;
+        clearBarrier.size = VK_WHOLE_SIZE;
+
+        // the visibility the previous frame's second phase wrote
+        VkMemoryBarrier visibilityBarrier{};
+        visibilityBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        visibilityBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        visibilityBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            occlusionCulling ? 1 : 0, &visibilityBarrier, 1, &clearBarrier, 0, nullptr);
+    }
+    else {
+        // the counters are still being read by the first phase's indirect draw
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &current.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+    vkCmdDispatch(commandBuffer, (objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+    // the draw reads the commands and the count, the readback copies the counters
+    std::array<VkBufferMemoryBarrier, 2> cullBarriers{};
+    for (VkBufferMemoryBarrier& barrier : cullBarriers) {
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+    }
+    cullBarriers[0].buffer = current.drawBuffer;
+    cullBarriers[1].buffer = current.counterBuffer;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 0, nullptr, static_cast<uint32_t>(cullBarriers.size()), cullBarriers.data(), 0, nullptr);
+}
+
+void GpuCulling::recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase) const
+{
+    const Frame& current = frames[frame];
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    const VkDeviceSize offset = VkDeviceSize{ stride } * objectCount * phase;
+
+    if (isCompacting())
+        drawIndexedIndirectCount(commandBuffer, current.drawBuffer, offset, current.counterBuffer, sizeof(uint32_t) * phase, objectCount, stride);
+    else
+        vkCmdDrawIndexedIndirect(commandBuffer, current.drawBuffer, offset, objectCount, stride);
+}
+
+void GpuCulling::recordReadback(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+    Frame& current = frames[frame];
+
+    VkBufferCopy region{};
+    region.size = getCounterSize();
+    vkCmdCopyBuffer(commandBuffer, current.counterBuffer, current.readbackBuffer, 1, &region);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = current.readbackBuffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    current.readbackWritten = true;
+}
+
+bool GpuCulling::collect(uint32_t frame, Counts& counts)
+{
+    Frame& current = frames[frame];
+    if (!current.readbackWritten)
+        return false;
+
+    // readbacks may land in non-coherent memory
+    vmaInvalidateAllocation(allocator, current.readbackAllocation, 0, VK_WHOLE_SIZE);
+    counts.frustumCulled = current.readbackData[2];
+    counts.occlusionCulled = current.readbackData[3];
+    counts.lodObjects.assign(lodCount, 0);
+    for (uint32_t lod = 0; lod < lodCount; lod++)
+        counts.lodObjects[lod] = current.readbackData[COUNTER_LOD_OFFSET + lod];
+
+    current.readbackWritten = false;
+    return true;
+}
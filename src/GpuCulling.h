@@ -0,0 +1,125 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <vk_mem_alloc.h>
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class DepthPyramid;
+class UploadEngine;
+
+// Frustum culling and LOD selection on the GPU for --gpu-culling. Every frame a compute pass
+// (shaders/cull.comp) tests the bounding sphere of each object against the view frustum, picks its
+// LOD the same way selectLod() in main.cpp does and writes a VkDrawIndexedIndirectCommand for it.
+// The frame is then drawn with one indirect draw, so the CPU cost stays flat as objects are added.
+// With vkCmdDrawIndexedIndirectCount (VK_KHR_draw_indirect_count) the visible objects are compacted
+// to the front of the command buffer and the GPU supplies the draw count; without it every object
+// keeps its own command and culled ones get an instanceCount of 0.
+// The visible objects per LOD are copied to a mapped buffer and read without waiting once the
+// frame's timeline value has been reached, like the pipeline statistics in main.cpp.
+//
+// With --occlusion-culling the frame is drawn in two phases that each get their own commands and count.
+// The first one draws the objects that were visible at the end of the previous frame, the depth it
+// leaves behind is reduced into a DepthPyramid, and the second one tests every object against the
+// frustum and that pyramid, draws the objects that just became visible and remembers the result in a
+// per-object visibility buffer for the next frame.
+class GpuCulling {
+public:
+    // Per frame inputs of the cull shader
+    struct Parameters {
+        glm::mat4 spin{ 1.0f }; // transform every object applies before its own, ubo.model in shader.vert
+        glm::mat4 view{ 1.0f };
+        glm::mat4 proj{ 1.0f };
+        glm::vec4 boundingSphere{ 0.0f }; // of the mesh, in model space
+        float viewportHeight{};
+        float lodErrorPixels{};
+    };
+
+    // What the cull shader counted in one frame
+    struct Counts {
+        std::vector<uint64_t> lodObjects{}; // drawn objects per LOD
+        uint64_t frustumCulled{};
+        uint64_t occlusionCulled{};
+    };
+
+    // Creates the descriptor set and pipeline layouts. drawIndexedIndirectCount may be null.
+    void init(VkDevice device, VmaAllocator allocator, uint32_t frameCount, PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount, bool occlusionCulling);
+    // May run on any thread once init() has returned. shaderModule is cull_occlusion.spv with occlusion culling.
+    void createPipeline(VkShaderModule shaderModule, VkPipelineCache pipelineCache);
+    // Creates the per frame buffers for objectCount objects and uploads the LOD table through uploadEngine
+    void createBuffers(UploadEngine& uploadEngine, uint32_t objectCount, std::span<const MeshLod> lods);
+    // objectBuffer holds the objectCount ObjectData structs the vertex shader reads
+    void createDescriptorSets(VkBuffer objectBuffer);
+    // Occlusion culling only: the pyramid the second phase tests against. Call again whenever it was
+    // recreated, while no frame is in flight.
+    void setDepthPyramid(const DepthPyramid& depthPyramid);
+    void destroy();
+
+    bool isCompacting() const { return drawIndexedIndirectCount != nullptr; }
+    bool isOcclusionCulling() const { return occlusionCulling; }
+
+    void update(uint32_t frame, const Parameters& parameters);
+
+    // Outside of a render pass: writes the draw commands of a phase, phase 0 also resets the counters.
+    // Without occlusion culling there is only phase 0. Phase 1 needs the pyramid built from phase 0.
+    void recordCulling(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase);
+    // Inside the render pass, with the graphics pipeline, vertex and index buffers and descriptor sets bound
+    void recordDraw(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t phase) const;
+    // After the last render pass: copies the counters for collect()
+    void recordReadback(VkCommandBuffer commandBuffer, uint32_t frame);
+
+    // Must be called after the frame's timeline value was waited for. Fills counts with what the frame's last
+    // recording counted and returns true, or returns false if it was already collected.
+    bool collect(uint32_t frame, Counts& counts);
+
+private:
+    struct Frame {
+        VkBuffer drawBuffer{};      // objectCount VkDrawIndexedIndirectCommand per phase
+        VmaAllocation drawAllocation{};
+        VkBuffer counterBuffer{};   // draw count per phase, frustum and occlusion culled objects, drawn objects per LOD
+        VmaAllocation counterAllocation{};
+        VkBuffer readbackBuffer{};  // copy of counterBuffer
+        VmaAllocation readbackAllocation{};
+        const uint32_t* readbackData{};
+        VkBuffer uniformBuffer{};
+        VmaAllocation uniformAllocation{};
+        void* uniformData{};
+        VkDescriptorSet descriptorSet{};
+        bool readbackWritten{};
+    };
+
+    VkDeviceSize getCounterSize() const { return sizeof(uint32_t) * (COUNTER_LOD_OFFSET + lodCount); }
+    uint32_t getPhaseCount() const { return occlusionCulling ? 2 : 1; }
+    void writePyramidDescriptors();
+
+    // Index of the first LOD counter in the counter buffer, after the draw counts and culled objects
+    static const uint32_t COUNTER_LOD_OFFSET = 4;
+
+    VkDevice device{};
+    VmaAllocator allocator{};
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount{};
+    bool occlusionCulling{};
+
+    VkDescriptorSetLayout descriptorSetLayout{};
+    VkPipelineLayout pipelineLayout{};
+    VkPipeline pipeline{};
+    VkDescriptorPool descriptorPool{};
+
+    VkBuffer lodBuffer{};
+    VmaAllocation lodAllocation{};
+    VkBuffer visibilityBuffer{}; // occlusion culling: one uint per object, shared by all frames
+    VmaAllocation visibilityAllocation{};
+    VkImageView pyramidView{};
+    VkSampler pyramidSampler{};
+    VkExtent2D pyramidExtent{};
+    uint32_t pyramidLevelCount{};
+    std::vector<Frame> frames{};
+    uint32_t objectCount{};
+    uint32_t lodCount{};
+};
@@ -0,0 +1,288 @@
+#include "Ktx2Texture.h"
+
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+    constexpr char KTX2_WRITER[] = "KTXwriter\0GP2_Vulkan TextureConverter";
+
+    struct Ktx2Header {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Ktx2Header) == 80);
+
+    struct Ktx2LevelIndex {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    // Khronos Data Format color models and channel ids of the block formats we write
+    constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+    constexpr uint32_t KHR_DF_MODEL_BC3 = 130;
+    constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+    constexpr uint32_t KHR_DF_MODEL_ETC2 = 161;
+    constexpr uint32_t KHR_DF_MODEL_ASTC = 162;
+    constexpr uint32_t KHR_DF_CHANNEL_COLOR = 0;
+    constexpr uint32_t KHR_DF_CHANNEL_ETC2_COLOR = 2;
+    constexpr uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+    constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+    constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+
+    bool isSrgbFormat(VkFormat format)
+    {
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Basic data format descriptor block for a 4x4 block compressed format, prefixed by its total size
+    std::vector<uint32_t> buildDataFormatDescriptor(VkFormat format)
+    {
+        struct Sample {
+            uint32_t bitOffset;
+            uint32_t bitLength;
+            uint32_t channel;
+        };
+
+        uint32_t colorModel{};
+        std::vector<Sample> samples{};
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC1A;
+            samples = { { 0, 64, KHR_DF_CHANNEL_COLOR } };
+            break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC3;
+            samples = { { 0, 64, KHR_DF_CHANNEL_ALPHA }, { 64, 64, KHR_DF_CHANNEL_COLOR } };
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_BC7;
+            samples = { { 0, 128, KHR_DF_CHANNEL_COLOR } };
+            break;
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_ETC2;
+            samples = { { 0, 64, KHR_DF_CHANNEL_ETC2_COLOR } };
+            break;
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_ETC2;
+            samples = { { 0, 64, KHR_DF_CHANNEL_ALPHA }, { 64, 64, KHR_DF_CHANNEL_ETC2_COLOR } };
+            break;
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+            colorModel = KHR_DF_MODEL_ASTC;
+            samples = { { 0, 128, KHR_DF_CHANNEL_COLOR } };
+            break;
+        default:
+            throw std::runtime_error("failed to describe texture format for KTX2!");
+        }
+
+        const bool srgb = isSrgbFormat(format);
+        const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+        std::vector<uint32_t> words{};
+        words.push_back(4 + blockSize);
+        words.push_back(0); // vendor Khronos, basic descriptor type
+        words.push_back(2 | blockSize << 16); // version 1.3 of the data format spec
+        words.push_back(colorModel | KHR_DF_PRIMARIES_BT709 << 8 | (srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR) << 16);
+        words.push_back(3 | 3 << 8); // 4x4x1x1 texel blocks, stored as dimension - 1
+        words.push_back(getCompressedBlockSize(format));
+        words.push_back(0);
+
+        for (const Sample& sample : samples) {
+            // alpha never goes through the sRGB transfer function
+            const uint32_t channelType = sample.channel | (srgb && sample.channel == KHR_DF_CHANNEL_ALPHA ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0);
+            words.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 | channelType << 24);
+            words.push_back(0);
+            words.push_back(0);
+            words.push_back(UINT32_MAX);
+        }
+
+        return words;
+    }
+
+    uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+}
+
+void Ktx2Texture::write(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<std::byte>>& levels)
+{
+    const uint32_t blockSize = getCompressedBlockSize(format);
+    if (blockSize == 0 || levels.empty())
+        throw std::runtime_error("failed to write KTX2 texture, unsupported format: " + path);
+
+    const std::vector<uint32_t> dataFormatDescriptor = buildDataFormatDescriptor(format);
+    const uint32_t writerLength = static_cast<uint32_t>(sizeof(KTX2_WRITER));
+
+    Ktx2Header header{};
+    std::copy(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end(), header.identifier);
+    header.vkFormat = static_cast<uint32_t>(format);
+    header.typeSize = 1;
+    header.pixelWidth = width;
+    header.pixelHeight = height;
+    header.faceCount = 1;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.dfdByteOffset = static_cast<uint32_t>(sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * levels.size());
+    header.dfdByteLength = static_cast<uint32_t>(dataFormatDescriptor.size() * sizeof(uint32_t));
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = static_cast<uint32_t>(alignOffset(sizeof(uint32_t) + writerLength, 4));
+
+    // the spec stores the smallest level first, each aligned to the block size
+    std::vector<Ktx2LevelIndex> levelIndex(levels.size());
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (size_t level = levels.size(); level-- > 0;) {
+        offset = alignOffset(offset, blockSize);
+        levelIndex[level] = { offset, levels[level].size(), levels[level].size() };
+        offset += levels[level].size();
+    }
+
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to create KTX2 texture: " + tempPath);
+
+        const char padding[16]{};
+        uint64_t written = 0;
+        auto writeBytes = [&](const void* data, uint64_t size) {
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            written += size;
+        };
+
+        writeBytes(&header, sizeof(header));
+        writeBytes(levelIndex.data(), sizeof(Ktx2LevelIndex) * levelIndex.size());
+        writeBytes(dataFormatDescriptor.data(), header.dfdByteLength);
+        writeBytes(&writerLength, sizeof(writerLength));
+        writeBytes(KTX2_WRITER, writerLength);
+        writeBytes(padding, header.kvdByteOffset + header.kvdByteLength - written);
+
+        for (size_t level = levels.size(); level-- > 0;) {
+            writeBytes(padding, levelIndex[level].byteOffset - written);
+            writeBytes(levels[level].data(), levels[level].size());
+        }
+
+        if (!file)
+            throw std::runtime_error("failed to write KTX2 texture: " + tempPath);
+    }
+
+    std::error_code error{};
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        throw std::runtime_error("failed to replace KTX2 texture: " + path);
+    }
+}
+
+bool Ktx2Texture::open(const std::string& path)
+{
+    close();
+
+    if (!file.open(path))
+        return false;
+
+    if (file.getSize() < sizeof(Ktx2Header)) {
+        close();
+        return false;
+    }
+
+    Ktx2Header header{};
+    memcpy(&header, file.getData(), sizeof(header));
+
+    const VkFormat storedFormat = static_cast<VkFormat>(header.vkFormat);
+    const bool headerValid = std::equal(KTX2_IDENTIFIER.begin(), KTX2_IDENTIFIER.end(), header.identifier)
+        && getCompressedBlockSize(storedFormat) != 0
+        && header.pixelWidth > 0
+        && header.pixelHeight > 0
+        && header.pixelDepth == 0
+        && header.layerCount <= 1
+        && header.faceCount == 1
+        && header.levelCount > 0
+        && header.levelCount <= getMipLevelCount(header.pixelWidth, header.pixelHeight)
+        && header.supercompressionScheme == 0
+        && sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * header.levelCount <= file.getSize();
+
+    if (!headerValid) {
+        close();
+        return false;
+    }
+
+    // every level must be exactly the size its dimensions imply and lie inside the file
+    for (uint32_t level = 0; level < header.levelCount; level++) {
+        Ktx2LevelIndex index{};
+        memcpy(&index, file.getData() + sizeof(Ktx2Header) + sizeof(Ktx2LevelIndex) * level, sizeof(index));
+
+        const uint32_t levelWidth = std::max(header.pixelWidth >> level, 1u);
+        const uint32_t levelHeight = std::max(header.pixelHeight >> level, 1u);
+        if (index.byteLength != getCompressedLevelSize(storedFormat, levelWidth, levelHeight)
+            || index.byteOffset > file.getSize()
+            || index.byteLength > file.getSize() - index.byteOffset) {
+            close();
+            return false;
+        }
+
+        levels.emplace_back(file.getData() + index.byteOffset, index.byteLength);
+    }
+
+    format = storedFormat;
+    width = header.pixelWidth;
+    height = header.pixelHeight;
+    return true;
+}
+
+void Ktx2Texture::close()
+{
+    format = VK_FORMAT_UNDEFINED;
+    width = 0;
+    height = 0;
+    levels.clear();
+    file.close();
+}
+
+size_t Ktx2Texture::getDataSize() const
+{
+    size_t size = 0;
+    for (const std::span<const std::byte>& level : levels)
+        size += level.size();
+
+    return size;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "MappedFile.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// KTX 2.0 container holding a block compressed 2D texture and its mip chain.
+// Only the subset tools/TextureConverter.cpp writes is accepted: formats known to
+// getCompressedBlockSize(), one layer, one face, at least one level and no supercompression.
+class Ktx2Texture {
+public:
+    // Atomically (re)writes path; levels[0] is the full resolution level
+    static void write(const std::string& path, VkFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<std::byte>>& levels);
+
+    // Maps the file; returns false if it is missing, malformed or uses unsupported features
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    VkFormat getFormat() const { return format; }
+    uint32_t getWidth() const { return width; }
+    uint32_t getHeight() const { return height; }
+    uint32_t getLevelCount() const { return static_cast<uint32_t>(levels.size()); }
+
+    // View directly into the mapped file, valid until close()
+    std::span<const std::byte> getLevelData(uint32_t level) const { return levels[level]; }
+
+    // Sum of all level sizes, the GPU memory the texture occupies
+    size_t getDataSize() const;
+
+private:
+    MappedFile file{};
+    VkFormat format{ VK_FORMAT_UNDEFINED };
+    uint32_t width{};
+    uint32_t height{};
+    std::vector<std::span<const std::byte>> levels{};
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// The OS pages the contents in on demand, so large binary assets can be
+// consumed without reading them into an intermediate std::vector first.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false if the file does not exist or cannot be mapped
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    const std::byte* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+    const std::byte* data{};
+    size_t size{};
+
+#ifdef _WIN32
+    void* fileHandle{};
+    void* mappingHandle{};
+#endif
+};
@@ -0,0 +1,290 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    constexpr uint32_t MESH_CACHE_MAGIC = 0x434D5047; // "GPMC"
+    constexpr uint32_t MESH_CACHE_VERSION = 5;
+    constexpr uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+    struct MeshCacheHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceSize;
+        int64_t sourceWriteTime;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t indexSize;
+        uint32_t flags;
+        uint32_t requestedFormat;
+        uint32_t vertexFormat;
+        float quantizationOffset[3];
+        float quantizationScale[3];
+        float boundingSphere[4];
+        uint32_t lodCount;
+        uint32_t materialCount;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint64_t lodOffset;
+        uint64_t vertexMaterialOffset; // materialCount > 0 only, vertexCount rounded up to even 16-bit indices
+        uint64_t materialOffset;
+    };
+
+    // MeshMaterial with the path in a fixed size field, NUL terminated
+    struct MeshCacheMaterial {
+        float baseColor[4];
+        char texturePath[240];
+    };
+
+    uint64_t getVertexMaterialCount(uint32_t vertexCount, uint32_t materialCount)
+    {
+        return materialCount > 0 ? (uint64_t{ vertexCount } + 1) & ~uint64_t{ 1 } : 0;
+    }
+
+    // Whether every index of indexData names one of the vertexCount vertices
+    template <typename Index>
+    bool indicesInRange(std::span<const std::byte> indexData, uint32_t vertexCount)
+    {
+        const std::span<const Index> indices{ reinterpret_cast<const Index*>(indexData.data()), indexData.size() / sizeof(Index) };
+        return std::all_of(indices.begin(), indices.end(), [vertexCount](Index index) { return index < vertexCount; });
+    }
+
+    // Whether size bytes at offset lie inside a file of fileSize bytes, without letting offset + size wrap
+    bool rangeInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+    {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    uint64_t alignOffset(uint64_t offset)
+    {
+        return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+    }
+
+    // Size and modification time of the source file, used to detect stale caches
+    bool querySourceStamp(const std::string& sourcePath, uint64_t& size, int64_t& writeTime)
+    {
+        std::error_code error{};
+        size = std::filesystem::file_size(sourcePath, error);
+        if (error)
+            return false;
+
+        auto time = std::filesystem::last_write_time(sourcePath, error);
+        if (error)
+            return false;
+
+        writeTime = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+}
+
+std::string MeshCache::getCachePath(const std::string& sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+void MeshCache::write(const std::string& cachePath, const std::string& sourcePath, const PackedMesh& mesh, VertexFormat requestedFormat, uint32_t flags)
+{
+    MeshCacheHeader header{};
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    if (!querySourceStamp(sourcePath, header.sourceSize, header.sourceWriteTime))
+        throw std::runtime_error("failed to query mesh source file: " + sourcePath);
+
+    header.vertexStride = getVertexStride(mesh.vertexFormat);
+    header.vertexCount = mesh.vertexCount;
+    header.indexCount = mesh.indexCount;
+    header.indexSize = getIndexSize(mesh.indexType);
+    header.flags = flags;
+    header.requestedFormat = static_cast<uint32_t>(requestedFormat);
+    header.vertexFormat = static_cast<uint32_t>(mesh.vertexFormat);
+    for (int axis = 0; axis < 3; axis++) {
+        header.quantizationOffset[axis] = mesh.quantization.offset[axis];
+        header.quantizationScale[axis] = mesh.quantization.scale[axis];
+    }
+    for (int component = 0; component < 4; component++)
+        header.boundingSphere[component] = mesh.boundingSphere[component];
+    header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    header.vertexOffset = alignOffset(sizeof(MeshCacheHeader));
+    header.indexOffset = alignOffset(header.vertexOffset + mesh.vertexData.size());
+    header.lodOffset = alignOffset(header.indexOffset + mesh.indexData.size());
+    header.materialCount = static_cast<uint32_t>(mesh.materials.size());
+    header.vertexMaterialOffset = alignOffset(header.lodOffset + sizeof(MeshLod) * mesh.lods.size());
+    header.materialOffset = alignOffset(header.vertexMaterialOffset + sizeof(uint16_t) * mesh.vertexMaterials.size());
+
+    std::vector<MeshCacheMaterial> materials(mesh.materials.size());
+    for (size_t idx{}; idx < mesh.materials.size(); idx++) {
+        const MeshMaterial& material = mesh.materials[idx];
+        if (material.texturePath.size() >= sizeof(materials[idx].texturePath))
+            throw std::runtime_error("material texture path too long for the mesh cache: " + material.texturePath);
+
+        for (int component = 0; component < 4; component++)
+            materials[idx].baseColor[component] = material.baseColor[component];
+        memcpy(materials[idx].texturePath, material.texturePath.c_str(), material.texturePath.size() + 1);
+    }
+
+    // write to a temporary file first so a crash never leaves a half written cache behind
+    const std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to create mesh cache: " + tempPath);
+
+        const char padding[MESH_CACHE_ALIGNMENT]{};
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding, static_cast<std::streamsize>(header.vertexOffset - sizeof(header)));
+        file.write(reinterpret_cast<const char*>(mesh.vertexData.data()), static_cast<std::streamsize>(mesh.vertexData.size()));
+        file.write(padding, static_cast<std::streamsize>(header.indexOffset - header.vertexOffset - mesh.vertexData.size()));
+        file.write(reinterpret_cast<const char*>(mesh.indexData.data()), static_cast<std::streamsize>(mesh.indexData.size()));
+        file.write(padding, static_cast<std::streamsize>(header.lodOffset - header.indexOffset - mesh.indexData.size()));
+        file.write(reinterpret_cast<const char*>(mesh.lods.data()), static_cast<std::streamsize>(sizeof(MeshLod) * mesh.lods.size()));
+        file.write(padding, static_cast<std::streamsize>(header.vertexMaterialOffset - header.lodOffset - sizeof(MeshLod) * mesh.lods.size()));
+        file.write(reinterpret_cast<const char*>(mesh.vertexMaterials.data()), static_cast<std::streamsize>(sizeof(uint16_t) * mesh.vertexMaterials.size()));
+        file.write(padding, static_cast<std::streamsize>(header.materialOffset - header.vertexMaterialOffset - sizeof(uint16_t) * mesh.vertexMaterials.size()));
+        file.write(reinterpret_cast<const char*>(materials.data()), static_cast<std::streamsize>(sizeof(MeshCacheMaterial) * materials.size()));
+
+        if (!file)
+            throw std::runtime_error("failed to write mesh cache: " + tempPath);
+    }
+
+    std::error_code error{};
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        throw std::runtime_error("failed to replace mesh cache: " + cachePath);
+    }
+}
+
+bool MeshCache::open(const std::string& cachePath, const std::string& sourcePath, VertexFormat requestedFormat, uint32_t flags)
+{
+    close();
+
+    if (!file.open(cachePath))
+        return false;
+
+    uint64_t sourceSize{};
+    int64_t sourceWriteTime{};
+    if (!querySourceStamp(sourcePath, sourceSize, sourceWriteTime)) {
+        close();
+        return false;
+    }
+
+    if (file.getSize() < sizeof(MeshCacheHeader)) {
+        close();
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const MeshCacheHeader*>(file.getData());
+
+    const bool headerValid = header->magic == MESH_CACHE_MAGIC
+        && header->version == MESH_CACHE_VERSION
+        && header->flags == flags
+        && header->requestedFormat == static_cast<uint32_t>(requestedFormat)
+        && header->vertexFormat <= static_cast<uint32_t>(VertexFormat::PackedNormals)
+        && (header->indexSize == sizeof(uint16_t) || header->indexSize == sizeof(uint32_t))
+        && header->sourceSize == sourceSize
+        && header->sourceWriteTime == sourceWriteTime;
+
+    const VertexFormat storedFormat = static_cast<VertexFormat>(header->vertexFormat);
+    const uint64_t vertexBytes = uint64_t{ header->vertexCount } * header->vertexStride;
+    const uint64_t vertexMaterialCount = getVertexMaterialCount(header->vertexCount, header->materialCount);
+
+    const uint64_t fileSize = file.getSize();
+    const uint64_t indexBytes = uint64_t{ header->indexCount } * header->indexSize;
+    const uint64_t lodBytes = uint64_t{ header->lodCount } * sizeof(MeshLod);
+    const uint64_t vertexMaterialBytes = vertexMaterialCount * sizeof(uint16_t);
+    const uint64_t materialBytes = uint64_t{ header->materialCount } * sizeof(MeshCacheMaterial);
+
+    // every section inside the file on its own first, so the ordering checks below cannot wrap
+    const bool rangesValid = header->vertexStride == getVertexStride(storedFormat)
+        && header->vertexOffset >= sizeof(MeshCacheHeader)
+        && rangeInFile(header->vertexOffset, vertexBytes, fileSize)
+        && rangeInFile(header->indexOffset, indexBytes, fileSize)
+        && rangeInFile(header->lodOffset, lodBytes, fileSize)
+        && rangeInFile(header->vertexMaterialOffset, vertexMaterialBytes, fileSize)
+        && rangeInFile(header->materialOffset, materialBytes, fileSize)
+        && header->vertexOffset + vertexBytes <= header->indexOffset
+        && header->indexOffset + indexBytes <= header->lodOffset
+        && header->lodOffset + lodBytes <= header->vertexMaterialOffset
+        && header->vertexMaterialOffset + vertexMaterialBytes <= header->materialOffset
+        && header->materialCount < UINT16_MAX
+        && header->lodCount > 0
+        && header->vertexOffset % MESH_CACHE_ALIGNMENT == 0
+        && header->indexOffset % MESH_CACHE_ALIGNMENT == 0
+        && header->lodOffset % MESH_CACHE_ALIGNMENT == 0
+        && header->vertexMaterialOffset % MESH_CACHE_ALIGNMENT == 0
+        && header->materialOffset % MESH_CACHE_ALIGNMENT == 0;
+
+    if (!headerValid || !rangesValid) {
+        close();
+        return false;
+    }
+
+    vertexData = { file.getData() + header->vertexOffset, vertexBytes };
+    vertexFormat = storedFormat;
+    vertexCount = header->vertexCount;
+    quantization.offset = { header->quantizationOffset[0], header->quantizationOffset[1], header->quantizationOffset[2] };
+    quantization.scale = { header->quantizationScale[0], header->quantizationScale[1], header->quantizationScale[2] };
+    indexData = { file.getData() + header->indexOffset, indexBytes };
+    indexType = header->indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    indexCount = header->indexCount;
+    lods = { reinterpret_cast<const MeshLod*>(file.getData() + header->lodOffset), header->lodCount };
+    boundingSphere = { header->boundingSphere[0], header->boundingSphere[1], header->boundingSphere[2], header->boundingSphere[3] };
+    vertexMaterials = { reinterpret_cast<const uint16_t*>(file.getData() + header->vertexMaterialOffset), vertexMaterialCount };
+
+    const auto* cachedMaterials = reinterpret_cast<const MeshCacheMaterial*>(file.getData() + header->materialOffset);
+    materials.resize(header->materialCount);
+    for (size_t idx{}; idx < materials.size(); idx++) {
+        const MeshCacheMaterial& cached = cachedMaterials[idx];
+        materials[idx].baseColor = { cached.baseColor[0], cached.baseColor[1], cached.baseColor[2], cached.baseColor[3] };
+        materials[idx].texturePath.assign(cached.texturePath, strnlen(cached.texturePath, sizeof(cached.texturePath)));
+    }
+
+    // like a LOD outside the index data, a material id past materialCount would read out of bounds
+    // (0 is no material, the table starts at 1)
+    for (uint16_t material : vertexMaterials)
+        if (material > materials.size()) {
+            close();
+            return false;
+        }
+
+    // a LOD pointing outside the index data would make the draw read out of bounds
+    for (const MeshLod& lod : lods)
+        if (uint64_t{ lod.indexOffset } + lod.indexCount > indexCount) {
+            close();
+            return false;
+        }
+
+    // and so would an index past vertexCount; one pass over the mapped indices, far cheaper than parsing
+    // the OBJ the caller falls back to
+    const bool indicesValid = indexType == VK_INDEX_TYPE_UINT16
+        ? indicesInRange<uint16_t>(indexData, vertexCount)
+        : indicesInRange<uint32_t>(indexData, vertexCount);
+    if (!indicesValid) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+    vertexData = {};
+    vertexFormat = VertexFormat::Float;
+    quantization = {};
+    vertexCount = 0;
+    indexData = {};
+    indexType = VK_INDEX_TYPE_UINT32;
+    indexCount = 0;
+    lods = {};
+    boundingSphere = glm::vec4(0.0f);
+    vertexMaterials = {};
+    materials.clear();
+    file.close();
+}
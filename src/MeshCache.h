@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Processing steps baked into a cache file; a cache only matches when they are identical
+enum MeshCacheFlags : uint32_t {
+    MESH_CACHE_OPTIMIZED = 1 << 0, // optimizeMesh() was applied
+    MESH_CACHE_LODS = 1 << 1,      // generateMeshLods() was applied
+};
+
+// Binary cache of a processed mesh in its GPU representation, written next to the source OBJ.
+// Layout: MeshCacheHeader, followed by the packed vertex data, the index data
+// (already in its final 16 or 32-bit form), the LOD table, the per vertex material indices and the
+// material table at the offsets stored in the header.
+// A cache is only used while the size and last write time of its source file still match.
+class MeshCache {
+public:
+    static std::string getCachePath(const std::string& sourcePath);
+
+    // Atomically (re)writes the cache file for sourcePath
+    // requestedFormat is the format packMesh() was asked for, which may differ from mesh.vertexFormat
+    static void write(const std::string& cachePath, const std::string& sourcePath, const PackedMesh& mesh, VertexFormat requestedFormat, uint32_t flags);
+
+    // Maps the cache file; returns false if it is missing, stale, corrupt or built with other settings
+    bool open(const std::string& cachePath, const std::string& sourcePath, VertexFormat requestedFormat, uint32_t flags);
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    // Views directly into the mapped file, valid until close()
+    std::span<const std::byte> getVertexData() const { return vertexData; }
+    std::span<const std::byte> getIndexData() const { return indexData; }
+
+    VertexFormat getVertexFormat() const { return vertexFormat; }
+    const VertexQuantization& getQuantization() const { return quantization; }
+    uint32_t getVertexCount() const { return vertexCount; }
+
+    VkIndexType getIndexType() const { return indexType; }
+    uint32_t getIndexCount() const { return indexCount; }
+
+    std::span<const MeshLod> getLods() const { return lods; }
+    const glm::vec4& getBoundingSphere() const { return boundingSphere; }
+
+    // See PackedMesh::vertexMaterials, both empty when the mesh has no materials
+    std::span<const uint16_t> getVertexMaterials() const { return vertexMaterials; }
+    const std::vector<MeshMaterial>& getMaterials() const { return materials; }
+
+private:
+    MappedFile file{};
+    std::span<const std::byte> vertexData{};
+    std::span<const std::byte> indexData{};
+    VertexFormat vertexFormat{ VertexFormat::Float };
+    VertexQuantization quantization{};
+    uint32_t vertexCount{};
+    VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };
+    uint32_t indexCount{};
+    std::span<const MeshLod> lods{};
+    glm::vec4 boundingSphere{ 0.0f };
+    std::span<const uint16_t> vertexMaterials{};
+    std::vector<MeshMaterial> materials{}; // copied out of the file for their paths
+};
@@ -0,0 +1,343 @@
+#include "MeshLoader.h"
+
+#include "ThreadPool.h"
+#include "VertexWeldTable.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // Corners per parallelFor piece, small enough to balance, large enough to amortize scheduling
+    constexpr size_t CORNER_BATCH_SIZE = 16 * 1024;
+    constexpr size_t VERTEX_BATCH_SIZE = 16 * 1024;
+
+    Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index, uint32_t material)
+    {
+        Vertex vertex{};
+        vertex.material = material;
+
+        vertex.pos = {
+            attrib.vertices[3 * index.vertex_index + 0],
+            attrib.vertices[3 * index.vertex_index + 1],
+            attrib.vertices[3 * index.vertex_index + 2]
+        };
+
+        vertex.texCoord = {
+            attrib.texcoords[2 * index.texcoord_index + 0],
+            1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+        };
+
+        if (index.normal_index >= 0 && !attrib.normals.empty()) {
+            vertex.normal = {
+                attrib.normals[3 * index.normal_index + 0],
+                attrib.normals[3 * index.normal_index + 1],
+                attrib.normals[3 * index.normal_index + 2]
+            };
+        }
+
+        return vertex;
+    }
+
+    // Vertex::material of the face a corner belongs to, LoadObj triangulates so every face has three
+    uint32_t getCornerMaterial(const tinyobj::shape_t& shape, size_t corner)
+    {
+        const size_t face = corner / 3;
+        if (face >= shape.mesh.material_ids.size() || shape.mesh.material_ids[face] < 0)
+            return 0;
+
+        return static_cast<uint32_t>(shape.mesh.material_ids[face]) + 1;
+    }
+
+    size_t countCorners(const std::vector<tinyobj::shape_t>& shapes)
+    {
+        size_t cornerCount{};
+        for (const auto& shape : shapes)
+            cornerCount += shape.mesh.indices.size();
+
+        return cornerCount;
+    }
+
+    MeshData weldSerial(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes)
+    {
+        MeshData mesh{};
+
+        const size_t cornerCount = countCorners(shapes);
+        mesh.indices.reserve(cornerCount);
+
+        auto getVertex = [&mesh](uint32_t id) -> const Vertex& { return mesh.vertices[id]; };
+        VertexWeldTable weldTable{ cornerCount, getVertex };
+
+        for (const auto& shape : shapes) {
+            for (size_t corner{}; corner < shape.mesh.indices.size(); corner++) {
+                Vertex vertex = makeVertex(attrib, shape.mesh.indices[corner], getCornerMaterial(shape, corner));
+
+                uint32_t newId = static_cast<uint32_t>(mesh.vertices.size());
+                uint32_t id = weldTable.findOrInsert(vertex, hashVertex(vertex), newId);
+                if (id == newId)
+                    mesh.vertices.push_back(vertex);
+
+                mesh.indices.push_back(id);
+            }
+        }
+
+        return mesh;
+    }
+
+    // Welds in four parallel passes:
+    //  1. flatten all shape indices into one corner array and hash every corner
+    //  2. bucket corners into shards by their top hash bits, keeping corner order inside each shard
+    //  3. weld each shard independently; equal vertices always share a shard, and since corners
+    //     are visited in order every corner learns the first corner with the same value
+    //  4. number the "first" corners with a prefix sum in corner order and resolve the indices
+    // Step 4 reproduces exactly the numbering of the serial first-appearance loop.
+    MeshData weldParallel(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, ThreadPool& threadPool)
+    {
+        std::vector<size_t> shapeOffsets(shapes.size() + 1);
+        for (size_t shapeIdx{}; shapeIdx < shapes.size(); shapeIdx++)
+            shapeOffsets[shapeIdx + 1] = shapeOffsets[shapeIdx] + shapes[shapeIdx].mesh.indices.size();
+
+        const size_t cornerCount = shapeOffsets.back();
+        if (cornerCount >= UINT32_MAX)
+            throw std::runtime_error("mesh has too many face corners for 32-bit indices!");
+
+        // Pass 1: flatten and hash
+        std::vector<tinyobj::index_t> corners(cornerCount);
+        std::vector<uint32_t> cornerMaterials(cornerCount);
+        std::vector<uint64_t> hashes(cornerCount);
+
+        threadPool.parallelFor(cornerCount, [&](size_t begin, size_t end) {
+            size_t shapeIdx = std::upper_bound(shapeOffsets.begin(), shapeOffsets.end(), begin) - shapeOffsets.begin() - 1;
+
+            for (size_t cornerIdx = begin; cornerIdx < end; cornerIdx++) {
+                while (cornerIdx >= shapeOffsets[shapeIdx + 1])
+                    shapeIdx++;
+
+                corners[cornerIdx] = shapes[shapeIdx].mesh.indices[cornerIdx - shapeOffsets[shapeIdx]];
+                cornerMaterials[cornerIdx] = getCornerMaterial(shapes[shapeIdx], cornerIdx - shapeOffsets[shapeIdx]);
+                hashes[cornerIdx] = hashVertex(makeVertex(attrib, corners[cornerIdx], cornerMaterials[cornerIdx]));
+            }
+        }, CORNER_BATCH_SIZE);
+
+        // Pass 2: shard by hash. Chunk boundaries are fixed up front so the per chunk counts can be scanned.
+        const size_t shardCount = std::bit_ceil<size_t>(threadPool.getThreadCount() * 4);
+        const int shardShift = 64 - std::countr_zero(shardCount);
+        const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadPool.getThreadCount() * 4, cornerCount / CORNER_BATCH_SIZE));
+        auto chunkBegin = [&](size_t chunkIdx) { return cornerCount * chunkIdx / chunkCount; };
+
+        std::vector<size_t> shardCounts(chunkCount * shardCount);
+        threadPool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+            for (size_t chunkIdx = begin; chunkIdx < end; chunkIdx++)
+                for (size_t cornerIdx = chunkBegin(chunkIdx); cornerIdx < chunkBegin(chunkIdx + 1); cornerIdx++)
+                    shardCounts[chunkIdx * shardCount + (hashes[cornerIdx] >> shardShift)]++;
+        });
+
+        // exclusive scan, shard major and chunk minor, turns the counts into write positions
+        std::vector<size_t> shardBegin(shardCount + 1);
+        size_t position{};
+        for (size_t shardIdx{}; shardIdx < shardCount; shardIdx++) {
+            shardBegin[shardIdx] = position;
+            for (size_t chunkIdx{}; chunkIdx < chunkCount; chunkIdx++)
+                position += std::exchange(shardCounts[chunkIdx * shardCount + shardIdx], position);
+        }
+        shardBegin[shardCount] = position;
+
+        std::vector<uint32_t> shardCorners(cornerCount);
+        threadPool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+            for (size_t chunkIdx = begin; chunkIdx < end; chunkIdx++)
+                for (size_t cornerIdx = chunkBegin(chunkIdx); cornerIdx < chunkBegin(chunkIdx + 1); cornerIdx++)
+                    shardCorners[shardCounts[chunkIdx * shardCount + (hashes[cornerIdx] >> shardShift)]++] = static_cast<uint32_t>(cornerIdx);
+        });
+
+        // Pass 3: weld every shard, ids in the tables are corner indices
+        std::vector<uint32_t> firstCorner(cornerCount);
+        threadPool.parallelFor(shardCount, [&](size_t begin, size_t end) {
+            auto getVertex = [&](uint32_t cornerIdx) { return makeVertex(attrib, corners[cornerIdx], cornerMaterials[cornerIdx]); };
+
+            for (size_t shardIdx = begin; shardIdx < end; shardIdx++) {
+                VertexWeldTable weldTable{ shardBegin[shardIdx + 1] - shardBegin[shardIdx], getVertex };
+
+                for (size_t slot = shardBegin[shardIdx]; slot < shardBegin[shardIdx + 1]; slot++) {
+                    uint32_t cornerIdx = shardCorners[slot];
+                    firstCorner[cornerIdx] = weldTable.findOrInsert(getVertex(cornerIdx), hashes[cornerIdx], cornerIdx);
+                }
+            }
+        });
+
+        // Pass 4: count the first appearances per chunk, scan, then number them and emit the vertices
+        std::vector<uint32_t> chunkVertexBegin(chunkCount + 1);
+        threadPool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+            for (size_t chunkIdx = begin; chunkIdx < end; chunkIdx++) {
+                uint32_t count{};
+                for (size_t cornerIdx = chunkBegin(chunkIdx); cornerIdx < chunkBegin(chunkIdx + 1); cornerIdx++)
+                    count += firstCorner[cornerIdx] == cornerIdx;
+                chunkVertexBegin[chunkIdx + 1] = count;
+            }
+        });
+
+        for (size_t chunkIdx{}; chunkIdx < chunkCount; chunkIdx++)
+            chunkVertexBegin[chunkIdx + 1] += chunkVertexBegin[chunkIdx];
+
+        MeshData mesh{};
+        mesh.vertices.resize(chunkVertexBegin[chunkCount]);
+        mesh.indices.resize(cornerCount);
+
+        // vertex id of every first appearance, reusing shardCorners which is no longer needed
+        std::vector<uint32_t>& vertexIds = shardCorners;
+        threadPool.parallelFor(chunkCount, [&](size_t begin, size_t end) {
+            for (size_t chunkIdx = begin; chunkIdx < end; chunkIdx++) {
+                uint32_t vertexId = chunkVertexBegin[chunkIdx];
+                for (size_t cornerIdx = chunkBegin(chunkIdx); cornerIdx < chunkBegin(chunkIdx + 1); cornerIdx++) {
+                    if (firstCorner[cornerIdx] == cornerIdx) {
+                        vertexIds[cornerIdx] = vertexId;
+                        mesh.vertices[vertexId++] = makeVertex(attrib, corners[cornerIdx], cornerMaterials[cornerIdx]);
+                    }
+                }
+            }
+        });
+
+        threadPool.parallelFor(cornerCount, [&](size_t begin, size_t end) {
+            for (size_t cornerIdx = begin; cornerIdx < end; cornerIdx++)
+                mesh.indices[cornerIdx] = vertexIds[firstCorner[cornerIdx]];
+        }, CORNER_BATCH_SIZE);
+
+        return mesh;
+    }
+}
+
+MeshData loadObjMesh(const std::string& path, ThreadPool* threadPool, bool withNormals)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    // mtllib and map_Kd paths are relative to the OBJ file
+    const std::string baseDir = std::filesystem::path(path).parent_path().string();
+    const std::string mtlBaseDir = baseDir.empty() ? std::string{} : baseDir + "/";
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str(), mtlBaseDir.c_str())) {
+        throw std::runtime_error(warn + err);
+    }
+
+    // faceted normals would split otherwise shared vertices, so they are only kept on request
+    if (!withNormals)
+        attrib.normals.clear();
+
+    MeshData mesh = weldObjMesh(attrib, shapes, threadPool);
+
+    mesh.materials.reserve(materials.size());
+    for (const tinyobj::material_t& material : materials) {
+        MeshMaterial& meshMaterial = mesh.materials.emplace_back();
+        meshMaterial.baseColor = glm::vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], material.dissolve);
+        if (!material.diffuse_texname.empty())
+            meshMaterial.texturePath = mtlBaseDir + material.diffuse_texname;
+    }
+
+    return mesh;
+}
+
+MeshData weldObjMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, ThreadPool* threadPool)
+{
+    if (threadPool == nullptr || threadPool->getThreadCount() == 1)
+        return weldSerial(attrib, shapes);
+
+    return weldParallel(attrib, shapes, *threadPool);
+}
+
+std::vector<std::byte> encodeIndices(std::span<const uint32_t> indices, VkIndexType indexType)
+{
+    std::vector<std::byte> data(indices.size() * getIndexSize(indexType));
+
+    if (indexType == VK_INDEX_TYPE_UINT16) {
+        auto* narrow = reinterpret_cast<uint16_t*>(data.data());
+        for (size_t idx{}; idx < indices.size(); idx++)
+            narrow[idx] = static_cast<uint16_t>(indices[idx]);
+    }
+    else {
+        memcpy(data.data(), indices.data(), indices.size_bytes());
+    }
+
+    return data;
+}
+
+PackedMesh packMesh(const MeshData& mesh, VertexFormat vertexFormat, ThreadPool* threadPool)
+{
+    PackedMesh packed{};
+    packed.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    glm::vec2 texCoordMin(std::numeric_limits<float>::max());
+    glm::vec2 texCoordMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : mesh.vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+        texCoordMin = glm::min(texCoordMin, vertex.texCoord);
+        texCoordMax = glm::max(texCoordMax, vertex.texCoord);
+    }
+
+    const bool texCoordsNormalized = mesh.vertices.empty()
+        || (texCoordMin.x >= 0.0f && texCoordMin.y >= 0.0f && texCoordMax.x <= 1.0f && texCoordMax.y <= 1.0f);
+    if (vertexFormat == VertexFormat::Packed && !texCoordsNormalized)
+        vertexFormat = VertexFormat::PackedHalfUv;
+
+    packed.vertexFormat = vertexFormat;
+
+    visitVertexLayout(vertexFormat, [&](auto layout) {
+        using Layout = decltype(layout);
+
+        if constexpr (Layout::quantizesPositions) {
+            if (!mesh.vertices.empty()) {
+                packed.quantization.offset = boundsMin;
+                // flat axes keep a non-zero scale so the division stays finite
+                packed.quantization.scale = glm::max(boundsMax - boundsMin, glm::vec3(std::numeric_limits<float>::min()));
+            }
+        }
+
+        packed.vertexData.resize(size_t{ Layout::stride } * mesh.vertices.size());
+
+        auto packRange = [&](size_t begin, size_t end) {
+            for (size_t idx = begin; idx < end; idx++)
+                Layout::pack(mesh.vertices[idx], packed.quantization, packed.vertexData.data() + idx * Layout::stride);
+        };
+
+        if (threadPool != nullptr)
+            threadPool->parallelFor(mesh.vertices.size(), packRange, VERTEX_BATCH_SIZE);
+        else
+            packRange(0, mesh.vertices.size());
+    });
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius{};
+    for (const Vertex& vertex : mesh.vertices)
+        radius = std::max(radius, glm::length(vertex.pos - center));
+    packed.boundingSphere = mesh.vertices.empty() ? glm::vec4(0.0f) : glm::vec4(center, radius);
+
+    packed.lods = mesh.lods;
+    if (packed.lods.empty())
+        packed.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+
+    if (!mesh.materials.empty()) {
+        if (mesh.materials.size() >= UINT16_MAX)
+            throw std::runtime_error("mesh has too many materials for 16-bit material indices!");
+
+        packed.materials = mesh.materials;
+        packed.vertexMaterials.resize((mesh.vertices.size() + 1) & ~size_t{ 1 });
+        // faces may name materials the MTL file does not define, they get none
+        for (size_t idx{}; idx < mesh.vertices.size(); idx++) {
+            const uint32_t material = mesh.vertices[idx].material;
+            packed.vertexMaterials[idx] = static_cast<uint16_t>(material <= mesh.materials.size() ? material : 0);
+        }
+    }
+
+    packed.indexType = selectIndexType(mesh.vertices.size());
+    packed.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    packed.indexData = encodeIndices(mesh.indices, packed.indexType);
+
+    return packed;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Vertex.h"
+#include "VertexLayout.h"
+
+#include <tiny_obj_loader.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Index range of one level of detail, all LODs share the mesh's vertex and index buffers
+struct MeshLod {
+    uint32_t indexOffset{};
+    uint32_t indexCount{};
+    float error{}; // how far the simplified surface may deviate from LOD 0, in object space
+};
+
+// Diffuse part of an OBJ material
+struct MeshMaterial {
+    glm::vec4 baseColor{ 1.0f }; // Kd and the dissolve d as alpha
+    std::string texturePath{};   // map_Kd relative to the working directory, empty without one
+};
+
+// Deduplicated full precision vertex and index arrays
+struct MeshData {
+    std::vector<Vertex> vertices{};
+    std::vector<uint32_t> indices{};
+    std::vector<MeshLod> lods{}; // empty until generateMeshLods(), meaning one LOD spanning all indices
+    std::vector<MeshMaterial> materials{}; // Vertex::material - 1 indexes them
+};
+
+// A mesh in its GPU representation, vertexData and indexData are uploaded as-is
+struct PackedMesh {
+    VertexFormat vertexFormat{ VertexFormat::Float };
+    VertexQuantization quantization{};
+    uint32_t vertexCount{};
+    std::vector<std::byte> vertexData{};
+
+    VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };
+    uint32_t indexCount{};
+    std::vector<std::byte> indexData{};
+
+    std::vector<MeshLod> lods{}; // never empty
+    glm::vec4 boundingSphere{ 0.0f }; // object space center and radius
+
+    // Vertex::material of every vertex as 16 bits, padded to an even count so the shader can read pairs
+    // as uints. Empty when the mesh has no materials.
+    std::vector<MeshMaterial> materials{};
+    std::vector<uint16_t> vertexMaterials{};
+};
+
+// Parses an OBJ file and its MTL materials and welds identical vertices together.
+// With a thread pool the welding runs in parallel, the result is identical either way.
+// Normals are left at zero unless withNormals is set.
+MeshData loadObjMesh(const std::string& path, ThreadPool* threadPool = nullptr, bool withNormals = false);
+
+// Welds the face corners of all shapes into unique vertices, including normals if attrib has any.
+// Every corner takes the material of its face, see Vertex::material.
+// Vertices are numbered in order of their first appearance in the shapes,
+// which keeps the output independent of how the work is split over threads.
+MeshData weldObjMesh(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, ThreadPool* threadPool = nullptr);
+
+// Narrowest index type able to address vertexCount vertices. 0xFFFF is left unused
+// so 16-bit meshes stay compatible with primitive restart.
+inline VkIndexType selectIndexType(size_t vertexCount)
+{
+    return vertexCount <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+inline uint32_t getIndexSize(VkIndexType indexType)
+{
+    return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+// Converts indices into the raw layout of an index buffer of the given type
+std::vector<std::byte> encodeIndices(std::span<const uint32_t> indices, VkIndexType indexType);
+
+// Encodes vertices in the given layout and indices in the narrowest index type.
+// Positions are quantized to the mesh bounds; Packed falls back to PackedHalfUv when UVs leave [0, 1].
+// Throws if the mesh has more materials than the 16-bit material stream can address.
+PackedMesh packMesh(const MeshData& mesh, VertexFormat vertexFormat, ThreadPool* threadPool = nullptr);
@@ -0,0 +1,310 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace {
+    // Tuning constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    constexpr uint32_t NO_TRIANGLE = UINT32_MAX;
+
+    float computeVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+    {
+        // vertices without triangles left to draw should never attract anything
+        if (remainingTriangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cachePosition >= 0) {
+            if (cachePosition < 3) {
+                // used by the last triangle, fixed score so strips don't get preferred over fans
+                score = LAST_TRIANGLE_SCORE;
+            }
+            else {
+                const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+
+        // boost vertices with few triangles left so lone triangles are not left behind
+        score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+
+    // FIFO cache simulation using per-vertex insertion timestamps
+    class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, uint32_t cacheSize)
+            : timestamps(vertexCount, 0), cacheSize{ cacheSize }, time{ cacheSize + 1 }
+        {
+        }
+
+        // Returns true on a miss, which inserts the vertex
+        bool access(uint32_t vertex)
+        {
+            if (time - timestamps[vertex] <= cacheSize)
+                return false;
+
+            timestamps[vertex] = time++;
+            return true;
+        }
+
+    private:
+        std::vector<uint32_t> timestamps{};
+        uint32_t cacheSize{};
+        uint32_t time{};
+    };
+}
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize)
+{
+    VertexCacheStats stats{};
+    stats.triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    FifoCache cache{ vertexCount, cacheSize };
+    std::vector<bool> referenced(vertexCount);
+
+    for (uint32_t index : indices) {
+        stats.transformCount += cache.access(index);
+
+        if (!referenced[index]) {
+            referenced[index] = true;
+            stats.vertexCount++;
+        }
+    }
+
+    stats.acmr = stats.triangleCount > 0 ? static_cast<float>(stats.transformCount) / stats.triangleCount : 0.0f;
+    stats.atvr = stats.vertexCount > 0 ? static_cast<float>(stats.transformCount) / stats.vertexCount : 0.0f;
+
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles using each vertex, stored back to back (offsets + live count per vertex)
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    for (uint32_t index : indices)
+        adjacencyOffsets[index + 1]++;
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> remainingTriangles(vertexCount);
+    for (uint32_t triangle{}; triangle < triangleCount; triangle++)
+        for (uint32_t corner{}; corner < 3; corner++) {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            adjacency[adjacencyOffsets[vertex] + remainingTriangles[vertex]++] = triangle;
+        }
+
+    std::vector<int32_t> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t vertex{}; vertex < vertexCount; vertex++)
+        vertexScores[vertex] = computeVertexScore(-1, remainingTriangles[vertex]);
+
+    auto computeTriangleScore = [&](uint32_t triangle) {
+        return vertexScores[indices[triangle * 3 + 0]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+    };
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount);
+    uint32_t bestTriangle{};
+    for (uint32_t triangle{}; triangle < triangleCount; triangle++) {
+        triangleScores[triangle] = computeTriangleScore(triangle);
+        if (triangleScores[triangle] > triangleScores[bestTriangle])
+            bestTriangle = triangle;
+    }
+
+    std::vector<uint32_t> output{};
+    output.reserve(indices.size());
+
+    std::array<uint32_t, FORSYTH_CACHE_SIZE + 3> cache{};
+    std::array<uint32_t, FORSYTH_CACHE_SIZE + 3> newCache{};
+    size_t cacheCount{};
+    uint32_t scanCursor{};
+
+    while (bestTriangle != NO_TRIANGLE)
+    {
+        emitted[bestTriangle] = true;
+
+        // emit the triangle and drop it from the adjacency of its vertices
+        size_t newCacheCount{};
+        for (uint32_t corner{}; corner < 3; corner++) {
+            uint32_t vertex = indices[bestTriangle * 3 + corner];
+            output.push_back(vertex);
+
+            auto begin = adjacency.begin() + adjacencyOffsets[vertex];
+            auto end = begin + remainingTriangles[vertex];
+            *std::find(begin, end, bestTriangle) = *(end - 1);
+            remainingTriangles[vertex]--;
+
+            if (std::find(newCache.begin(), newCache.begin() + newCacheCount, vertex) == newCache.begin() + newCacheCount)
+                newCache[newCacheCount++] = vertex;
+        }
+
+        // the rest of the old cache moves back behind the triangle's vertices
+        for (size_t slot{}; slot < cacheCount; slot++) {
+            uint32_t vertex = cache[slot];
+            if (std::find(newCache.begin(), newCache.begin() + newCacheCount, vertex) == newCache.begin() + newCacheCount)
+                newCache[newCacheCount++] = vertex;
+        }
+
+        // refresh scores of everything that moved, including the vertices that just got evicted
+        for (size_t slot{}; slot < newCacheCount; slot++) {
+            uint32_t vertex = newCache[slot];
+            cachePosition[vertex] = slot < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(slot) : -1;
+            vertexScores[vertex] = computeVertexScore(cachePosition[vertex], remainingTriangles[vertex]);
+        }
+
+        // the next triangle is the best one touching the cache
+        bestTriangle = NO_TRIANGLE;
+        float bestScore = -1.0f;
+        for (size_t slot{}; slot < newCacheCount; slot++) {
+            uint32_t vertex = newCache[slot];
+
+            for (uint32_t adjacent{}; adjacent < remainingTriangles[vertex]; adjacent++) {
+                uint32_t triangle = adjacency[adjacencyOffsets[vertex] + adjacent];
+                triangleScores[triangle] = computeTriangleScore(triangle);
+
+                if (slot < FORSYTH_CACHE_SIZE && triangleScores[triangle] > bestScore) {
+                    bestScore = triangleScores[triangle];
+                    bestTriangle = triangle;
+                }
+            }
+        }
+
+        cacheCount = std::min<size_t>(newCacheCount, FORSYTH_CACHE_SIZE);
+        std::swap(cache, newCache);
+
+        // dead end: continue with the next triangle in input order
+        if (bestTriangle == NO_TRIANGLE) {
+            while (scanCursor < triangleCount && emitted[scanCursor])
+                scanCursor++;
+
+            if (scanCursor < triangleCount)
+                bestTriangle = scanCursor;
+        }
+    }
+
+    indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t cacheSize)
+{
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // a triangle missing the cache on all three vertices starts a new cluster
+    std::vector<uint32_t> clusterStarts{};
+    FifoCache cache{ vertices.size(), cacheSize };
+    for (uint32_t triangle{}; triangle < triangleCount; triangle++) {
+        uint32_t misses = cache.access(indices[triangle * 3 + 0]) + cache.access(indices[triangle * 3 + 1]) + cache.access(indices[triangle * 3 + 2]);
+        if (misses == 3 || triangle == 0)
+            clusterStarts.push_back(triangle);
+    }
+    clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+    const size_t clusterCount = clusterStarts.size() - 1;
+
+    // area weighted centroid and normal per cluster
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> clusterAreas(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea{};
+
+    for (size_t cluster{}; cluster < clusterCount; cluster++) {
+        for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++) {
+            const glm::vec3& p0 = vertices[indices[triangle * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[triangle * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[triangle * 3 + 2]].pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal) * 0.5f;
+
+            clusterNormals[cluster] += normal;
+            clusterCentroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterAreas[cluster] += area;
+        }
+
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterAreas[cluster];
+    }
+
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // clusters that face away from the center are likely in front of the others
+    std::vector<float> sortKeys(clusterCount);
+    for (size_t cluster{}; cluster < clusterCount; cluster++) {
+        float normalLength = glm::length(clusterNormals[cluster]);
+        if (clusterAreas[cluster] <= 0.0f || normalLength <= 0.0f)
+            continue;
+
+        glm::vec3 centroid = clusterCentroids[cluster] / clusterAreas[cluster];
+        sortKeys[cluster] = glm::dot(centroid - meshCentroid, clusterNormals[cluster] / normalLength);
+    }
+
+    std::vector<uint32_t> clusterOrder(clusterCount);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> output{};
+    output.reserve(indices.size());
+    for (uint32_t cluster : clusterOrder)
+        output.insert(output.end(), indices.begin() + clusterStarts[cluster] * 3, indices.begin() + clusterStarts[cluster + 1] * 3);
+
+    indices.swap(output);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    constexpr uint32_t UNUSED = UINT32_MAX;
+
+    std::vector<uint32_t> remap(vertices.size(), UNUSED);
+    uint32_t nextVertex{};
+
+    for (uint32_t& index : indices) {
+        if (remap[index] == UNUSED)
+            remap[index] = nextVertex++;
+
+        index = remap[index];
+    }
+
+    std::vector<Vertex> reordered(nextVertex);
+    for (size_t vertex{}; vertex < vertices.size(); vertex++)
+        if (remap[vertex] != UNUSED)
+            reordered[remap[vertex]] = vertices[vertex];
+
+    vertices.swap(reordered);
+}
+
+void optimizeMesh(MeshData& mesh)
+{
+    // every LOD is drawn on its own and gets its own triangle order
+    auto optimizeRange = [&mesh](size_t indexOffset, size_t indexCount) {
+        std::vector<uint32_t> range(mesh.indices.begin() + indexOffset, mesh.indices.begin() + indexOffset + indexCount);
+        optimizeVertexCache(range, mesh.vertices.size());
+        optimizeOverdraw(range, mesh.vertices);
+        std::copy(range.begin(), range.end(), mesh.indices.begin() + indexOffset);
+    };
+
+    if (mesh.lods.empty())
+        optimizeRange(0, mesh.indices.size());
+
+    for (const MeshLod& lod : mesh.lods)
+        optimizeRange(lod.indexOffset, lod.indexCount);
+
+    // LOD 0 comes first in the index buffer, so vertices end up in its fetch order
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+    uint32_t triangleCount{};
+    uint32_t vertexCount{};     // distinct vertices referenced
+    uint32_t transformCount{};  // cache misses = vertex shader invocations
+    float acmr{};               // average cache miss ratio: transforms per triangle (0.5 is ideal, 3 is worst)
+    float atvr{};               // average transform to vertex ratio: transforms per referenced vertex (1 is ideal)
+};
+
+VertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders triangles for post-transform cache locality (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Reorders clusters of cache-optimized triangles so outward facing clusters are drawn first
+// and occlude the rest (after Sander et al.). Only whole clusters that start with a cold
+// cache are moved, so the vertex cache efficiency stays nearly unchanged.
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t cacheSize = 16);
+
+// Renumbers vertices in order of first use so fetches walk the vertex buffer linearly;
+// unreferenced vertices are dropped
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Runs all of the above in the right order, the cache and overdraw passes once per LOD
+void optimizeMesh(MeshData& mesh);
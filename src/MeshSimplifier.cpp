@@ -0,0 +1,476 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+    // Open edges are weighted up so borders and seams resist being pulled inwards
+    constexpr float EDGE_WEIGHT = 10.0f;
+
+    // Stop the chain once a level keeps more than this fraction of the previous one
+    constexpr float MIN_LOD_REDUCTION = 0.85f;
+    constexpr size_t MIN_LOD_TRIANGLES = 64;
+
+    // Upper bound for a LOD's error relative to the mesh extent, selection decides when it is used
+    constexpr float MAX_LOD_RELATIVE_ERROR = 0.05f;
+
+    // Which collapses a vertex allows, see classifyVertices()
+    enum class VertexKind : uint8_t {
+        Manifold, // interior vertex, may collapse onto any neighbor
+        Border,   // on an open border, only collapses along it
+        Seam,     // one of two wedges on a UV seam, collapses along the seam together with its twin
+        Locked,   // anything more complex, never moves
+    };
+
+    // Symmetric 4x4 error quadric plus the total weight of the planes in it
+    struct Quadric {
+        float a00{}, a11{}, a22{}, a01{}, a02{}, a12{};
+        float b0{}, b1{}, b2{};
+        float c{};
+        float weight{};
+    };
+
+    void addPlane(Quadric& quadric, const glm::vec3& normal, float distance, float weight)
+    {
+        quadric.a00 += weight * normal.x * normal.x;
+        quadric.a11 += weight * normal.y * normal.y;
+        quadric.a22 += weight * normal.z * normal.z;
+        quadric.a01 += weight * normal.x * normal.y;
+        quadric.a02 += weight * normal.x * normal.z;
+        quadric.a12 += weight * normal.y * normal.z;
+        quadric.b0 += weight * normal.x * distance;
+        quadric.b1 += weight * normal.y * distance;
+        quadric.b2 += weight * normal.z * distance;
+        quadric.c += weight * distance * distance;
+        quadric.weight += weight;
+    }
+
+    void addQuadric(Quadric& quadric, const Quadric& other)
+    {
+        quadric.a00 += other.a00;
+        quadric.a11 += other.a11;
+        quadric.a22 += other.a22;
+        quadric.a01 += other.a01;
+        quadric.a02 += other.a02;
+        quadric.a12 += other.a12;
+        quadric.b0 += other.b0;
+        quadric.b1 += other.b1;
+        quadric.b2 += other.b2;
+        quadric.c += other.c;
+        quadric.weight += other.weight;
+    }
+
+    // Weighted mean squared distance of p to the planes in the quadric
+    float evaluateQuadric(const Quadric& quadric, const glm::vec3& p)
+    {
+        float rx = quadric.a00 * p.x + quadric.a01 * p.y + quadric.a02 * p.z + 2.0f * quadric.b0;
+        float ry = quadric.a01 * p.x + quadric.a11 * p.y + quadric.a12 * p.z + 2.0f * quadric.b1;
+        float rz = quadric.a02 * p.x + quadric.a12 * p.y + quadric.a22 * p.z + 2.0f * quadric.b2;
+
+        float error = rx * p.x + ry * p.y + rz * p.z + quadric.c;
+        return quadric.weight > 0.0f ? std::abs(error) / quadric.weight : 0.0f;
+    }
+
+    // Outgoing half-edges and incident triangles per vertex of an index list
+    struct Adjacency {
+        std::vector<uint32_t> edgeOffsets{};
+        std::vector<uint32_t> edgeTargets{};
+        std::vector<uint32_t> triangleOffsets{};
+        std::vector<uint32_t> triangles{};
+
+        Adjacency(std::span<const uint32_t> indices, size_t vertexCount)
+            : edgeOffsets(vertexCount + 1), edgeTargets(indices.size()), triangleOffsets(vertexCount + 1), triangles(indices.size())
+        {
+            // every corner starts exactly one half-edge and touches exactly one triangle
+            for (uint32_t index : indices)
+                edgeOffsets[index + 1]++;
+            std::partial_sum(edgeOffsets.begin(), edgeOffsets.end(), edgeOffsets.begin());
+            triangleOffsets = edgeOffsets;
+
+            std::vector<uint32_t> fill(vertexCount);
+            for (size_t triangle{}; triangle < indices.size() / 3; triangle++)
+                for (size_t corner{}; corner < 3; corner++) {
+                    uint32_t from = indices[triangle * 3 + corner];
+                    uint32_t to = indices[triangle * 3 + (corner + 1) % 3];
+
+                    edgeTargets[edgeOffsets[from] + fill[from]] = to;
+                    triangles[triangleOffsets[from] + fill[from]] = static_cast<uint32_t>(triangle);
+                    fill[from]++;
+                }
+        }
+
+        bool hasEdge(uint32_t from, uint32_t to) const
+        {
+            auto begin = edgeTargets.begin() + edgeOffsets[from];
+            auto end = edgeTargets.begin() + edgeOffsets[from + 1];
+            return std::find(begin, end, to) != end;
+        }
+
+        // true if only one direction of the edge exists, i.e. it borders a single triangle
+        bool isOpen(uint32_t a, uint32_t b) const
+        {
+            return !hasEdge(a, b) || !hasEdge(b, a);
+        }
+    };
+
+    // remap: the lowest vertex at the same position. wedge: circular list through those vertices.
+    void buildPositionRemap(const std::vector<Vertex>& vertices, std::vector<uint32_t>& remap, std::vector<uint32_t>& wedge)
+    {
+        std::vector<uint32_t> order(vertices.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        auto lessPosition = [&](uint32_t a, uint32_t b) {
+            const glm::vec3& pa = vertices[a].pos;
+            const glm::vec3& pb = vertices[b].pos;
+            if (pa.x != pb.x) return pa.x < pb.x;
+            if (pa.y != pb.y) return pa.y < pb.y;
+            if (pa.z != pb.z) return pa.z < pb.z;
+            return a < b;
+        };
+        std::sort(order.begin(), order.end(), lessPosition);
+
+        remap.resize(vertices.size());
+        wedge.resize(vertices.size());
+
+        for (size_t begin{}; begin < order.size();) {
+            size_t end = begin + 1;
+            while (end < order.size() && vertices[order[end]].pos == vertices[order[begin]].pos)
+                end++;
+
+            for (size_t idx = begin; idx < end; idx++) {
+                remap[order[idx]] = order[begin];
+                wedge[order[idx]] = order[idx + 1 < end ? idx + 1 : begin];
+            }
+
+            begin = end;
+        }
+    }
+
+    std::vector<VertexKind> classifyVertices(const Adjacency& adjacency, const std::vector<uint32_t>& remap, const std::vector<uint32_t>& wedge)
+    {
+        const size_t vertexCount = remap.size();
+
+        constexpr uint32_t NONE = UINT32_MAX;
+        std::vector<uint32_t> openOutCount(vertexCount), openInCount(vertexCount);
+        std::vector<uint32_t> openOutTarget(vertexCount, NONE), openInSource(vertexCount, NONE);
+
+        for (uint32_t from{}; from < vertexCount; from++)
+            for (uint32_t edge = adjacency.edgeOffsets[from]; edge < adjacency.edgeOffsets[from + 1]; edge++) {
+                uint32_t to = adjacency.edgeTargets[edge];
+                if (adjacency.hasEdge(to, from))
+                    continue;
+
+                openOutCount[from]++;
+                openOutTarget[from] = to;
+                openInCount[to]++;
+                openInSource[to] = from;
+            }
+
+        std::vector<VertexKind> kinds(vertexCount, VertexKind::Locked);
+        for (uint32_t vertex{}; vertex < vertexCount; vertex++) {
+            const bool closed = openOutCount[vertex] == 0 && openInCount[vertex] == 0;
+            const bool singleOpenEdgePair = openOutCount[vertex] == 1 && openInCount[vertex] == 1;
+
+            if (wedge[vertex] == vertex) {
+                if (closed)
+                    kinds[vertex] = VertexKind::Manifold;
+                else if (singleOpenEdgePair)
+                    kinds[vertex] = VertexKind::Border;
+            }
+            else if (wedge[wedge[vertex]] == vertex) {
+                // a seam: both wedges have one open edge pair and they run along the same positions
+                const uint32_t twin = wedge[vertex];
+                const bool twinSingleOpenEdgePair = openOutCount[twin] == 1 && openInCount[twin] == 1;
+
+                if (singleOpenEdgePair && twinSingleOpenEdgePair
+                    && remap[openOutTarget[vertex]] == remap[openInSource[twin]]
+                    && remap[openInSource[vertex]] == remap[openOutTarget[twin]])
+                    kinds[vertex] = VertexKind::Seam;
+            }
+        }
+
+        return kinds;
+    }
+
+    struct Collapse {
+        uint32_t from{};
+        uint32_t to{};
+        float error{};
+    };
+
+    // Would moving vertex onto target's position flip or degenerate one of its triangles?
+    bool hasTriangleFlips(const Adjacency& adjacency, std::span<const uint32_t> indices, const std::vector<glm::vec3>& positions,
+        uint32_t vertex, uint32_t target)
+    {
+        const glm::vec3& newPosition = positions[target];
+
+        for (uint32_t slot = adjacency.triangleOffsets[vertex]; slot < adjacency.triangleOffsets[vertex + 1]; slot++) {
+            uint32_t triangle = adjacency.triangles[slot];
+            uint32_t i0 = indices[triangle * 3 + 0], i1 = indices[triangle * 3 + 1], i2 = indices[triangle * 3 + 2];
+
+            // triangles on the collapsing edge disappear
+            if (i0 == target || i1 == target || i2 == target)
+                continue;
+
+            const glm::vec3& p0 = positions[i0];
+            const glm::vec3& p1 = positions[i1];
+            const glm::vec3& p2 = positions[i2];
+            glm::vec3 oldNormal = glm::cross(p1 - p0, p2 - p0);
+
+            glm::vec3 q0 = i0 == vertex ? newPosition : p0;
+            glm::vec3 q1 = i1 == vertex ? newPosition : p1;
+            glm::vec3 q2 = i2 == vertex ? newPosition : p2;
+            glm::vec3 newNormal = glm::cross(q1 - q0, q2 - q0);
+
+            // turning by more than ~75 degrees counts as a flip too
+            const float newArea = glm::length(newNormal);
+            if (glm::dot(oldNormal, newNormal) <= 0.25f * glm::length(oldNormal) * newArea)
+                return true;
+
+            // collinear result, whatever normal is left is rounding noise
+            const float longestEdge = std::max({ glm::dot(q1 - q0, q1 - q0), glm::dot(q2 - q0, q2 - q0), glm::dot(q2 - q1, q2 - q1) });
+            if (newArea <= 1e-5f * longestEdge)
+                return true;
+        }
+
+        return false;
+    }
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, std::span<const uint32_t> indices,
+    size_t targetIndexCount, float maxError, float* resultError)
+{
+    std::vector<uint32_t> result(indices.begin(), indices.end());
+    if (resultError != nullptr)
+        *resultError = 0.0f;
+
+    const size_t vertexCount = vertices.size();
+    if (result.size() <= targetIndexCount || vertexCount == 0)
+        return result;
+
+    // work in a unit cube so errors are comparable between meshes and float precision holds up
+    glm::vec3 boundsMin = vertices[0].pos;
+    glm::vec3 boundsMax = vertices[0].pos;
+    for (const Vertex& vertex : vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+
+    const glm::vec3 extents = boundsMax - boundsMin;
+    const float extent = std::max({ extents.x, extents.y, extents.z, std::numeric_limits<float>::min() });
+
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t vertex{}; vertex < vertexCount; vertex++)
+        positions[vertex] = (vertices[vertex].pos - boundsMin) / extent;
+
+    std::vector<uint32_t> remap{}, wedge{};
+    buildPositionRemap(vertices, remap, wedge);
+
+    // kinds and quadrics come from the input and persist through all passes
+    std::vector<VertexKind> kinds{};
+    std::vector<Quadric> quadrics(vertexCount);
+    {
+        Adjacency adjacency{ result, vertexCount };
+        kinds = classifyVertices(adjacency, remap, wedge);
+
+        for (size_t triangle{}; triangle < result.size() / 3; triangle++) {
+            const uint32_t corners[3] = { result[triangle * 3 + 0], result[triangle * 3 + 1], result[triangle * 3 + 2] };
+            const glm::vec3& p0 = positions[corners[0]];
+            const glm::vec3& p1 = positions[corners[1]];
+            const glm::vec3& p2 = positions[corners[2]];
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            if (area == 0.0f)
+                continue;
+
+            normal /= area;
+            for (uint32_t corner : corners)
+                addPlane(quadrics[remap[corner]], normal, -glm::dot(normal, p0), area);
+
+            // planes through open edges, perpendicular to the triangle, keep borders and seams in place
+            for (size_t edge{}; edge < 3; edge++) {
+                uint32_t from = corners[edge], to = corners[(edge + 1) % 3];
+                if (adjacency.hasEdge(to, from))
+                    continue;
+
+                glm::vec3 direction = positions[to] - positions[from];
+                float length = glm::length(direction);
+                if (length == 0.0f)
+                    continue;
+
+                glm::vec3 edgeNormal = glm::normalize(glm::cross(direction, normal));
+                float distance = -glm::dot(edgeNormal, positions[from]);
+                addPlane(quadrics[remap[from]], edgeNormal, distance, length * length * EDGE_WEIGHT);
+                addPlane(quadrics[remap[to]], edgeNormal, distance, length * length * EDGE_WEIGHT);
+            }
+        }
+    }
+
+    const float maxRelativeError = maxError / extent;
+    const float errorLimit = maxRelativeError * maxRelativeError;
+    float largestError{};
+
+    std::vector<Collapse> collapses{};
+    std::vector<uint32_t> collapseTarget(vertexCount);
+    std::vector<bool> touched(vertexCount);
+
+    while (result.size() > targetIndexCount)
+    {
+        Adjacency adjacency{ result, vertexCount };
+
+        auto canCollapse = [&](uint32_t from, uint32_t to) {
+            switch (kinds[from]) {
+            case VertexKind::Manifold:
+                return true;
+            case VertexKind::Border:
+                return (kinds[to] == VertexKind::Border || kinds[to] == VertexKind::Locked) && adjacency.isOpen(from, to);
+            case VertexKind::Seam:
+                return (kinds[to] == VertexKind::Seam || kinds[to] == VertexKind::Locked) && adjacency.isOpen(from, to);
+            case VertexKind::Locked:
+                break;
+            }
+            return false;
+        };
+
+        // cheapest allowed direction of every edge
+        collapses.clear();
+        for (size_t corner{}; corner < result.size(); corner++) {
+            uint32_t a = result[corner];
+            uint32_t b = result[corner - corner % 3 + (corner + 1) % 3];
+
+            // interior edges show up once per direction, only look at one of them
+            if (remap[a] == remap[b] || (a > b && adjacency.hasEdge(b, a)))
+                continue;
+
+            Collapse best{ a, b, std::numeric_limits<float>::max() };
+            if (canCollapse(a, b))
+                best.error = evaluateQuadric(quadrics[remap[a]], positions[b]);
+            if (canCollapse(b, a)) {
+                float error = evaluateQuadric(quadrics[remap[b]], positions[a]);
+                if (error < best.error)
+                    best = { b, a, error };
+            }
+
+            if (best.error <= errorLimit)
+                collapses.push_back(best);
+        }
+
+        if (collapses.empty())
+            break;
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        // one collapse removes about two triangles; leave the rest to later passes on the updated mesh
+        const size_t triangleGoal = (result.size() - targetIndexCount) / 3;
+        size_t trianglesRemoved{};
+
+        std::iota(collapseTarget.begin(), collapseTarget.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        for (const Collapse& collapse : collapses) {
+            if (trianglesRemoved >= triangleGoal)
+                break;
+
+            const uint32_t from = collapse.from, to = collapse.to;
+            if (touched[remap[from]] || touched[remap[to]])
+                continue;
+
+            // the twin wedge of a seam vertex follows along the seam on its own side
+            uint32_t twinFrom = from, twinTo = to;
+            if (kinds[from] == VertexKind::Seam) {
+                twinFrom = wedge[from];
+                twinTo = to;
+                for (uint32_t candidate = wedge[to]; candidate != to; candidate = wedge[candidate])
+                    if (adjacency.hasEdge(twinFrom, candidate) || adjacency.hasEdge(candidate, twinFrom)) {
+                        twinTo = candidate;
+                        break;
+                    }
+
+                if (twinTo == to)
+                    continue;
+            }
+
+            if (hasTriangleFlips(adjacency, result, positions, from, to)
+                || (twinFrom != from && hasTriangleFlips(adjacency, result, positions, twinFrom, twinTo)))
+                continue;
+
+            collapseTarget[from] = to;
+            collapseTarget[twinFrom] = twinTo;
+            addQuadric(quadrics[remap[to]], quadrics[remap[from]]);
+
+            // lock the whole neighborhood, so the flip checks stay valid for the rest of the pass
+            for (uint32_t moved : { from, twinFrom })
+                for (uint32_t slot = adjacency.triangleOffsets[moved]; slot < adjacency.triangleOffsets[moved + 1]; slot++) {
+                    uint32_t triangle = adjacency.triangles[slot];
+                    for (size_t corner{}; corner < 3; corner++)
+                        touched[remap[result[triangle * 3 + corner]]] = true;
+                }
+
+            trianglesRemoved += kinds[from] == VertexKind::Border ? 1 : 2;
+            largestError = std::max(largestError, collapse.error);
+        }
+
+        if (trianglesRemoved == 0)
+            break;
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t writeIdx{};
+        for (size_t triangle{}; triangle < result.size() / 3; triangle++) {
+            uint32_t i0 = collapseTarget[result[triangle * 3 + 0]];
+            uint32_t i1 = collapseTarget[result[triangle * 3 + 1]];
+            uint32_t i2 = collapseTarget[result[triangle * 3 + 2]];
+
+            if (i0 == i1 || i1 == i2 || i2 == i0)
+                continue;
+
+            result[writeIdx++] = i0;
+            result[writeIdx++] = i1;
+            result[writeIdx++] = i2;
+        }
+        result.resize(writeIdx);
+    }
+
+    if (resultError != nullptr)
+        *resultError = std::sqrt(largestError) * extent;
+
+    return result;
+}
+
+void generateMeshLods(MeshData& mesh, uint32_t maxLodCount)
+{
+    mesh.lods.clear();
+    mesh.lods.push_back({ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f });
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (const Vertex& vertex : mesh.vertices) {
+        boundsMin = glm::min(boundsMin, vertex.pos);
+        boundsMax = glm::max(boundsMax, vertex.pos);
+    }
+    const float maxError = glm::length(boundsMax - boundsMin) * MAX_LOD_RELATIVE_ERROR;
+
+    // each level simplifies the previous one, so its error adds up with theirs
+    std::vector<uint32_t> previous = mesh.indices;
+    float error{};
+
+    while (mesh.lods.size() < maxLodCount)
+    {
+        const size_t targetIndexCount = previous.size() / 6 * 3;
+        if (targetIndexCount < MIN_LOD_TRIANGLES * 3)
+            break;
+
+        float lodError{};
+        std::vector<uint32_t> simplified = simplifyMesh(mesh.vertices, previous, targetIndexCount, maxError, &lodError);
+        if (simplified.size() > previous.size() * MIN_LOD_REDUCTION)
+            break;
+
+        error += lodError;
+        mesh.lods.push_back({ static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()), error });
+        mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+
+        previous = std::move(simplified);
+    }
+}
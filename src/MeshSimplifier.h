@@ -0,0 +1,23 @@
+#pragma once
+
+#include "MeshLoader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Levels of detail generated per mesh, including the full resolution LOD 0
+constexpr uint32_t MAX_MESH_LODS = 6;
+
+// Collapses edges in order of their quadric error (Garland & Heckbert) until at most
+// targetIndexCount indices are left or the next collapse would exceed maxError, an object
+// space distance. The vertex buffer is shared with the input, only the index list changes.
+// Open borders and UV seams only collapse along themselves, so their outline is preserved
+// and UV islands stay intact. resultError receives the largest error actually introduced.
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, std::span<const uint32_t> indices,
+    size_t targetIndexCount, float maxError, float* resultError = nullptr);
+
+// Builds a LOD chain for mesh.indices, each level targeting half the triangles of the one before.
+// The simplified index lists are appended to mesh.indices and described by mesh.lods.
+void generateMeshLods(MeshData& mesh, uint32_t maxLodCount = MAX_MESH_LODS);
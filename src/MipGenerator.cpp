@@ -0,0 +1,319 @@
+#include "MipGenerator.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <functional>
+#include <numbers>
+
+#if defined(__AVX2__)
+#define MIP_GENERATOR_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Kaiser window parameters as used by NVIDIA Texture Tools, the width is in destination texels
+    constexpr float KAISER_WIDTH = 2.0f;
+    constexpr float KAISER_ALPHA = 4.0f;
+
+    // Levels with fewer rows are filtered on the calling thread, splitting them costs more than it saves
+    constexpr uint32_t MIN_PARALLEL_ROWS = 32;
+    constexpr size_t ROWS_PER_TASK = 4;
+
+    // linear values are quantized to 16 bits before the table lookup, fine enough for the steep dark end of sRGB
+    constexpr uint32_t SRGB_ENCODE_TABLE_SIZE = 1 << 16;
+
+    // Linear RGBA texels of one level, every channel in [0, 1]
+    struct FloatImage {
+        uint32_t width{};
+        uint32_t height{};
+        std::vector<float> texels{};
+    };
+
+    // Source texels and weights of every destination texel along one axis; edges clamp
+    struct FilterBank {
+        std::vector<uint32_t> offsets{}; // taps of destination d are [offsets[d], offsets[d + 1])
+        std::vector<uint32_t> sources{};
+        std::vector<float> weights{};
+    };
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    const std::array<float, 256>& getSrgbDecodeTable()
+    {
+        static const auto table = []() {
+            std::array<float, 256> result{};
+            for (uint32_t value = 0; value < result.size(); value++)
+                result[value] = srgbToLinear(value / 255.0f);
+            return result;
+        }();
+
+        return table;
+    }
+
+    const std::vector<uint8_t>& getSrgbEncodeTable()
+    {
+        static const auto table = []() {
+            std::vector<uint8_t> result(SRGB_ENCODE_TABLE_SIZE);
+            for (uint32_t value = 0; value < SRGB_ENCODE_TABLE_SIZE; value++)
+                result[value] = static_cast<uint8_t>(linearToSrgb(value / float(SRGB_ENCODE_TABLE_SIZE - 1)) * 255.0f + 0.5f);
+            return result;
+        }();
+
+        return table;
+    }
+
+    // Zeroth order modified Bessel function of the first kind, by its power series
+    float besselI0(float x)
+    {
+        float sum = 1.0f;
+        float term = 1.0f;
+        const float halfSquared = x * x * 0.25f;
+        for (int k = 1; k < 32 && term > sum * 1e-8f; k++) {
+            term *= halfSquared / static_cast<float>(k * k);
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    // t is the distance from the destination texel center in destination texels
+    float evaluateFilter(MipFilter filter, float t)
+    {
+        if (filter == MipFilter::Box)
+            return std::abs(t) <= 0.5f ? 1.0f : 0.0f;
+
+        if (std::abs(t) >= KAISER_WIDTH)
+            return 0.0f;
+
+        const float sinc = t == 0.0f ? 1.0f : std::sin(std::numbers::pi_v<float> * t) / (std::numbers::pi_v<float> * t);
+        const float window = t / KAISER_WIDTH;
+        return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0f - window * window)) / besselI0(KAISER_ALPHA);
+    }
+
+    FilterBank buildFilterBank(uint32_t sourceSize, uint32_t destinationSize, MipFilter filter)
+    {
+        const float scale = static_cast<float>(sourceSize) / static_cast<float>(destinationSize);
+        const float support = (filter == MipFilter::Box ? 0.5f : KAISER_WIDTH) * scale;
+
+        FilterBank bank{};
+        bank.offsets.push_back(0);
+        for (uint32_t destination = 0; destination < destinationSize; destination++) {
+            const float center = (destination + 0.5f) * scale;
+            const int first = static_cast<int>(std::floor(center - support));
+            const int last = static_cast<int>(std::ceil(center + support));
+
+            const size_t firstTap = bank.weights.size();
+            float weightSum = 0.0f;
+            for (int source = first; source <= last; source++) {
+                const float weight = evaluateFilter(filter, (source + 0.5f - center) / scale);
+                if (weight == 0.0f)
+                    continue;
+
+                bank.sources.push_back(static_cast<uint32_t>(std::clamp(source, 0, static_cast<int>(sourceSize) - 1)));
+                bank.weights.push_back(weight);
+                weightSum += weight;
+            }
+
+            for (size_t tap = firstTap; tap < bank.weights.size(); tap++)
+                bank.weights[tap] /= weightSum;
+
+            bank.offsets.push_back(static_cast<uint32_t>(bank.weights.size()));
+        }
+
+        return bank;
+    }
+
+    void forEachRow(ThreadPool* threadPool, uint32_t rowCount, const std::function<void(size_t begin, size_t end)>& fn)
+    {
+        if (threadPool != nullptr && rowCount >= MIN_PARALLEL_ROWS)
+            threadPool->parallelFor(rowCount, fn, ROWS_PER_TASK);
+        else
+            fn(0, rowCount);
+    }
+
+    // target[i] += weight * source[i] for count floats
+    void accumulateRow(float* target, const float* source, float weight, size_t count, bool useSimd)
+    {
+        size_t idx = 0;
+        if (useSimd) {
+#if defined(MIP_GENERATOR_AVX2)
+            const __m256 weights = _mm256_set1_ps(weight);
+            for (; idx + 8 <= count; idx += 8)
+                _mm256_storeu_ps(target + idx, _mm256_add_ps(_mm256_loadu_ps(target + idx), _mm256_mul_ps(weights, _mm256_loadu_ps(source + idx))));
+#elif defined(MIP_GENERATOR_SSE2)
+            const __m128 weights = _mm_set1_ps(weight);
+            for (; idx + 4 <= count; idx += 4)
+                _mm_storeu_ps(target + idx, _mm_add_ps(_mm_loadu_ps(target + idx), _mm_mul_ps(weights, _mm_loadu_ps(source + idx))));
+#endif
+        }
+
+        for (; idx < count; idx++)
+            target[idx] += weight * source[idx];
+    }
+
+    // Weighted sum of RGBA texels of one row, clamped to [0, 1]
+    void filterTexel(const float* row, const uint32_t* sources, const float* weights, uint32_t tapCount, float* target, bool useSimd)
+    {
+        if (useSimd) {
+#if defined(MIP_GENERATOR_AVX2)
+            // two taps per iteration, one in each 128-bit lane
+            __m256 sum = _mm256_setzero_ps();
+            uint32_t tap = 0;
+            for (; tap + 2 <= tapCount; tap += 2) {
+                const __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(row + sources[tap] * 4)), _mm_loadu_ps(row + sources[tap + 1] * 4), 1);
+                const __m256 tapWeights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weights[tap])), _mm_set1_ps(weights[tap + 1]), 1);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(texels, tapWeights));
+            }
+
+            __m128 result = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+            if (tap < tapCount)
+                result = _mm_add_ps(result, _mm_mul_ps(_mm_loadu_ps(row + sources[tap] * 4), _mm_set1_ps(weights[tap])));
+
+            _mm_storeu_ps(target, _mm_min_ps(_mm_max_ps(result, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+            return;
+#elif defined(MIP_GENERATOR_SSE2)
+            __m128 sum = _mm_setzero_ps();
+            for (uint32_t tap = 0; tap < tapCount; tap++)
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + sources[tap] * 4), _mm_set1_ps(weights[tap])));
+
+            _mm_storeu_ps(target, _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f)));
+            return;
+#endif
+        }
+
+        std::array<float, 4> sum{};
+        for (uint32_t tap = 0; tap < tapCount; tap++)
+            for (int channel = 0; channel < 4; channel++)
+                sum[channel] += row[sources[tap] * 4 + channel] * weights[tap];
+
+        for (int channel = 0; channel < 4; channel++)
+            target[channel] = std::clamp(sum[channel], 0.0f, 1.0f);
+    }
+
+    FloatImage decodeImage(const ImageData& image, bool srgb, ThreadPool* threadPool)
+    {
+        const std::array<float, 256>& colorTable = getSrgbDecodeTable();
+
+        FloatImage result{ image.width, image.height };
+        result.texels.resize(image.pixels.size());
+
+        forEachRow(threadPool, image.height, [&](size_t begin, size_t end) {
+            for (size_t offset = begin * image.width * 4; offset < end * image.width * 4; offset += 4) {
+                for (int channel = 0; channel < 3; channel++)
+                    result.texels[offset + channel] = srgb ? colorTable[image.pixels[offset + channel]] : image.pixels[offset + channel] / 255.0f;
+                result.texels[offset + 3] = image.pixels[offset + 3] / 255.0f;
+            }
+        });
+
+        return result;
+    }
+
+    void encodeRow(const float* texels, uint8_t* pixels, uint32_t width, bool srgb)
+    {
+        const std::vector<uint8_t>& colorTable = getSrgbEncodeTable();
+
+        for (uint32_t idx = 0; idx < width * 4; idx++) {
+            if (srgb && idx % 4 != 3)
+                pixels[idx] = colorTable[static_cast<uint32_t>(texels[idx] * (SRGB_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+            else
+                pixels[idx] = static_cast<uint8_t>(texels[idx] * 255.0f + 0.5f);
+        }
+    }
+
+    // Filters source into the next level, keeping both the float texels for the following level and the RGBA8 result
+    FloatImage downsample(const FloatImage& source, MipFilter filter, bool srgb, ThreadPool* threadPool, bool useSimd, ImageData& encoded)
+    {
+        const uint32_t width = std::max(source.width / 2, 1u);
+        const uint32_t height = std::max(source.height / 2, 1u);
+        const FilterBank rowBank = buildFilterBank(source.height, height, filter);
+        const FilterBank columnBank = buildFilterBank(source.width, width, filter);
+
+        // vertical pass first so the horizontal one, which gathers texels, only runs on the reduced rows
+        const size_t sourceRowFloats = size_t{ source.width } * 4;
+        std::vector<float> columns(sourceRowFloats * height);
+        forEachRow(threadPool, height, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; row++)
+                for (uint32_t tap = rowBank.offsets[row]; tap < rowBank.offsets[row + 1]; tap++)
+                    accumulateRow(&columns[row * sourceRowFloats], &source.texels[rowBank.sources[tap] * sourceRowFloats], rowBank.weights[tap], sourceRowFloats, useSimd);
+        });
+
+        FloatImage result{ width, height };
+        result.texels.resize(size_t{ width } * height * 4);
+        encoded = { width, height };
+        encoded.pixels.resize(result.texels.size());
+
+        forEachRow(threadPool, height, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; row++) {
+                float* target = &result.texels[row * width * 4];
+                for (uint32_t column = 0; column < width; column++) {
+                    const uint32_t firstTap = columnBank.offsets[column];
+                    filterTexel(&columns[row * sourceRowFloats], &columnBank.sources[firstTap], &columnBank.weights[firstTap],
+                        columnBank.offsets[column + 1] - firstTap, target + column * 4, useSimd);
+                }
+
+                encodeRow(target, &encoded.pixels[row * width * 4], width, srgb);
+            }
+        });
+
+        return result;
+    }
+}
+
+const char* getMipFilterName(MipFilter filter)
+{
+    return filter == MipFilter::Kaiser ? "kaiser" : "box";
+}
+
+std::optional<MipFilter> findMipFilter(const std::string& name)
+{
+    for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser })
+        if (name == getMipFilterName(filter))
+            return filter;
+
+    return std::nullopt;
+}
+
+const char* getMipSimdName()
+{
+#if defined(MIP_GENERATOR_AVX2)
+    return "AVX2";
+#elif defined(MIP_GENERATOR_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+uint32_t getMipLevelCount(uint32_t width, uint32_t height)
+{
+    return static_cast<uint32_t>(std::bit_width(std::max({ width, height, 1u })));
+}
+
+std::vector<ImageData> generateMipChain(const ImageData& image, bool srgb, MipFilter filter, ThreadPool* threadPool, bool useSimd)
+{
+    const uint32_t levelCount = getMipLevelCount(image.width, image.height);
+
+    std::vector<ImageData> levels(levelCount);
+    levels[0] = image;
+
+    FloatImage previous = decodeImage(image, srgb, threadPool);
+    for (uint32_t level = 1; level < levelCount; level++)
+        previous = downsample(previous, filter, srgb, threadPool, useSimd, levels[level]);
+
+    return levels;
+}
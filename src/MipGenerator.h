@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// RGBA8 pixels of one image or mip level, rows tightly packed
+struct ImageData {
+    uint32_t width{};
+    uint32_t height{};
+    std::vector<uint8_t> pixels{};
+};
+
+// Reconstruction filter used to shrink one level into the next
+enum class MipFilter {
+    Box = 0,    // averages the texels under each destination texel, matches a linear blit
+    Kaiser = 1, // Kaiser windowed sinc, keeps more detail in the smaller levels
+};
+
+const char* getMipFilterName(MipFilter filter);
+std::optional<MipFilter> findMipFilter(const std::string& name);
+
+// Instruction set the filter loops were compiled for: "AVX2", "SSE2" or "scalar"
+const char* getMipSimdName();
+
+// Number of levels in a full mip chain down to 1x1
+uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+// Builds the full mip chain of image, level 0 is a copy of it.
+// Every level is filtered from the one before in floating point, vertically then horizontally,
+// with the rows of each pass split over the thread pool. With srgb set the color channels are
+// filtered in linear space so mips keep their brightness; alpha is always filtered as-is.
+// useSimd = false runs the scalar loops, which produce the same result up to float rounding.
+std::vector<ImageData> generateMipChain(const ImageData& image, bool srgb, MipFilter filter = MipFilter::Box,
+    ThreadPool* threadPool = nullptr, bool useSimd = true);
@@ -0,0 +1,164 @@
+#include "PipelineCache.h"
+
+#include "MappedFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43504750; // "PGPC"
+    constexpr uint32_t PIPELINE_CACHE_VERSION = 1;
+
+    struct PipelineCacheFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t dataSize;
+        uint64_t checksum;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t reserved;
+    };
+
+    // 64-bit FNV-1a, catches truncated and partially overwritten files
+    uint64_t computeChecksum(const std::byte* data, size_t size)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t idx = 0; idx < size; idx++) {
+            hash ^= static_cast<uint64_t>(data[idx]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    bool matchesDevice(uint32_t vendorID, uint32_t deviceID, const uint8_t* uuid, const VkPhysicalDeviceProperties& properties)
+    {
+        return vendorID == properties.vendorID && deviceID == properties.deviceID
+            && memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
+
+const char* PipelineCache::getLoadResultName(LoadResult result)
+{
+    switch (result) {
+    case LoadResult::Disabled: return "disabled";
+    case LoadResult::Loaded: return "warm";
+    case LoadResult::Missing: return "cold, no cache file";
+    case LoadResult::Mismatch: return "cold, cache file from another device or driver";
+    case LoadResult::Corrupt: return "cold, cache file corrupt";
+    }
+    return "unknown";
+}
+
+void PipelineCache::create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path)
+{
+    this->device = device;
+    this->path = path;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    // the mapping only has to live until vkCreatePipelineCache has copied the data
+    MappedFile file{};
+    const std::byte* data{};
+    size_t dataSize{};
+
+    loadResult = LoadResult::Disabled;
+    if (!path.empty()) {
+        loadResult = file.open(path) ? LoadResult::Corrupt : LoadResult::Missing;
+
+        PipelineCacheFileHeader header{};
+        if (file.isOpen() && file.getSize() >= sizeof(header)) {
+            memcpy(&header, file.getData(), sizeof(header));
+
+            const bool complete = header.magic == PIPELINE_CACHE_MAGIC && header.version == PIPELINE_CACHE_VERSION
+                && header.dataSize == file.getSize() - sizeof(header) && header.dataSize >= sizeof(VkPipelineCacheHeaderVersionOne)
+                && header.checksum == computeChecksum(file.getData() + sizeof(header), header.dataSize);
+
+            if (complete) {
+                VkPipelineCacheHeaderVersionOne driverHeader{};
+                memcpy(&driverHeader, file.getData() + sizeof(header), sizeof(driverHeader));
+
+                loadResult = LoadResult::Mismatch;
+                if (header.driverVersion == properties.driverVersion
+                    && matchesDevice(header.vendorID, header.deviceID, header.pipelineCacheUUID, properties)
+                    && driverHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+                    && matchesDevice(driverHeader.vendorID, driverHeader.deviceID, driverHeader.pipelineCacheUUID, properties)) {
+                    data = file.getData() + sizeof(header);
+                    dataSize = header.dataSize;
+                    savedChecksum = header.checksum;
+                    loadResult = LoadResult::Loaded;
+                }
+            }
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = dataSize;
+    cacheInfo.pInitialData = data;
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &cache) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline cache!");
+}
+
+void PipelineCache::destroy()
+{
+    if (cache != VK_NULL_HANDLE)
+        vkDestroyPipelineCache(device, cache, nullptr);
+    cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::save()
+{
+    if (cache == VK_NULL_HANDLE || path.empty())
+        return;
+
+    size_t dataSize{};
+    if (vkGetPipelineCacheData(device, cache, &dataSize, nullptr) != VK_SUCCESS)
+        throw std::runtime_error("failed to query pipeline cache size!");
+
+    std::vector<std::byte> data(dataSize);
+    if (vkGetPipelineCacheData(device, cache, &dataSize, data.data()) != VK_SUCCESS)
+        throw std::runtime_error("failed to read pipeline cache!");
+    data.resize(dataSize);
+
+    const uint64_t checksum = computeChecksum(data.data(), data.size());
+    if (savedChecksum == checksum && std::filesystem::exists(path))
+        return;
+
+    PipelineCacheFileHeader header{};
+    header.magic = PIPELINE_CACHE_MAGIC;
+    header.version = PIPELINE_CACHE_VERSION;
+    header.dataSize = data.size();
+    header.checksum = checksum;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+    // write to a temporary file first so a crash never leaves a half written cache behind
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to create pipeline cache: " + tempPath);
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!file)
+            throw std::runtime_error("failed to write pipeline cache: " + tempPath);
+    }
+
+    std::error_code error{};
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        throw std::runtime_error("failed to replace pipeline cache: " + path);
+    }
+
+    savedChecksum = checksum;
+}
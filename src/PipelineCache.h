@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+
+// VkPipelineCache that persists between launches.
+// Layout: PipelineCacheFileHeader (magic, checksum and size of the data, device identity),
+// followed by the data returned by vkGetPipelineCacheData. A file is only handed to the driver
+// when its checksum matches and both headers, ours and the VkPipelineCacheHeaderVersionOne the
+// data starts with, name this device's vendor, device ID and pipelineCacheUUID; anything else
+// is ignored and the cache starts out empty, so a corrupt or foreign file costs one cold start.
+class PipelineCache {
+public:
+    enum class LoadResult {
+        Disabled,  // no path, the cache lives in memory only
+        Loaded,    // warm: the file matched this device
+        Missing,
+        Mismatch,  // written for another device or driver
+        Corrupt,
+    };
+
+    static const char* getLoadResultName(LoadResult result);
+
+    // Creates the cache from path if it is valid, path may be empty
+    void create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+    void destroy();
+
+    // Atomically rewrites the file if the cache contents changed since they were loaded or last saved.
+    // Throws std::runtime_error if the file cannot be written.
+    void save();
+
+    VkPipelineCache get() const { return cache; }
+    LoadResult getLoadResult() const { return loadResult; }
+
+private:
+    VkDevice device{};
+    VkPipelineCache cache{};
+    std::string path{};
+    VkPhysicalDeviceProperties properties{};
+    LoadResult loadResult{ LoadResult::Disabled };
+    uint64_t savedChecksum{}; // of the data last read or written
+};
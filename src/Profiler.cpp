@@ -0,0 +1,199 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+Profiler::Scope::Scope(Profiler* profiler, const char* name)
+    : profiler{ profiler }
+    , name{ name }
+{
+    if (profiler)
+        start = Clock::now();
+}
+
+Profiler::Scope::~Scope()
+{
+    if (profiler)
+        profiler->addCpuEvent(name, start, Clock::now());
+}
+
+Profiler::Profiler(bool enabled)
+    : enabled{ enabled }
+    , startTime{ Clock::now() }
+    , threads{ std::this_thread::get_id() } // the constructing thread is trace thread 0, "main"
+{
+}
+
+double Profiler::toMicroseconds(Clock::time_point time) const
+{
+    return std::chrono::duration<double, std::micro>(time - startTime).count();
+}
+
+// Must be called with mutex held
+uint32_t Profiler::getThreadIndex()
+{
+    const std::thread::id id = std::this_thread::get_id();
+    auto found = std::find(threads.begin(), threads.end(), id);
+    if (found != threads.end())
+        return static_cast<uint32_t>(found - threads.begin());
+
+    threads.push_back(id);
+    return static_cast<uint32_t>(threads.size() - 1);
+}
+
+void Profiler::addCpuEvent(const char* name, Clock::time_point start, Clock::time_point end)
+{
+    if (!enabled)
+        return;
+
+    const double startUs = toMicroseconds(start);
+    const double durationUs = std::chrono::duration<double, std::micro>(end - start).count();
+
+    std::lock_guard lock{ mutex };
+    events.push_back({ name, startUs, durationUs, getThreadIndex() });
+}
+
+bool Profiler::initGpu(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount)
+{
+    if (!enabled)
+        return false;
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    const uint32_t validBits = families[queueFamily].timestampValidBits;
+    if (validBits == 0)
+        return false;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriodUs = static_cast<double>(properties.limits.timestampPeriod) / 1000.0;
+    timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t{ 1 } << validBits) - 1;
+
+    // two queries per range and frame, plus the calibration query at the end
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = frameCount * MAX_GPU_RANGES * 2 + 1;
+
+    if (vkCreateQueryPool(device, &poolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timestamp query pool!");
+
+    this->device = device;
+    frameRanges.assign(frameCount, {});
+    return true;
+}
+
+void Profiler::destroyGpu()
+{
+    if (queryPool != VK_NULL_HANDLE)
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    queryPool = VK_NULL_HANDLE;
+}
+
+void Profiler::writeCalibration(VkCommandBuffer commandBuffer)
+{
+    if (queryPool == VK_NULL_HANDLE)
+        return;
+
+    const uint32_t query = static_cast<uint32_t>(frameRanges.size()) * MAX_GPU_RANGES * 2;
+    vkCmdResetQueryPool(commandBuffer, queryPool, query, 1);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, query);
+}
+
+void Profiler::finishCalibration()
+{
+    if (queryPool == VK_NULL_HANDLE)
+        return;
+
+    const uint32_t query = static_cast<uint32_t>(frameRanges.size()) * MAX_GPU_RANGES * 2;
+    uint64_t ticks{};
+    if (vkGetQueryPoolResults(device, queryPool, query, 1, sizeof(ticks), &ticks, sizeof(ticks), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+        throw std::runtime_error("failed to read calibration timestamp!");
+
+    calibrationTicks = ticks & timestampMask;
+    calibrationUs = toMicroseconds(Clock::now());
+}
+
+void Profiler::resetGpuFrame(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+    if (queryPool == VK_NULL_HANDLE)
+        return;
+
+    vkCmdResetQueryPool(commandBuffer, queryPool, frame * MAX_GPU_RANGES * 2, MAX_GPU_RANGES * 2);
+    frameRanges[frame].clear();
+}
+
+uint32_t Profiler::beginGpuRange(VkCommandBuffer commandBuffer, uint32_t frame, const char* name)
+{
+    if (queryPool == VK_NULL_HANDLE || frameRanges[frame].size() >= MAX_GPU_RANGES)
+        return NO_RANGE;
+
+    const uint32_t range = static_cast<uint32_t>(frameRanges[frame].size());
+    frameRanges[frame].push_back(name);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, (frame * MAX_GPU_RANGES + range) * 2);
+    return range;
+}
+
+void Profiler::endGpuRange(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t range)
+{
+    if (range == NO_RANGE)
+        return;
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, (frame * MAX_GPU_RANGES + range) * 2 + 1);
+}
+
+void Profiler::collectGpuFrame(uint32_t frame)
+{
+    if (queryPool == VK_NULL_HANDLE || frameRanges[frame].empty())
+        return;
+
+    // the graphics timeline reached the frame's value, so the results are there; a frame that is not complete is dropped
+    const uint32_t queryCount = static_cast<uint32_t>(frameRanges[frame].size()) * 2;
+    std::vector<uint64_t> ticks(queryCount);
+    const VkResult result = vkGetQueryPoolResults(device, queryPool, frame * MAX_GPU_RANGES * 2, queryCount,
+        ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS) {
+        std::lock_guard lock{ mutex };
+        for (size_t range = 0; range < frameRanges[frame].size(); range++) {
+            const uint64_t begin = ticks[range * 2] & timestampMask;
+            const uint64_t end = ticks[range * 2 + 1] & timestampMask;
+            const double startUs = calibrationUs + static_cast<double>(static_cast<int64_t>(begin - calibrationTicks)) * timestampPeriodUs;
+            events.push_back({ frameRanges[frame][range], startUs, static_cast<double>((end - begin) & timestampMask) * timestampPeriodUs, GPU_THREAD });
+        }
+    }
+
+    frameRanges[frame].clear();
+}
+
+void Profiler::writeTrace(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open trace file!");
+
+    std::lock_guard lock{ mutex };
+
+    // CPU threads and the GPU queue are two processes so the viewer shows them as separate groups
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+    file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"GPU\"}},\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":2,\"tid\":0,\"args\":{\"name\":\"graphics queue\"}}";
+    for (uint32_t thread = 0; thread < threads.size(); thread++) {
+        file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\""
+            << (thread == 0 ? "main" : "worker " + std::to_string(thread)) << "\"}}";
+    }
+
+    for (const Event& event : events) {
+        const bool gpu = event.thread == GPU_THREAD;
+        file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":" << (gpu ? 2 : 1) << ",\"tid\":" << (gpu ? 0 : event.thread)
+            << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+    }
+    file << "\n]}\n";
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Instrumentation for --trace: CPU scopes from any thread and GPU timestamp ranges, written
+// together as one Chrome trace event file (chrome://tracing, ui.perfetto.dev).
+// When disabled every call returns right away and no query pool exists.
+// GPU ranges are recorded into the frame's command buffer and read back without waiting once
+// the frame's timeline value has been reached, i.e. when its frame in flight slot comes around again.
+// GPU timestamps are placed on the CPU timeline through one calibration timestamp taken at
+// startup, so GPU events may be shifted by that submission's latency; their durations are exact.
+class Profiler {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    // Adds a CPU event for its lifetime, inactive when the profiler is disabled
+    class Scope {
+    public:
+        Scope(Profiler* profiler, const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Profiler* profiler{};
+        const char* name{};
+        Clock::time_point start{};
+    };
+
+    explicit Profiler(bool enabled = false);
+
+    bool isEnabled() const { return enabled; }
+
+    // name must outlive the profiler, string literals are expected
+    Scope scope(const char* name) { return Scope{ enabled ? this : nullptr, name }; }
+    void addCpuEvent(const char* name, Clock::time_point start, Clock::time_point end);
+
+    // Creates the timestamp query pool for frameCount frames in flight. Returns false, leaving GPU
+    // profiling off, if the queue family does not support timestamps.
+    bool initGpu(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount);
+    void destroyGpu();
+
+    // Records the calibration timestamp; finishCalibration() must follow once commandBuffer completed
+    void writeCalibration(VkCommandBuffer commandBuffer);
+    void finishCalibration();
+
+    // Resets the queries of frame, must be recorded before its first range
+    void resetGpuFrame(VkCommandBuffer commandBuffer, uint32_t frame);
+    // Returns the range to pass to endGpuRange()
+    uint32_t beginGpuRange(VkCommandBuffer commandBuffer, uint32_t frame, const char* name);
+    void endGpuRange(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t range);
+    // Turns the ranges of frame into events, call after its timeline value was waited for
+    void collectGpuFrame(uint32_t frame);
+
+    // Throws std::runtime_error if the file cannot be written
+    void writeTrace(const std::string& path) const;
+
+private:
+    static constexpr uint32_t MAX_GPU_RANGES = 16; // per frame
+    static constexpr uint32_t NO_RANGE = UINT32_MAX;
+
+    struct Event {
+        const char* name{};
+        double startUs{};
+        double durationUs{};
+        uint32_t thread{}; // GPU events use GPU_THREAD
+    };
+    static constexpr uint32_t GPU_THREAD = UINT32_MAX;
+
+    double toMicroseconds(Clock::time_point time) const;
+    uint32_t getThreadIndex();
+
+    bool enabled{};
+    Clock::time_point startTime{};
+
+    mutable std::mutex mutex{};
+    std::vector<Event> events{};
+    std::vector<std::thread::id> threads{}; // index in here is the trace thread id
+
+    VkDevice device{};
+    VkQueryPool queryPool{};
+    double timestampPeriodUs{};
+    uint64_t timestampMask{};
+    std::vector<std::vector<const char*>> frameRanges{}; // names of the ranges recorded per frame
+
+    uint64_t calibrationTicks{};
+    double calibrationUs{};
+};
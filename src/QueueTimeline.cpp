@@ -0,0 +1,120 @@
+#include "QueueTimeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+void QueueTimeline::init(VkDevice device, VkQueue queue)
+{
+    this->device = device;
+    this->queue = queue;
+
+    getSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(device, "vkGetSemaphoreCounterValueKHR");
+    waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(device, "vkWaitSemaphoresKHR");
+    if (getSemaphoreCounterValue == nullptr || waitSemaphores == nullptr)
+        throw std::runtime_error("failed to load timeline semaphore functions!");
+
+    VkSemaphoreTypeCreateInfoKHR typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timeline semaphore!");
+
+    submittedValue = 0;
+    completedValue = 0;
+}
+
+void QueueTimeline::destroy()
+{
+    if (semaphore == VK_NULL_HANDLE)
+        return;
+
+    wait(submittedValue);
+    vkDestroySemaphore(device, semaphore, nullptr);
+    semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t QueueTimeline::submit(std::span<const VkCommandBuffer> commandBuffers, std::span<const Wait> waits,
+    VkSemaphore binaryWait, VkPipelineStageFlags binaryWaitStage, VkSemaphore binarySignal)
+{
+    const uint64_t value = submittedValue + 1;
+
+    // binary semaphores take a value too, it is ignored
+    std::vector<VkSemaphore> waitHandles{};
+    std::vector<uint64_t> waitValues{};
+    std::vector<VkPipelineStageFlags> waitStages{};
+    for (const Wait& wait : waits) {
+        waitHandles.push_back(wait.timeline->getSemaphore());
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stage);
+    }
+    if (binaryWait != VK_NULL_HANDLE) {
+        waitHandles.push_back(binaryWait);
+        waitValues.push_back(0);
+        waitStages.push_back(binaryWaitStage);
+    }
+
+    const VkSemaphore signalSemaphores[] = { semaphore, binarySignal };
+    const uint64_t signalValues[] = { value, 0 };
+    const uint32_t signalCount = binarySignal != VK_NULL_HANDLE ? 2 : 1;
+
+    VkTimelineSemaphoreSubmitInfoKHR timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitHandles.size());
+    submitInfo.pWaitSemaphores = waitHandles.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers = commandBuffers.data();
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit command buffer!");
+
+    stats.submissions++;
+    submittedValue = value;
+    return value;
+}
+
+bool QueueTimeline::isComplete(uint64_t value)
+{
+    if (value <= completedValue)
+        return true;
+
+    uint64_t counter{};
+    if (getSemaphoreCounterValue(device, semaphore, &counter) != VK_SUCCESS)
+        throw std::runtime_error("failed to read timeline semaphore!");
+
+    completedValue = std::max(completedValue, counter);
+    return value <= completedValue;
+}
+
+void QueueTimeline::wait(uint64_t value)
+{
+    if (isComplete(value))
+        return;
+
+    VkSemaphoreWaitInfoKHR waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &semaphore;
+    waitInfo.pValues = &value;
+    if (waitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+        throw std::runtime_error("failed to wait for timeline semaphore!");
+
+    stats.hostWaits++;
+    completedValue = std::max(completedValue, value);
+}
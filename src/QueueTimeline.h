@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <span>
+
+// Submissions to one VkQueue counted by a timeline semaphore (VK_KHR_timeline_semaphore): every submit()
+// signals the next value, so any point on the queue is a single uint64_t that can be kept, polled with
+// isComplete() or waited for with wait() without a fence per submission. Another queue's submission can
+// wait for a value on the GPU, which orders work across queues without a host round trip. Everything that
+// submits to a queue shares its QueueTimeline, which keeps the values in submission order. Like the queue
+// itself it must only be used by one thread at a time.
+class QueueTimeline {
+public:
+    struct Stats {
+        uint64_t submissions{}; // vkQueueSubmit calls
+        uint64_t hostWaits{};   // blocking vkWaitSemaphoresKHR calls
+    };
+
+    // A value of a timeline a submission waits for before its stage starts
+    struct Wait {
+        const QueueTimeline* timeline{};
+        uint64_t value{};
+        VkPipelineStageFlags stage{};
+    };
+
+    void init(VkDevice device, VkQueue queue);
+    // Waits for everything submitted and destroys the semaphore
+    void destroy();
+
+    VkQueue getQueue() const { return queue; }
+    VkSemaphore getSemaphore() const { return semaphore; }
+
+    // Submits commandBuffers once the waits are reached and returns the value signaled when they complete.
+    // The swapchain only takes binary semaphores: binaryWait (before binaryWaitStage) and binarySignal are
+    // added to the same submission when set.
+    uint64_t submit(std::span<const VkCommandBuffer> commandBuffers, std::span<const Wait> waits = {},
+        VkSemaphore binaryWait = VK_NULL_HANDLE, VkPipelineStageFlags binaryWaitStage = 0, VkSemaphore binarySignal = VK_NULL_HANDLE);
+
+    // Value of the most recent submit(), 0 before the first one
+    uint64_t getSubmittedValue() const { return submittedValue; }
+
+    // Polls the semaphore unless value is already known to be reached, never blocks
+    bool isComplete(uint64_t value);
+    // Blocks until the queue has completed the submission that signals value
+    void wait(uint64_t value);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    VkDevice device{};
+    VkQueue queue{};
+    VkSemaphore semaphore{};
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue{};
+    PFN_vkWaitSemaphoresKHR waitSemaphores{};
+
+    uint64_t submittedValue{};
+    uint64_t completedValue{}; // highest value seen reached, saves polling for older ones
+
+    Stats stats{};
+};
@@ -0,0 +1,171 @@
+#include "SceneGraph.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__AVX2__)
+#define SCENE_GRAPH_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_GRAPH_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+    // Levels with fewer nodes are updated on the calling thread, splitting them costs more than it saves
+    constexpr size_t MIN_PARALLEL_NODES = 4096;
+    constexpr size_t NODES_PER_TASK = 1024;
+}
+
+void SceneGraph::reserve(size_t nodeCount)
+{
+    localMatrices.reserve(nodeCount);
+    worldMatrices.reserve(nodeCount);
+    parents.reserve(nodeCount);
+    localDirty.reserve(nodeCount);
+    worldDirty.reserve(nodeCount);
+    depths.reserve(nodeCount);
+}
+
+uint32_t SceneGraph::addNode(const glm::mat4& local, uint32_t parent)
+{
+    const uint32_t node = static_cast<uint32_t>(parents.size());
+    const uint32_t depth = parent == NO_PARENT ? 0 : depths[parent] + 1;
+
+    localMatrices.push_back(local);
+    worldMatrices.push_back(local);
+    parents.push_back(parent);
+    localDirty.push_back(1);
+    worldDirty.push_back(0);
+    depths.push_back(depth);
+
+    if (levels.size() <= depth)
+        levels.resize(depth + 1);
+    levels[depth].push_back(node);
+
+    firstDirtyLevel = dirtyCount == 0 ? depth : std::min<size_t>(firstDirtyLevel, depth);
+    dirtyCount++;
+    return node;
+}
+
+void SceneGraph::setLocal(uint32_t node, const glm::mat4& local)
+{
+    localMatrices[node] = local;
+    if (localDirty[node])
+        return;
+
+    localDirty[node] = 1;
+    firstDirtyLevel = dirtyCount == 0 ? depths[node] : std::min<size_t>(firstDirtyLevel, depths[node]);
+    dirtyCount++;
+}
+
+void SceneGraph::markAllDirty()
+{
+    if (parents.empty())
+        return;
+
+    std::fill(localDirty.begin(), localDirty.end(), uint8_t{ 1 });
+    dirtyCount = parents.size();
+    firstDirtyLevel = 0;
+}
+
+size_t SceneGraph::update(ThreadPool* threadPool, bool useSimd)
+{
+    if (dirtyCount == 0)
+        return 0;
+
+    size_t updated = 0;
+    for (size_t level = firstDirtyLevel; level < levels.size(); level++) {
+        const std::vector<uint32_t>& nodes = levels[level];
+        // the parents of the first level visited are above every dirty node, their flags are from an earlier update
+        const bool parentsMayBeDirty = level > firstDirtyLevel;
+
+        auto updateNodes = [&](size_t begin, size_t end) {
+            for (size_t idx = begin; idx < end; idx++) {
+                const uint32_t node = nodes[idx];
+                const uint32_t parent = parents[node];
+                const bool dirty = localDirty[node] || (parentsMayBeDirty && parent != NO_PARENT && worldDirty[parent]);
+                worldDirty[node] = dirty ? 1 : 0;
+                if (!dirty)
+                    continue;
+
+                localDirty[node] = 0;
+                if (parent == NO_PARENT)
+                    worldMatrices[node] = localMatrices[node];
+                else
+                    multiplyTransforms(worldMatrices[parent], localMatrices[node], worldMatrices[node], useSimd);
+            }
+        };
+
+        if (threadPool != nullptr && nodes.size() >= MIN_PARALLEL_NODES)
+            threadPool->parallelFor(nodes.size(), updateNodes, NODES_PER_TASK);
+        else
+            updateNodes(0, nodes.size());
+
+        // one byte per node, cheaper to count afterwards than to share a counter between the threads
+        for (uint32_t node : nodes)
+            updated += worldDirty[node];
+    }
+
+    dirtyCount = 0;
+    return updated;
+}
+
+// result = parent * local, column major like GLM: every result column is a weighted sum of the
+// parent's columns, weighted by the entries of the local column
+void multiplyTransforms(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result, bool useSimd)
+{
+    if (useSimd) {
+#if defined(SCENE_GRAPH_AVX2)
+        // two result columns per iteration, one in each 128-bit lane
+        const float* a = &parent[0][0];
+        const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+        const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+        const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+        const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+        for (int column = 0; column < 4; column += 2) {
+            const __m256 b = _mm256_loadu_ps(&local[column][0]);
+            __m256 sum = _mm256_mul_ps(a0, _mm256_permute_ps(b, 0x00));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(a1, _mm256_permute_ps(b, 0x55)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(a2, _mm256_permute_ps(b, 0xAA)));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(a3, _mm256_permute_ps(b, 0xFF)));
+            _mm256_storeu_ps(&result[column][0], sum);
+        }
+        return;
+#elif defined(SCENE_GRAPH_SSE2)
+        const __m128 a0 = _mm_loadu_ps(&parent[0][0]);
+        const __m128 a1 = _mm_loadu_ps(&parent[1][0]);
+        const __m128 a2 = _mm_loadu_ps(&parent[2][0]);
+        const __m128 a3 = _mm_loadu_ps(&parent[3][0]);
+        for (int column = 0; column < 4; column++) {
+            const __m128 b = _mm_loadu_ps(&local[column][0]);
+            __m128 sum = _mm_mul_ps(a0, _mm_shuffle_ps(b, b, 0x00));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a1, _mm_shuffle_ps(b, b, 0x55)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_shuffle_ps(b, b, 0xAA)));
+            sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_shuffle_ps(b, b, 0xFF)));
+            _mm_storeu_ps(&result[column][0], sum);
+        }
+        return;
+#endif
+    }
+
+    for (int column = 0; column < 4; column++) {
+        glm::vec4 sum{ 0.0f };
+        for (int k = 0; k < 4; k++)
+            sum += parent[k] * local[column][k];
+        result[column] = sum;
+    }
+}
+
+const char* getTransformSimdName()
+{
+#if defined(SCENE_GRAPH_AVX2)
+    return "AVX2";
+#elif defined(SCENE_GRAPH_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Transform hierarchy stored as structure of arrays: local and world matrices, parents and dirty flags
+// each live in their own array indexed by node. A node's world matrix is its parent's world matrix
+// times its local one. setLocal() only marks the node dirty; update() recomputes the world matrices of
+// dirty nodes and everything below them one hierarchy level at a time, since nodes on the same level
+// never depend on each other, splitting large levels over the thread pool. Levels above the shallowest
+// dirty node are skipped and an update without dirty nodes returns immediately, so static parts of the
+// scene cost nothing per frame.
+class SceneGraph {
+public:
+    static constexpr uint32_t NO_PARENT = UINT32_MAX;
+
+    void reserve(size_t nodeCount);
+
+    // parent has to exist already, which keeps every parent in front of its children
+    uint32_t addNode(const glm::mat4& local, uint32_t parent = NO_PARENT);
+    void setLocal(uint32_t node, const glm::mat4& local);
+    // Recompute every world matrix on the next update(), e.g. to measure a full update
+    void markAllDirty();
+
+    const glm::mat4& getLocal(uint32_t node) const { return localMatrices[node]; }
+    // As of the last update()
+    const glm::mat4& getWorld(uint32_t node) const { return worldMatrices[node]; }
+    uint32_t getParent(uint32_t node) const { return parents[node]; }
+    size_t getNodeCount() const { return parents.size(); }
+    size_t getLevelCount() const { return levels.size(); }
+
+    // Returns the number of world matrices recomputed. useSimd = false multiplies with the scalar loop,
+    // which gives the same result up to float rounding.
+    size_t update(ThreadPool* threadPool = nullptr, bool useSimd = true);
+
+private:
+    std::vector<glm::mat4> localMatrices{};
+    std::vector<glm::mat4> worldMatrices{};
+    std::vector<uint32_t> parents{};
+    std::vector<uint8_t> localDirty{}; // set by setLocal()
+    std::vector<uint8_t> worldDirty{}; // written by update(): recomputed this update
+    std::vector<std::vector<uint32_t>> levels{}; // nodes by depth in the hierarchy, roots first
+    std::vector<uint32_t> depths{};
+    size_t dirtyCount{};
+    size_t firstDirtyLevel{};
+};
+
+// result = parent * local with the SIMD loop update() uses, or the scalar one with useSimd = false
+void multiplyTransforms(const glm::mat4& parent, const glm::mat4& local, glm::mat4& result, bool useSimd = true);
+
+// Instruction set the matrix multiplication was compiled for: "AVX2", "SSE2" or "scalar"
+const char* getTransformSimdName();
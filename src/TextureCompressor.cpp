@@ -0,0 +1,847 @@
+#include "TextureCompressor.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    constexpr uint32_t BLOCK_DIM = 4;
+    constexpr uint32_t BLOCK_TEXELS = BLOCK_DIM * BLOCK_DIM;
+
+    // RGBA texels of one 4x4 block in row-major order
+    using Block = std::array<std::array<uint8_t, 4>, BLOCK_TEXELS>;
+    using BlockIndices = std::array<uint8_t, BLOCK_TEXELS>;
+    using Color = std::array<float, 4>;
+    using PaletteColor = std::array<int, 4>;
+
+    // BC7 interpolation weights for 4-bit indices, out of 64
+    constexpr std::array<int, 16> BC7_WEIGHTS = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    // ASTC 4x4 blocks with a 4x4 weight grid and one partition. Opaque blocks use RGB endpoints and
+    // 3-bit weights, translucent ones RGBA endpoints and 2-bit weights; both leave room for
+    // 8-bit endpoints so no trit or quint packing is needed.
+    constexpr uint32_t ASTC_BLOCK_MODE_WEIGHTS_2BIT = 0x042;
+    constexpr uint32_t ASTC_BLOCK_MODE_WEIGHTS_3BIT = 0x053;
+    constexpr uint32_t ASTC_CEM_LDR_RGB_DIRECT = 8;
+    constexpr uint32_t ASTC_CEM_LDR_RGBA_DIRECT = 12;
+    constexpr std::array<int, 4> ASTC_WEIGHTS_2BIT = { 0, 21, 43, 64 };
+    constexpr std::array<int, 8> ASTC_WEIGHTS_3BIT = { 0, 9, 18, 27, 37, 46, 55, 64 };
+
+    // ETC1/ETC2 intensity modifier pairs (small, large) per table codeword
+    constexpr std::array<std::array<int, 2>, 8> ETC_MODIFIERS = { {
+        { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+    } };
+
+    // EAC alpha modifiers per table index, multiplied by the block's multiplier
+    constexpr std::array<std::array<int, 8>, 16> EAC_MODIFIERS = { {
+        { -3, -6, -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5, -8, -13, 1, 4, 7, 12 },
+        { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 },
+        { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 },
+        { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 },
+        { -2, -5, -8, -10, 1, 4, 7, 9 },
+        { -2, -4, -8, -10, 1, 3, 7, 9 },
+        { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 },
+        { -1, -2, -3, -10, 0, 1, 2, 9 },
+        { -4, -6, -8, -9, 3, 5, 7, 8 },
+        { -3, -5, -7, -9, 2, 4, 6, 8 },
+    } };
+
+    // Writes little-endian bit fields into a zeroed block
+    class BitWriter {
+    public:
+        explicit BitWriter(std::byte* output) : output{ output } {}
+
+        void write(uint32_t value, uint32_t bitCount)
+        {
+            for (uint32_t bit = 0; bit < bitCount; bit++)
+                setBit(position++, (value >> bit) & 1);
+        }
+
+        void setBit(uint32_t bitPosition, uint32_t value)
+        {
+            output[bitPosition / 8] |= static_cast<std::byte>(value << (bitPosition % 8));
+        }
+
+    private:
+        std::byte* output{};
+        uint32_t position{};
+    };
+
+    void storeBigEndian(uint64_t value, std::byte* output)
+    {
+        for (int byte = 0; byte < 8; byte++)
+            output[byte] = static_cast<std::byte>(value >> (56 - byte * 8));
+    }
+
+    void storeLittleEndian(uint64_t value, uint32_t byteCount, std::byte* output)
+    {
+        for (uint32_t byte = 0; byte < byteCount; byte++)
+            output[byte] = static_cast<std::byte>(value >> (byte * 8));
+    }
+
+    Block loadBlock(const ImageData& image, uint32_t blockX, uint32_t blockY)
+    {
+        Block block{};
+        for (uint32_t y = 0; y < BLOCK_DIM; y++) {
+            const uint32_t sourceY = std::min(blockY * BLOCK_DIM + y, image.height - 1);
+            for (uint32_t x = 0; x < BLOCK_DIM; x++) {
+                const uint32_t sourceX = std::min(blockX * BLOCK_DIM + x, image.width - 1);
+                const uint8_t* texel = &image.pixels[(size_t{ sourceY } * image.width + sourceX) * 4];
+                std::copy(texel, texel + 4, block[y * BLOCK_DIM + x].begin());
+            }
+        }
+
+        return block;
+    }
+
+    bool isOpaque(const Block& block)
+    {
+        return std::all_of(block.begin(), block.end(), [](const auto& texel) { return texel[3] == 255; });
+    }
+
+    // Principal axis of the block's colors over the first channelCount channels, by power iteration
+    void fitColorLine(const Block& block, int channelCount, Color& mean, Color& axis)
+    {
+        mean = {};
+        for (const auto& texel : block)
+            for (int channel = 0; channel < channelCount; channel++)
+                mean[channel] += texel[channel] / static_cast<float>(BLOCK_TEXELS);
+
+        float covariance[4][4]{};
+        Color minColor{ 255.0f, 255.0f, 255.0f, 255.0f };
+        Color maxColor{};
+        for (const auto& texel : block) {
+            for (int row = 0; row < channelCount; row++) {
+                minColor[row] = std::min(minColor[row], static_cast<float>(texel[row]));
+                maxColor[row] = std::max(maxColor[row], static_cast<float>(texel[row]));
+                for (int column = 0; column < channelCount; column++)
+                    covariance[row][column] += (texel[row] - mean[row]) * (texel[column] - mean[column]);
+            }
+        }
+
+        // the bounding box diagonal is a good first guess and avoids starting orthogonal to the answer
+        axis = {};
+        for (int channel = 0; channel < channelCount; channel++)
+            axis[channel] = maxColor[channel] - minColor[channel];
+
+        for (int iteration = 0; iteration < 8; iteration++) {
+            Color next{};
+            for (int row = 0; row < channelCount; row++)
+                for (int column = 0; column < channelCount; column++)
+                    next[row] += covariance[row][column] * axis[column];
+
+            float length = 0.0f;
+            for (int channel = 0; channel < channelCount; channel++)
+                length += next[channel] * next[channel];
+
+            length = std::sqrt(length);
+            if (length < 1e-6f) {
+                axis = {};
+                return;
+            }
+
+            for (int channel = 0; channel < channelCount; channel++)
+                axis[channel] = next[channel] / length;
+        }
+    }
+
+    // Endpoints at the extremes of the texels projected onto the fitted line
+    void computeEndpoints(const Block& block, int channelCount, Color& low, Color& high)
+    {
+        Color mean{};
+        Color axis{};
+        fitColorLine(block, channelCount, mean, axis);
+
+        float minProjection = std::numeric_limits<float>::max();
+        float maxProjection = std::numeric_limits<float>::lowest();
+        for (const auto& texel : block) {
+            float projection = 0.0f;
+            for (int channel = 0; channel < channelCount; channel++)
+                projection += (texel[channel] - mean[channel]) * axis[channel];
+
+            minProjection = std::min(minProjection, projection);
+            maxProjection = std::max(maxProjection, projection);
+        }
+
+        low = { 255.0f, 255.0f, 255.0f, 255.0f };
+        high = { 255.0f, 255.0f, 255.0f, 255.0f };
+        for (int channel = 0; channel < channelCount; channel++) {
+            low[channel] = std::clamp(mean[channel] + minProjection * axis[channel], 0.0f, 255.0f);
+            high[channel] = std::clamp(mean[channel] + maxProjection * axis[channel], 0.0f, 255.0f);
+        }
+    }
+
+    // Least squares endpoints for fixed per-texel weights, where a texel is (1 - w) * first + w * second.
+    // Leaves the endpoints untouched and returns false when all texels share one weight.
+    bool refineEndpoints(const Block& block, int channelCount, const std::array<float, BLOCK_TEXELS>& weights, Color& first, Color& second)
+    {
+        float firstSquared = 0.0f;
+        float secondSquared = 0.0f;
+        float cross = 0.0f;
+        Color firstSum{};
+        Color secondSum{};
+
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            const float secondWeight = weights[texel];
+            const float firstWeight = 1.0f - secondWeight;
+
+            firstSquared += firstWeight * firstWeight;
+            secondSquared += secondWeight * secondWeight;
+            cross += firstWeight * secondWeight;
+            for (int channel = 0; channel < channelCount; channel++) {
+                firstSum[channel] += firstWeight * block[texel][channel];
+                secondSum[channel] += secondWeight * block[texel][channel];
+            }
+        }
+
+        const float determinant = firstSquared * secondSquared - cross * cross;
+        if (std::abs(determinant) < 1e-4f)
+            return false;
+
+        for (int channel = 0; channel < channelCount; channel++) {
+            first[channel] = std::clamp((firstSum[channel] * secondSquared - secondSum[channel] * cross) / determinant, 0.0f, 255.0f);
+            second[channel] = std::clamp((secondSum[channel] * firstSquared - firstSum[channel] * cross) / determinant, 0.0f, 255.0f);
+        }
+
+        return true;
+    }
+
+    // Picks the closest palette entry for every texel and returns the summed squared error
+    template<size_t PaletteSize>
+    uint32_t selectIndices(const Block& block, int channelCount, const std::array<PaletteColor, PaletteSize>& palette, BlockIndices& indices)
+    {
+        uint32_t totalError = 0;
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            uint32_t bestError = std::numeric_limits<uint32_t>::max();
+            for (uint32_t entry = 0; entry < PaletteSize; entry++) {
+                uint32_t error = 0;
+                for (int channel = 0; channel < channelCount; channel++) {
+                    const int difference = block[texel][channel] - palette[entry][channel];
+                    error += static_cast<uint32_t>(difference * difference);
+                }
+
+                if (error < bestError) {
+                    bestError = error;
+                    indices[texel] = static_cast<uint8_t>(entry);
+                }
+            }
+
+            totalError += bestError;
+        }
+
+        return totalError;
+    }
+
+    uint16_t packRgb565(const Color& color)
+    {
+        const auto quantize = [](float value, float maxValue) {
+            return static_cast<uint16_t>(std::clamp(std::lround(value * maxValue / 255.0f), 0l, static_cast<long>(maxValue)));
+        };
+
+        return static_cast<uint16_t>(quantize(color[0], 31.0f) << 11 | quantize(color[1], 63.0f) << 5 | quantize(color[2], 31.0f));
+    }
+
+    PaletteColor unpackRgb565(uint16_t color)
+    {
+        const int red = color >> 11;
+        const int green = (color >> 5) & 0x3F;
+        const int blue = color & 0x1F;
+        return { (red << 3) | (red >> 2), (green << 2) | (green >> 4), (blue << 3) | (blue >> 2), 255 };
+    }
+
+    // BC1 color block in four color mode, also the color half of BC3
+    void encodeBc1(const Block& block, std::byte* output)
+    {
+        // interpolation weight of color1 for each index
+        constexpr std::array<float, 4> INDEX_WEIGHTS = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+        Color first{};
+        Color second{};
+        computeEndpoints(block, 3, second, first);
+
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        uint16_t bestColor0{};
+        uint16_t bestColor1{};
+        BlockIndices bestIndices{};
+
+        for (int iteration = 0; iteration < 2; iteration++) {
+            uint16_t color0 = packRgb565(first);
+            uint16_t color1 = packRgb565(second);
+            if (color0 < color1)
+                std::swap(color0, color1);
+
+            // color0 > color1 selects four color mode
+            std::array<PaletteColor, 4> palette{};
+            palette[0] = unpackRgb565(color0);
+            palette[1] = unpackRgb565(color1);
+            for (int channel = 0; channel < 3; channel++) {
+                palette[2][channel] = (2 * palette[0][channel] + palette[1][channel]) / 3;
+                palette[3][channel] = (palette[0][channel] + 2 * palette[1][channel]) / 3;
+            }
+
+            BlockIndices indices{};
+            const uint32_t error = selectIndices(block, 3, palette, indices);
+            if (error < bestError) {
+                bestError = error;
+                bestColor0 = color0;
+                bestColor1 = color1;
+                bestIndices = indices;
+            }
+
+            std::array<float, BLOCK_TEXELS> weights{};
+            for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+                weights[texel] = INDEX_WEIGHTS[indices[texel]];
+
+            if (!refineEndpoints(block, 3, weights, first, second))
+                break;
+        }
+
+        // equal endpoints would select three color mode, where index 3 is black
+        if (bestColor0 == bestColor1)
+            bestIndices.fill(0);
+
+        uint32_t indexBits = 0;
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+            indexBits |= uint32_t{ bestIndices[texel] } << (texel * 2);
+
+        storeLittleEndian(bestColor0, 2, output);
+        storeLittleEndian(bestColor1, 2, output + 2);
+        storeLittleEndian(indexBits, 4, output + 4);
+    }
+
+    // BC3 alpha block (the BC4 layout) in eight value mode spanning the block's alpha range
+    void encodeBc3Alpha(const Block& block, std::byte* output)
+    {
+        int minAlpha = 255;
+        int maxAlpha = 0;
+        for (const auto& texel : block) {
+            minAlpha = std::min(minAlpha, static_cast<int>(texel[3]));
+            maxAlpha = std::max(maxAlpha, static_cast<int>(texel[3]));
+        }
+
+        uint64_t indexBits = 0;
+        if (minAlpha != maxAlpha) {
+            std::array<int, 8> palette{ maxAlpha, minAlpha };
+            for (int entry = 2; entry < 8; entry++)
+                palette[entry] = ((8 - entry) * maxAlpha + (entry - 1) * minAlpha) / 7;
+
+            for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+                uint32_t bestEntry = 0;
+                for (uint32_t entry = 1; entry < palette.size(); entry++)
+                    if (std::abs(block[texel][3] - palette[entry]) < std::abs(block[texel][3] - palette[bestEntry]))
+                        bestEntry = entry;
+
+                indexBits |= uint64_t{ bestEntry } << (texel * 3);
+            }
+        }
+
+        output[0] = static_cast<std::byte>(maxAlpha);
+        output[1] = static_cast<std::byte>(minAlpha);
+        storeLittleEndian(indexBits, 6, output + 2);
+    }
+
+    void encodeBc3(const Block& block, std::byte* output)
+    {
+        encodeBc3Alpha(block, output);
+        encodeBc1(block, output + 8);
+    }
+
+    // BC7 mode 6: one subset, 7-bit RGBA endpoints with a p-bit each and 4-bit indices
+    void encodeBc7(const Block& block, std::byte* output)
+    {
+        Color first{};
+        Color second{};
+        computeEndpoints(block, 4, first, second);
+
+        // opaque blocks need both p-bits set to reach an alpha of exactly 255
+        const int firstPBits = isOpaque(block) ? 3 : 0;
+
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        std::array<std::array<int, 4>, 2> bestEndpoints{};
+        std::array<int, 2> bestPBits{};
+        BlockIndices bestIndices{};
+
+        for (int iteration = 0; iteration < 2; iteration++) {
+            BlockIndices iterationIndices{};
+            uint32_t iterationError = std::numeric_limits<uint32_t>::max();
+
+            // the p-bit is shared by all channels of an endpoint, so try every combination
+            for (int pBits = firstPBits; pBits < 4; pBits++) {
+                const std::array<int, 2> endpointPBits = { pBits & 1, pBits >> 1 };
+
+                std::array<std::array<int, 4>, 2> endpoints{};
+                std::array<PaletteColor, 2> expanded{};
+                for (int channel = 0; channel < 4; channel++) {
+                    const std::array<float, 2> values = { first[channel], second[channel] };
+                    for (int endpoint = 0; endpoint < 2; endpoint++) {
+                        endpoints[endpoint][channel] = std::clamp(static_cast<int>(std::lround((values[endpoint] - endpointPBits[endpoint]) * 0.5f)), 0, 127);
+                        expanded[endpoint][channel] = endpoints[endpoint][channel] << 1 | endpointPBits[endpoint];
+                    }
+                }
+
+                std::array<PaletteColor, 16> palette{};
+                for (uint32_t entry = 0; entry < palette.size(); entry++)
+                    for (int channel = 0; channel < 4; channel++)
+                        palette[entry][channel] = ((64 - BC7_WEIGHTS[entry]) * expanded[0][channel] + BC7_WEIGHTS[entry] * expanded[1][channel] + 32) >> 6;
+
+                BlockIndices indices{};
+                const uint32_t error = selectIndices(block, 4, palette, indices);
+                if (error < iterationError) {
+                    iterationError = error;
+                    iterationIndices = indices;
+                }
+
+                if (error < bestError) {
+                    bestError = error;
+                    bestEndpoints = endpoints;
+                    bestPBits = endpointPBits;
+                    bestIndices = indices;
+                }
+            }
+
+            std::array<float, BLOCK_TEXELS> weights{};
+            for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+                weights[texel] = BC7_WEIGHTS[iterationIndices[texel]] / 64.0f;
+
+            if (!refineEndpoints(block, 4, weights, first, second))
+                break;
+        }
+
+        // the first index is stored without its top bit, which must therefore be zero
+        if (bestIndices[0] >= 8) {
+            std::swap(bestEndpoints[0], bestEndpoints[1]);
+            std::swap(bestPBits[0], bestPBits[1]);
+            for (uint8_t& index : bestIndices)
+                index = static_cast<uint8_t>(15 - index);
+        }
+
+        BitWriter writer{ output };
+        writer.write(1 << 6, 7);
+        for (int channel = 0; channel < 4; channel++) {
+            writer.write(bestEndpoints[0][channel], 7);
+            writer.write(bestEndpoints[1][channel], 7);
+        }
+        writer.write(bestPBits[0], 1);
+        writer.write(bestPBits[1], 1);
+
+        writer.write(bestIndices[0], 3);
+        for (uint32_t texel = 1; texel < BLOCK_TEXELS; texel++)
+            writer.write(bestIndices[texel], 4);
+    }
+
+    // ASTC 4x4, single partition with direct LDR endpoints
+    template<size_t WeightCount>
+    void encodeAstcWithWeights(const Block& block, int channelCount, const std::array<int, WeightCount>& weightTable, uint32_t blockMode, uint32_t endpointMode, std::byte* output)
+    {
+        Color first{};
+        Color second{};
+        computeEndpoints(block, channelCount, first, second);
+
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        std::array<std::array<int, 4>, 2> bestEndpoints{};
+        BlockIndices bestIndices{};
+
+        for (int iteration = 0; iteration < 2; iteration++) {
+            std::array<std::array<int, 4>, 2> endpoints{};
+            for (int channel = 0; channel < 4; channel++) {
+                endpoints[0][channel] = std::clamp(static_cast<int>(std::lround(first[channel])), 0, 255);
+                endpoints[1][channel] = std::clamp(static_cast<int>(std::lround(second[channel])), 0, 255);
+            }
+
+            std::array<PaletteColor, WeightCount> palette{};
+            for (uint32_t entry = 0; entry < WeightCount; entry++)
+                for (int channel = 0; channel < 4; channel++)
+                    palette[entry][channel] = ((64 - weightTable[entry]) * endpoints[0][channel] + weightTable[entry] * endpoints[1][channel] + 32) >> 6;
+
+            BlockIndices indices{};
+            const uint32_t error = selectIndices(block, channelCount, palette, indices);
+            if (error < bestError) {
+                bestError = error;
+                bestEndpoints = endpoints;
+                bestIndices = indices;
+            }
+
+            std::array<float, BLOCK_TEXELS> weights{};
+            for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+                weights[texel] = weightTable[indices[texel]] / 64.0f;
+
+            if (!refineEndpoints(block, channelCount, weights, first, second))
+                break;
+        }
+
+        // decoders swap the endpoints and blue-contract them when the first has the larger RGB sum
+        const int firstSum = bestEndpoints[0][0] + bestEndpoints[0][1] + bestEndpoints[0][2];
+        const int secondSum = bestEndpoints[1][0] + bestEndpoints[1][1] + bestEndpoints[1][2];
+        if (secondSum < firstSum) {
+            std::swap(bestEndpoints[0], bestEndpoints[1]);
+            for (uint8_t& index : bestIndices)
+                index = static_cast<uint8_t>(WeightCount - 1 - index);
+        }
+
+        BitWriter writer{ output };
+        writer.write(blockMode, 11);
+        writer.write(0, 2); // one partition
+        writer.write(endpointMode, 4);
+        for (int channel = 0; channel < channelCount; channel++) {
+            writer.write(bestEndpoints[0][channel], 8);
+            writer.write(bestEndpoints[1][channel], 8);
+        }
+
+        // weights are stored bit-reversed from the top of the block downwards
+        constexpr uint32_t weightBits = std::bit_width(WeightCount - 1);
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++)
+            for (uint32_t bit = 0; bit < weightBits; bit++)
+                writer.setBit(127 - (texel * weightBits + bit), (bestIndices[texel] >> bit) & 1);
+    }
+
+    void encodeAstc(const Block& block, std::byte* output)
+    {
+        if (isOpaque(block))
+            encodeAstcWithWeights(block, 3, ASTC_WEIGHTS_3BIT, ASTC_BLOCK_MODE_WEIGHTS_3BIT, ASTC_CEM_LDR_RGB_DIRECT, output);
+        else
+            encodeAstcWithWeights(block, 4, ASTC_WEIGHTS_2BIT, ASTC_BLOCK_MODE_WEIGHTS_2BIT, ASTC_CEM_LDR_RGBA_DIRECT, output);
+    }
+
+    // Best modifier table and selectors of one ETC subblock around a base color
+    uint32_t fitEtcSubblock(const Block& block, const std::array<uint32_t, 8>& texels, const std::array<int, 3>& base, uint32_t& table, std::array<uint8_t, 8>& selectors)
+    {
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        for (uint32_t candidate = 0; candidate < ETC_MODIFIERS.size(); candidate++) {
+            uint32_t candidateError = 0;
+            std::array<uint8_t, 8> candidateSelectors{};
+
+            for (uint32_t texel = 0; texel < texels.size(); texel++) {
+                uint32_t bestTexelError = std::numeric_limits<uint32_t>::max();
+                for (uint32_t selector = 0; selector < 4; selector++) {
+                    // selectors 0/1 add the small/large modifier, 2/3 subtract them
+                    const int modifier = (selector & 2 ? -1 : 1) * ETC_MODIFIERS[candidate][selector & 1];
+
+                    uint32_t error = 0;
+                    for (int channel = 0; channel < 3; channel++) {
+                        const int difference = block[texels[texel]][channel] - std::clamp(base[channel] + modifier, 0, 255);
+                        error += static_cast<uint32_t>(difference * difference);
+                    }
+
+                    if (error < bestTexelError) {
+                        bestTexelError = error;
+                        candidateSelectors[texel] = static_cast<uint8_t>(selector);
+                    }
+                }
+
+                candidateError += bestTexelError;
+            }
+
+            if (candidateError < bestError) {
+                bestError = candidateError;
+                table = candidate;
+                selectors = candidateSelectors;
+            }
+        }
+
+        return bestError;
+    }
+
+    // ETC2 RGB block restricted to the ETC1 individual and differential modes, which every ETC2 decoder accepts
+    void encodeEtc2Rgb(const Block& block, std::byte* output)
+    {
+        uint32_t bestError = std::numeric_limits<uint32_t>::max();
+        uint64_t bestBits{};
+
+        for (uint32_t flip = 0; flip < 2; flip++) {
+            // flip 0 splits the block into left/right 2x4 halves, flip 1 into top/bottom 4x2 halves
+            std::array<std::array<uint32_t, 8>, 2> subblockTexels{};
+            std::array<uint32_t, 2> subblockSizes{};
+            std::array<std::array<float, 3>, 2> averages{};
+            for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+                const uint32_t x = texel % BLOCK_DIM;
+                const uint32_t y = texel / BLOCK_DIM;
+                const uint32_t subblock = flip ? y / 2 : x / 2;
+
+                subblockTexels[subblock][subblockSizes[subblock]++] = texel;
+                for (int channel = 0; channel < 3; channel++)
+                    averages[subblock][channel] += block[texel][channel] / 8.0f;
+            }
+
+            for (uint32_t differential = 0; differential < 2; differential++) {
+                const int maxValue = differential ? 31 : 15;
+
+                std::array<std::array<int, 3>, 2> quantized{};
+                std::array<std::array<int, 3>, 2> bases{};
+                bool representable = true;
+                for (uint32_t subblock = 0; subblock < 2; subblock++) {
+                    for (int channel = 0; channel < 3; channel++) {
+                        const int value = static_cast<int>(std::lround(averages[subblock][channel] * maxValue / 255.0f));
+                        quantized[subblock][channel] = value;
+                        bases[subblock][channel] = differential ? (value << 3) | (value >> 2) : (value << 4) | value;
+
+                        // the second base is stored as a 3-bit signed delta from the first
+                        const int delta = value - quantized[0][channel];
+                        if (differential && subblock == 1 && (delta < -4 || delta > 3))
+                            representable = false;
+                    }
+                }
+
+                if (!representable)
+                    continue;
+
+                std::array<uint32_t, 2> tables{};
+                std::array<std::array<uint8_t, 8>, 2> selectors{};
+                uint32_t error = 0;
+                for (uint32_t subblock = 0; subblock < 2; subblock++)
+                    error += fitEtcSubblock(block, subblockTexels[subblock], bases[subblock], tables[subblock], selectors[subblock]);
+
+                if (error >= bestError)
+                    continue;
+
+                bestError = error;
+                bestBits = 0;
+                for (int channel = 0; channel < 3; channel++) {
+                    const int shift = 59 - channel * 8;
+                    if (differential) {
+                        const int delta = quantized[1][channel] - quantized[0][channel];
+                        bestBits |= uint64_t(quantized[0][channel]) << shift;
+                        bestBits |= uint64_t(delta & 7) << (shift - 3);
+                    }
+                    else {
+                        bestBits |= uint64_t(quantized[0][channel]) << (shift + 1);
+                        bestBits |= uint64_t(quantized[1][channel]) << (shift - 3);
+                    }
+                }
+
+                bestBits |= uint64_t{ tables[0] } << 37 | uint64_t{ tables[1] } << 34 | uint64_t{ differential } << 33 | uint64_t{ flip } << 32;
+
+                // selector bits are numbered column by column, high bits in the upper half
+                for (uint32_t subblock = 0; subblock < 2; subblock++) {
+                    for (uint32_t texel = 0; texel < 8; texel++) {
+                        const uint32_t index = subblockTexels[subblock][texel];
+                        const uint32_t bit = (index % BLOCK_DIM) * BLOCK_DIM + index / BLOCK_DIM;
+                        const uint32_t selector = selectors[subblock][texel];
+                        bestBits |= uint64_t{ selector >> 1 } << (16 + bit) | uint64_t{ selector & 1 } << bit;
+                    }
+                }
+            }
+        }
+
+        storeBigEndian(bestBits, output);
+    }
+
+    // EAC alpha block of ETC2 RGBA8: base, multiplier and modifier table with 3-bit indices
+    void encodeEacAlpha(const Block& block, std::byte* output)
+    {
+        int minAlpha = 255;
+        int maxAlpha = 0;
+        for (const auto& texel : block) {
+            minAlpha = std::min(minAlpha, static_cast<int>(texel[3]));
+            maxAlpha = std::max(maxAlpha, static_cast<int>(texel[3]));
+        }
+
+        // a flat block uses the table containing a zero modifier
+        int bestBase = minAlpha;
+        int bestMultiplier = 1;
+        uint32_t bestTable = 13;
+        std::array<uint8_t, BLOCK_TEXELS> bestIndices{};
+        bestIndices.fill(4);
+
+        if (minAlpha != maxAlpha) {
+            uint32_t bestError = std::numeric_limits<uint32_t>::max();
+            for (uint32_t table = 0; table < EAC_MODIFIERS.size(); table++) {
+                const std::array<int, 8>& modifiers = EAC_MODIFIERS[table];
+                const float span = static_cast<float>(modifiers[7] - modifiers[3]);
+                const int estimate = static_cast<int>((maxAlpha - minAlpha) / span);
+
+                for (int multiplier = std::max(estimate, 1); multiplier <= std::min(estimate + 1, 15); multiplier++) {
+                    const int base = std::clamp(static_cast<int>(std::lround((minAlpha + maxAlpha - multiplier * (modifiers[3] + modifiers[7])) * 0.5f)), 0, 255);
+
+                    uint32_t error = 0;
+                    std::array<uint8_t, BLOCK_TEXELS> indices{};
+                    for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+                        int bestDifference = std::numeric_limits<int>::max();
+                        for (uint32_t index = 0; index < modifiers.size(); index++) {
+                            const int difference = std::abs(block[texel][3] - std::clamp(base + modifiers[index] * multiplier, 0, 255));
+                            if (difference < bestDifference) {
+                                bestDifference = difference;
+                                indices[texel] = static_cast<uint8_t>(index);
+                            }
+                        }
+
+                        error += static_cast<uint32_t>(bestDifference * bestDifference);
+                    }
+
+                    if (error < bestError) {
+                        bestError = error;
+                        bestBase = base;
+                        bestMultiplier = multiplier;
+                        bestTable = table;
+                        bestIndices = indices;
+                    }
+                }
+            }
+        }
+
+        uint64_t bits = uint64_t(bestBase) << 56 | uint64_t(bestMultiplier) << 52 | uint64_t{ bestTable } << 48;
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            const uint32_t position = (texel % BLOCK_DIM) * BLOCK_DIM + texel / BLOCK_DIM;
+            bits |= uint64_t{ bestIndices[texel] } << (45 - position * 3);
+        }
+
+        storeBigEndian(bits, output);
+    }
+
+    void encodeEtc2Rgba(const Block& block, std::byte* output)
+    {
+        encodeEacAlpha(block, output);
+        encodeEtc2Rgb(block, output + 8);
+    }
+
+    using BlockEncoder = void (*)(const Block& block, std::byte* output);
+
+    BlockEncoder getBlockEncoder(VkFormat format)
+    {
+        switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return encodeBc1;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return encodeBc3;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return encodeBc7;
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            return encodeEtc2Rgb;
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            return encodeEtc2Rgba;
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+            return encodeAstc;
+        default:
+            return nullptr;
+        }
+    }
+}
+
+const char* getTextureCompressionName(TextureCompression compression)
+{
+    switch (compression) {
+    case TextureCompression::Bc7: return "bc7";
+    case TextureCompression::Astc4x4: return "astc";
+    case TextureCompression::Etc2: return "etc2";
+    case TextureCompression::Bc3: return "bc3";
+    case TextureCompression::Bc1: return "bc1";
+    }
+
+    return "unknown";
+}
+
+std::optional<TextureCompression> findTextureCompression(const std::string& name)
+{
+    for (TextureCompression compression : TEXTURE_COMPRESSIONS)
+        if (name == getTextureCompressionName(compression))
+            return compression;
+
+    return std::nullopt;
+}
+
+VkFormat getCompressedFormat(TextureCompression compression, bool hasAlpha, bool srgb)
+{
+    switch (compression) {
+    case TextureCompression::Bc7:
+        return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    case TextureCompression::Astc4x4:
+        return srgb ? VK_FORMAT_ASTC_4x4_SRGB_BLOCK : VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+    case TextureCompression::Etc2:
+        if (hasAlpha)
+            return srgb ? VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+        return srgb ? VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK : VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+    case TextureCompression::Bc3:
+        return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    case TextureCompression::Bc1:
+        return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+
+    return VK_FORMAT_UNDEFINED;
+}
+
+uint32_t getCompressedBlockSize(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+    case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+    case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+    case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+size_t getCompressedLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    const size_t blocksX = (width + BLOCK_DIM - 1) / BLOCK_DIM;
+    const size_t blocksY = (height + BLOCK_DIM - 1) / BLOCK_DIM;
+    return blocksX * blocksY * getCompressedBlockSize(format);
+}
+
+std::string getCompressedTexturePath(const std::string& sourcePath, TextureCompression compression)
+{
+    std::filesystem::path path{ sourcePath };
+    path.replace_extension(std::string(".") + getTextureCompressionName(compression) + ".ktx2");
+    return path.string();
+}
+
+bool hasTranslucentTexels(const ImageData& image)
+{
+    for (size_t offset = 3; offset < image.pixels.size(); offset += 4)
+        if (image.pixels[offset] != 255)
+            return true;
+
+    return false;
+}
+
+std::vector<std::byte> compressImage(const ImageData& image, VkFormat format, ThreadPool* threadPool)
+{
+    const BlockEncoder encoder = getBlockEncoder(format);
+    if (encoder == nullptr)
+        throw std::runtime_error("failed to compress texture, unsupported block format!");
+
+    const uint32_t blockSize = getCompressedBlockSize(format);
+    const uint32_t blocksX = (image.width + BLOCK_DIM - 1) / BLOCK_DIM;
+    const uint32_t blocksY = (image.height + BLOCK_DIM - 1) / BLOCK_DIM;
+
+    std::vector<std::byte> output(getCompressedLevelSize(format, image.width, image.height));
+
+    auto encodeRows = [&](size_t begin, size_t end) {
+        for (size_t blockY = begin; blockY < end; blockY++)
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++)
+                encoder(loadBlock(image, blockX, static_cast<uint32_t>(blockY)), &output[(blockY * blocksX + blockX) * blockSize]);
+    };
+
+    if (threadPool != nullptr)
+        threadPool->parallelFor(blocksY, encodeRows);
+    else
+        encodeRows(0, blocksY);
+
+    return output;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "MipGenerator.h"
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Block compressed encodings written by tools/TextureConverter.cpp.
+// Listed in the order the renderer prefers them when the device can sample several.
+enum class TextureCompression {
+    Bc7 = 0,     // 8 bpp RGBA, desktop GPUs
+    Astc4x4 = 1, // 8 bpp RGBA, mobile GPUs
+    Etc2 = 2,    // 4 bpp RGB, 8 bpp with EAC alpha
+    Bc3 = 3,     // 8 bpp, BC1 color plus interpolated alpha
+    Bc1 = 4,     // 4 bpp opaque RGB, the widest supported fallback
+};
+
+constexpr std::array<TextureCompression, 5> TEXTURE_COMPRESSIONS = {
+    TextureCompression::Bc7,
+    TextureCompression::Astc4x4,
+    TextureCompression::Etc2,
+    TextureCompression::Bc3,
+    TextureCompression::Bc1,
+};
+
+const char* getTextureCompressionName(TextureCompression compression);
+std::optional<TextureCompression> findTextureCompression(const std::string& name);
+
+// Vulkan format an image is encoded to; hasAlpha only matters for ETC2
+VkFormat getCompressedFormat(TextureCompression compression, bool hasAlpha, bool srgb);
+
+// Bytes per 4x4 block, 0 for formats compressImage() cannot produce
+uint32_t getCompressedBlockSize(VkFormat format);
+
+// Size of one level in the given format, rounded up to whole blocks
+size_t getCompressedLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+// "textures/foo.png" -> "textures/foo.bc7.ktx2"
+std::string getCompressedTexturePath(const std::string& sourcePath, TextureCompression compression);
+
+// True if any texel is not fully opaque
+bool hasTranslucentTexels(const ImageData& image);
+
+// Encodes image into 4x4 blocks of format, stored in row-major block order.
+// Edge blocks of sizes that are not a multiple of 4 repeat the last row and column.
+std::vector<std::byte> compressImage(const ImageData& image, VkFormat format, ThreadPool* threadPool = nullptr);
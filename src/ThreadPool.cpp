@@ -0,0 +1,136 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // the thread calling parallelFor does work as well, so it needs one worker less
+    workers.reserve(threadCount - 1);
+    for (uint32_t idx = 1; idx < threadCount; idx++)
+        workers.emplace_back([this]() { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard lock{ mutex };
+        jobs.push_back(std::move(job));
+    }
+    jobAvailable.notify_one();
+}
+
+bool ThreadPool::runQueuedJob()
+{
+    std::function<void()> job{};
+    {
+        std::lock_guard lock{ mutex };
+        if (jobs.empty())
+            return false;
+
+        job = std::move(jobs.front());
+        jobs.pop_front();
+    }
+
+    job();
+    return true;
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> job{};
+        {
+            std::unique_lock lock{ mutex };
+            jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+
+            if (stopping && jobs.empty())
+                return;
+
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        job();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& fn, size_t minRangeSize)
+{
+    if (count == 0)
+        return;
+
+    minRangeSize = std::max<size_t>(minRangeSize, 1);
+    const size_t rangeCount = std::min<size_t>(getThreadCount(), (count + minRangeSize - 1) / minRangeSize);
+
+    if (rangeCount <= 1) {
+        fn(0, count);
+        return;
+    }
+
+    struct SharedState {
+        std::atomic<size_t> nextRange{};
+        std::atomic<size_t> remaining{};
+        std::exception_ptr error{};
+        std::mutex mutex{};
+        std::condition_variable done{};
+    };
+    auto state = std::make_shared<SharedState>();
+    state->remaining = rangeCount;
+
+    // ranges are claimed by whichever thread gets to them first; a job that finds none left returns
+    // without touching fn, which may be gone by then
+    auto runRanges = [state, &fn, count, rangeCount]() {
+        for (size_t rangeIdx = state->nextRange++; rangeIdx < rangeCount; rangeIdx = state->nextRange++) {
+            const size_t begin = count * rangeIdx / rangeCount;
+            const size_t end = count * (rangeIdx + 1) / rangeCount;
+
+            try {
+                fn(begin, end);
+            }
+            catch (...) {
+                std::lock_guard lock{ state->mutex };
+                if (!state->error)
+                    state->error = std::current_exception();
+            }
+
+            if (state->remaining.fetch_sub(1) == 1) {
+                std::lock_guard lock{ state->mutex };
+                state->done.notify_all();
+            }
+        }
+    };
+
+    // one job per range the caller might not get to first
+    for (size_t rangeIdx = 1; rangeIdx < rangeCount; rangeIdx++)
+        enqueue(runRanges);
+
+    // The caller works through the unclaimed ranges itself and then only waits for the ones already
+    // running. It never runs other queued jobs here: an init task picked up in the middle of loadModel()
+    // could block on loadModel()'s own future.
+    runRanges();
+
+    std::unique_lock lock{ state->mutex };
+    state->done.wait(lock, [&]() { return state->remaining == 0; });
+    lock.unlock();
+
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
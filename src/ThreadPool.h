@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads consuming a FIFO job queue.
+// parallelFor() splits a range into contiguous pieces whose boundaries only
+// depend on the range size and thread count, so results written per piece
+// are deterministic no matter which thread ends up running it.
+class ThreadPool {
+public:
+    // threadCount counts the calling thread too; 0 picks one per hardware thread
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads that take part in parallelFor, including the caller
+    uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+    template<typename Function>
+    auto submit(Function&& function) -> std::future<std::invoke_result_t<Function>>
+    {
+        using Result = std::invoke_result_t<Function>;
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+        std::future<Result> future = task->get_future();
+        enqueue([task]() { (*task)(); });
+
+        return future;
+    }
+
+    // Blocks until future (a std::future or std::shared_future of a submitted job) is ready, running queued
+    // jobs in the meantime, so waiting for a job that no worker has picked up yet cannot deadlock.
+    // Any queued job may run inside this call, so no job may wait for one that is waiting on it.
+    // Call get() afterwards to receive the result or exception.
+    template<typename Future>
+    void wait(const Future& future)
+    {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            // nothing left to steal, the job is already running elsewhere
+            if (!runQueuedJob()) {
+                future.wait();
+                return;
+            }
+        }
+    }
+
+    // Calls fn(begin, end) for contiguous pieces of [0, count) and blocks until all are done. While waiting
+    // the caller only runs pieces of this call, never other queued jobs, so it is safe inside any job.
+    // Pieces are never smaller than minRangeSize (except for the tail).
+    // The first exception thrown by any piece is rethrown on the calling thread.
+    void parallelFor(size_t count, const std::function<void(size_t begin, size_t end)>& fn, size_t minRangeSize = 1);
+
+private:
+    void enqueue(std::function<void()> job);
+    // Runs the oldest queued job on the calling thread, returns false if there was none
+    bool runQueuedJob();
+    void workerLoop();
+
+    std::vector<std::thread> workers{};
+    std::deque<std::function<void()>> jobs{};
+    std::mutex mutex{};
+    std::condition_variable jobAvailable{};
+    bool stopping{};
+};
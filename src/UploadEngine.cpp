@@ -0,0 +1,380 @@
+#include "UploadEngine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+void UploadEngine::init(VkDevice device, uint32_t graphicsFamily, QueueTimeline& graphics, uint32_t transferFamily, QueueTimeline& transfer,
+    VkExtent3D transferGranularity)
+{
+    if (transferGranularity.height == 0)
+        throw std::runtime_error("upload transfer family only copies whole image levels!");
+
+    this->device = device;
+    this->graphicsFamily = graphicsFamily;
+    this->graphicsTimeline = &graphics;
+    this->transferFamily = transferFamily;
+    this->transferGranularity = transferGranularity;
+    this->transferTimeline = &transfer;
+
+    // command buffers are recorded once and freed with their batch
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+    poolInfo.queueFamilyIndex = graphicsFamily;
+    if (vkCreateCommandPool(device, &poolInfo, nullptr, &graphicsPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create upload command pool!");
+
+    if (hasDedicatedTransferQueue()) {
+        poolInfo.queueFamilyIndex = transferFamily;
+        if (vkCreateCommandPool(device, &poolInfo, nullptr, &transferPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create upload command pool!");
+    }
+}
+
+void UploadEngine::destroy()
+{
+    if (device == VK_NULL_HANDLE)
+        return;
+
+    wait(submit());
+
+    vkDestroyCommandPool(device, graphicsPool, nullptr);
+    if (transferPool != VK_NULL_HANDLE)
+        vkDestroyCommandPool(device, transferPool, nullptr);
+
+    device = VK_NULL_HANDLE;
+}
+
+void UploadEngine::setStagingBuffer(VkBuffer buffer, void* mapped, VkDeviceSize size)
+{
+    stagingBuffer = buffer;
+    stagingData = static_cast<std::byte*>(mapped);
+    // a multiple of every copy alignment used, so aligned positions stay aligned after wrapping
+    stagingCapacity = size / 256 * 256;
+    stagingHead = 0;
+    stagingTail = 0;
+}
+
+bool UploadEngine::tryAllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+    uint64_t start = alignUp(stagingHead, alignment);
+    const bool wraps = start % stagingCapacity + size > stagingCapacity;
+    if (wraps)
+        start = alignUp(start, stagingCapacity);
+
+    if (start + size - stagingTail > stagingCapacity)
+        return false;
+
+    stats.stagingWraps += wraps ? 1 : 0;
+    stagingHead = start + size;
+    offset = start % stagingCapacity;
+    return true;
+}
+
+void UploadEngine::reclaimStaging()
+{
+    stats.stagingStalls++;
+
+    if (pendingBatches.empty() && openBatch.transferCommands == VK_NULL_HANDLE && openBatch.graphicsCommands == VK_NULL_HANDLE) {
+        // nothing reads the ring anymore
+        stagingTail = stagingHead;
+        return;
+    }
+
+    if (pendingBatches.empty())
+        submit();
+
+    wait(pendingBatches.front().ticket);
+}
+
+void UploadEngine::uploadBuffer(VkBuffer buffer, VkDeviceSize offset, std::span<const std::byte> data)
+{
+    if (stagingCapacity == 0)
+        throw std::runtime_error("upload engine has no staging buffer!");
+
+    // half the ring per chunk, so one chunk can be written while the one before is still being copied
+    const VkDeviceSize maxChunkSize = std::max<VkDeviceSize>(stagingCapacity / 2, 1);
+    for (VkDeviceSize done = 0; done < data.size();) {
+        const VkDeviceSize chunkSize = std::min<VkDeviceSize>(data.size() - done, maxChunkSize);
+
+        VkDeviceSize stagingOffset{};
+        while (!tryAllocateStaging(chunkSize, 16, stagingOffset))
+            reclaimStaging();
+
+        memcpy(stagingData + stagingOffset, data.data() + done, chunkSize);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = stagingOffset;
+        copyRegion.dstOffset = offset + done;
+        copyRegion.size = chunkSize;
+        vkCmdCopyBuffer(getTransferCommands(), stagingBuffer, buffer, 1, &copyRegion);
+
+        stats.operations++;
+        stats.stagingChunks++;
+        stats.stagingBytes += chunkSize;
+        done += chunkSize;
+    }
+}
+
+void UploadEngine::uploadImage(VkImage image, VkExtent2D extent, const std::vector<std::span<const std::byte>>& levels, uint32_t blockSize, uint32_t blockExtent)
+{
+    if (stagingCapacity == 0)
+        throw std::runtime_error("upload engine has no staging buffer!");
+
+    // copy offsets must be multiples of both 4 and the texel block size
+    const VkDeviceSize alignment = std::max<VkDeviceSize>(blockSize, 4);
+    const VkDeviceSize maxChunkSize = std::max<VkDeviceSize>(stagingCapacity / 2, 1);
+
+    std::vector<VkBufferImageCopy> regions{};
+    auto flushRegions = [&]() {
+        if (regions.empty())
+            return;
+
+        vkCmdCopyBufferToImage(getTransferCommands(), stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+        stats.operations++;
+        regions.clear();
+    };
+
+    for (uint32_t level = 0; level < levels.size(); level++) {
+        const uint32_t levelWidth = std::max(extent.width >> level, 1u);
+        const uint32_t levelHeight = std::max(extent.height >> level, 1u);
+        const uint32_t blockRows = (levelHeight + blockExtent - 1) / blockExtent;
+        const VkDeviceSize rowSize = VkDeviceSize{ (levelWidth + blockExtent - 1) / blockExtent } * blockSize;
+        if (rowSize > maxChunkSize)
+            throw std::runtime_error("staging buffer is too small for one texel row!");
+
+        // a piece starts at a multiple of the granularity and ends at one or at the bottom of the level, the
+        // granularity of block compressed formats counts blocks; full rows always satisfy it horizontally
+        const uint32_t granularityRows = transferGranularity.height;
+        uint32_t rowsPerChunk = static_cast<uint32_t>(std::min<VkDeviceSize>(maxChunkSize / rowSize, blockRows));
+        if (rowsPerChunk < blockRows)
+            rowsPerChunk = std::max(rowsPerChunk / granularityRows * granularityRows, std::min(granularityRows, blockRows));
+        if (rowSize * rowsPerChunk > stagingCapacity)
+            throw std::runtime_error("staging buffer is too small for the transfer granularity!");
+
+        for (uint32_t row = 0; row < blockRows; row += rowsPerChunk) {
+            const uint32_t rowCount = std::min(rowsPerChunk, blockRows - row);
+            const VkDeviceSize chunkSize = rowSize * rowCount;
+
+            // the recorded regions read ring space that a submit would hand to the batch, so copy them first
+            VkDeviceSize stagingOffset{};
+            while (!tryAllocateStaging(chunkSize, alignment, stagingOffset)) {
+                flushRegions();
+                reclaimStaging();
+            }
+
+            memcpy(stagingData + stagingOffset, levels[level].data() + rowSize * row, chunkSize);
+
+            VkBufferImageCopy region{};
+            region.bufferOffset = stagingOffset;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = level;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = { 0, static_cast<int32_t>(row * blockExtent), 0 };
+            region.imageExtent = { levelWidth, std::min(rowCount * blockExtent, levelHeight - row * blockExtent), 1 };
+            regions.push_back(region);
+
+            stats.stagingChunks++;
+            stats.stagingBytes += chunkSize;
+        }
+    }
+
+    flushRegions();
+}
+
+VkCommandBuffer UploadEngine::beginCommands(VkCommandPool pool)
+{
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = pool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer{};
+    if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate upload command buffer!");
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+        throw std::runtime_error("failed to begin recording upload command buffer!");
+
+    return commandBuffer;
+}
+
+VkCommandBuffer UploadEngine::getTransferCommands()
+{
+    if (!hasDedicatedTransferQueue())
+        return getGraphicsCommands();
+
+    if (openBatch.transferCommands == VK_NULL_HANDLE)
+        openBatch.transferCommands = beginCommands(transferPool);
+
+    return openBatch.transferCommands;
+}
+
+VkCommandBuffer UploadEngine::getGraphicsCommands()
+{
+    if (openBatch.graphicsCommands == VK_NULL_HANDLE)
+        openBatch.graphicsCommands = beginCommands(graphicsPool);
+
+    return openBatch.graphicsCommands;
+}
+
+void UploadEngine::releaseBuffer(VkBuffer buffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    stats.operations++;
+
+    if (!hasDedicatedTransferQueue()) {
+        vkCmdPipelineBarrier(getGraphicsCommands(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        return;
+    }
+
+    // the release half only makes the writes available, the acquire half makes them visible;
+    // the semaphore between the two submissions orders them
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(getTransferCommands(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(getGraphicsCommands(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void UploadEngine::releaseImage(VkImage image, uint32_t levelCount, VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    stats.operations++;
+
+    if (!hasDedicatedTransferQueue()) {
+        vkCmdPipelineBarrier(getGraphicsCommands(), VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        return;
+    }
+
+    // both halves carry the same layouts, the transition itself happens once between them
+    barrier.srcQueueFamilyIndex = transferFamily;
+    barrier.dstQueueFamilyIndex = graphicsFamily;
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(getTransferCommands(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(getGraphicsCommands(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint64_t UploadEngine::submit()
+{
+    if (openBatch.transferCommands == VK_NULL_HANDLE && openBatch.graphicsCommands == VK_NULL_HANDLE)
+        return submittedTicket;
+
+    Batch batch = std::move(openBatch);
+    openBatch = {};
+    batch.ticket = ++submittedTicket;
+    batch.stagingEnd = stagingHead;
+
+    const bool hasTransferPart = batch.transferCommands != VK_NULL_HANDLE;
+    const bool hasGraphicsPart = batch.graphicsCommands != VK_NULL_HANDLE;
+
+    uint64_t transferValue{};
+    if (hasTransferPart) {
+        vkEndCommandBuffer(batch.transferCommands);
+        transferValue = transferTimeline->submit({ &batch.transferCommands, 1 });
+        batch.timeline = transferTimeline;
+        batch.timelineValue = transferValue;
+        stats.submissions++;
+    }
+
+    if (hasGraphicsPart) {
+        vkEndCommandBuffer(batch.graphicsCommands);
+
+        // the acquire barriers wait on ALL_COMMANDS, see releaseBuffer()
+        const QueueTimeline::Wait transferDone{ transferTimeline, transferValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+        std::span<const QueueTimeline::Wait> waits{};
+        if (hasTransferPart)
+            waits = { &transferDone, 1 };
+
+        batch.timeline = graphicsTimeline;
+        batch.timelineValue = graphicsTimeline->submit({ &batch.graphicsCommands, 1 }, waits);
+        stats.submissions++;
+    }
+
+    stats.batches++;
+    pendingBatches.push_back(std::move(batch));
+    return submittedTicket;
+}
+
+bool UploadEngine::isComplete(uint64_t ticket)
+{
+    collect();
+    return ticket <= completedTicket;
+}
+
+void UploadEngine::wait(uint64_t ticket)
+{
+    while (!pendingBatches.empty() && pendingBatches.front().ticket <= ticket) {
+        Batch& batch = pendingBatches.front();
+        if (!batch.timeline->isComplete(batch.timelineValue)) {
+            batch.timeline->wait(batch.timelineValue);
+            stats.hostWaits++;
+        }
+
+        completedTicket = batch.ticket;
+        release(batch);
+        pendingBatches.pop_front();
+    }
+}
+
+void UploadEngine::collect()
+{
+    while (!pendingBatches.empty() && pendingBatches.front().timeline->isComplete(pendingBatches.front().timelineValue)) {
+        completedTicket = pendingBatches.front().ticket;
+        release(pendingBatches.front());
+        pendingBatches.pop_front();
+    }
+}
+
+void UploadEngine::release(Batch& batch)
+{
+    stagingTail = std::max(stagingTail, batch.stagingEnd);
+
+    if (batch.transferCommands != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(device, transferPool, 1, &batch.transferCommands);
+    if (batch.graphicsCommands != VK_NULL_HANDLE)
+        vkFreeCommandBuffers(device, graphicsPool, 1, &batch.graphicsCommands);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "QueueTimeline.h"
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+// Records asset uploads into batches that are submitted together and tracked by the timeline values of
+// their submissions, see QueueTimeline.
+// Copies go into the transfer command buffer, which runs on a dedicated transfer queue when the
+// device has one; anything that needs the graphics queue (blits, the final layout transitions)
+// goes into the graphics command buffer of the same batch, which waits for the transfer part's
+// timeline value on the GPU.
+// Resources written on the transfer queue are handed over with releaseBuffer()/releaseImage(),
+// which record the queue family ownership transfer on both sides. A batch costs at most two
+// vkQueueSubmit calls no matter how many operations it holds, and nothing idles a queue.
+// Source data goes through one persistently mapped staging ring: every batch owns the ring
+// space written since the previous one and gives it back once its timeline value is reached. Uploads
+// larger than half the ring are split into chunks, waiting for older batches when it is full.
+class UploadEngine {
+public:
+    struct Stats {
+        uint64_t operations{};  // copies, blits and barriers recorded through the engine
+        uint64_t submissions{}; // vkQueueSubmit calls
+        uint64_t batches{};
+        uint64_t hostWaits{};   // waits that blocked on a batch's timeline value
+
+        uint64_t stagingBytes{};  // bytes copied into the staging ring
+        uint64_t stagingChunks{}; // pieces the uploads were split into
+        uint64_t stagingWraps{};  // times the ring wrapped around to offset 0
+        uint64_t stagingStalls{}; // times an upload had to wait for ring space
+    };
+
+    // transferFamily may equal graphicsFamily, then the whole batch is one command buffer on the graphics queue
+    // and transfer may be the same QueueTimeline as graphics. Both are shared with the renderer.
+    // transferGranularity is the minImageTransferGranularity of transferFamily, at least 1 texel high.
+    void init(VkDevice device, uint32_t graphicsFamily, QueueTimeline& graphics, uint32_t transferFamily, QueueTimeline& transfer,
+        VkExtent3D transferGranularity);
+    // Waits for all batches and destroys everything the engine still owns
+    void destroy();
+
+    // Staging ring: a TRANSFER_SRC buffer in host visible, host coherent memory, mapped for its whole
+    // lifetime. It stays owned by the caller, who destroys it after destroy().
+    void setStagingBuffer(VkBuffer buffer, void* mapped, VkDeviceSize size);
+    VkDeviceSize getStagingCapacity() const { return stagingCapacity; }
+
+    bool hasDedicatedTransferQueue() const { return transferFamily != graphicsFamily; }
+
+    // Command buffers of the open batch, begun on first use
+    VkCommandBuffer getTransferCommands();
+    VkCommandBuffer getGraphicsCommands();
+
+    // Counts a command recorded by the caller into one of the command buffers above
+    void countOperation() { stats.operations++; }
+
+    // Copies data to buffer at offset through the staging ring
+    void uploadBuffer(VkBuffer buffer, VkDeviceSize offset, std::span<const std::byte> data);
+
+    // Copies tightly packed levels into image, which must be in TRANSFER_DST_OPTIMAL.
+    // Texels are stored in blockExtent x blockExtent blocks of blockSize bytes (1 and 4 for RGBA8);
+    // levels that do not fit into the ring are split along block rows, in multiples of the transfer granularity.
+    // All pieces that fit into the ring together are copied with one vkCmdCopyBufferToImage.
+    void uploadImage(VkImage image, VkExtent2D extent, const std::vector<std::span<const std::byte>>& levels, uint32_t blockSize, uint32_t blockExtent);
+
+    // Makes the transfer writes to buffer visible to dstStage/dstAccess on the graphics queue
+    void releaseBuffer(VkBuffer buffer, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+    // Same for the first levelCount levels of image, moving them from TRANSFER_DST_OPTIMAL to newLayout
+    void releaseImage(VkImage image, uint32_t levelCount, VkImageLayout newLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    // Submits the open batch and returns its ticket, or the last ticket if nothing was recorded.
+    // Work on the graphics queue submitted afterwards is ordered after the batch, so rendering
+    // does not have to wait for it on the CPU.
+    uint64_t submit();
+
+    bool isComplete(uint64_t ticket);
+    // Blocks until the batch with this ticket and all before it have completed
+    void wait(uint64_t ticket);
+    // Releases the resources of completed batches without blocking
+    void collect();
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Batch {
+        uint64_t ticket{};
+        QueueTimeline* timeline{}; // queue of the batch's last submission
+        uint64_t timelineValue{};  // signaled on it once the whole batch completed
+        VkCommandBuffer transferCommands{};
+        VkCommandBuffer graphicsCommands{};
+        uint64_t stagingEnd{}; // ring position up to which the batch reads staging data
+    };
+
+    VkCommandBuffer beginCommands(VkCommandPool pool);
+    void release(Batch& batch);
+
+    // Reserves size bytes of the ring, returns false without side effects if they are not free yet
+    bool tryAllocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    // Frees ring space by waiting for the oldest batch, submitting the open one first if it is the only one
+    void reclaimStaging();
+
+    VkDevice device{};
+    uint32_t graphicsFamily{};
+    uint32_t transferFamily{};
+    VkExtent3D transferGranularity{ 1, 1, 1 };
+    QueueTimeline* graphicsTimeline{};
+    QueueTimeline* transferTimeline{};
+    VkCommandPool graphicsPool{};
+    VkCommandPool transferPool{};
+
+    Batch openBatch{};
+    std::deque<Batch> pendingBatches{};
+    uint64_t submittedTicket{};
+    uint64_t completedTicket{};
+
+    // positions count bytes written since creation, offset = position % stagingCapacity
+    VkBuffer stagingBuffer{};
+    std::byte* stagingData{};
+    VkDeviceSize stagingCapacity{};
+    uint64_t stagingHead{};
+    uint64_t stagingTail{};
+
+    Stats stats{};
+};
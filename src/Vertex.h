@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Full precision vertex used while loading and processing meshes.
+// What ends up in the vertex buffer is one of the packed layouts in VertexLayout.h.
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 normal; // zero when the mesh was loaded without normals
+    glm::vec2 texCoord;
+    uint32_t material; // 0 without one, else the OBJ material index + 1; keeps faces of different materials apart
+
+    bool operator==(const Vertex& other) const {
+        return pos == other.pos && normal == other.normal && texCoord == other.texCoord && material == other.material;
+    }
+};
+
+namespace detail {
+    inline uint64_t mixHash(uint64_t hash, uint32_t bits)
+    {
+        hash ^= bits;
+        hash *= 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 29);
+    }
+
+    inline uint64_t mixHash(uint64_t hash, float value)
+    {
+        // +0 and -0 compare equal, so they have to hash equal too
+        return mixHash(hash, std::bit_cast<uint32_t>(value == 0.0f ? 0.0f : value));
+    }
+}
+
+// Hashes every component of the vertex with a 64-bit multiply/xor-shift mix and a
+// murmur3 finalizer, so nearby positions and UVs spread over the whole range
+inline uint64_t hashVertex(const Vertex& vertex)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = detail::mixHash(hash, vertex.pos.x);
+    hash = detail::mixHash(hash, vertex.pos.y);
+    hash = detail::mixHash(hash, vertex.pos.z);
+    hash = detail::mixHash(hash, vertex.normal.x);
+    hash = detail::mixHash(hash, vertex.normal.y);
+    hash = detail::mixHash(hash, vertex.normal.z);
+    hash = detail::mixHash(hash, vertex.texCoord.x);
+    hash = detail::mixHash(hash, vertex.texCoord.y);
+    hash = detail::mixHash(hash, vertex.material);
+
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+namespace std {
+    template<> struct hash<Vertex> {
+        size_t operator()(Vertex const& vertex) const {
+            return static_cast<size_t>(hashVertex(vertex));
+        }
+    };
+}
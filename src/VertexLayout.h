@@ -0,0 +1,405 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Vertex buffer layouts described as templates. A layout is a list of attributes, each a
+// semantic plus an encoding; binding/attribute descriptions, the packing code and the GLSL
+// inputs (see tools/VertexLayoutGen.cpp) are all derived from that list, so adding a layout
+// never means hand-writing offsets.
+
+// What an attribute holds; doubles as its shader location
+enum class VertexSemantic : uint32_t {
+    Position = 0,
+    Normal = 1,
+    TexCoord = 2,
+};
+
+// Maps quantized positions back to object space: pos = offset + scale * stored
+struct VertexQuantization {
+    glm::vec3 offset{ 0.0f };
+    glm::vec3 scale{ 1.0f };
+};
+
+namespace vertex_encoding {
+    // float to IEEE half with round to nearest even
+    inline uint16_t floatToHalf(float value)
+    {
+        const uint32_t bits = std::bit_cast<uint32_t>(value);
+        const uint32_t sign = (bits >> 16) & 0x8000;
+        const uint32_t magnitude = bits & 0x7FFFFFFF;
+
+        // inf and nan
+        if (magnitude >= 0x7F800000)
+            return static_cast<uint16_t>(sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0));
+
+        // rounds past the largest half (65504)
+        if (magnitude >= 0x477FF000)
+            return static_cast<uint16_t>(sign | 0x7C00);
+
+        // half denormals, everything below 2^-25 rounds to zero
+        if (magnitude < 0x38800000) {
+            if (magnitude < 0x33000000)
+                return static_cast<uint16_t>(sign);
+
+            const uint32_t mantissa = (magnitude & 0x7FFFFF) | 0x800000;
+            const uint32_t shift = 126 - (magnitude >> 23);
+            uint32_t result = mantissa >> shift;
+            const uint32_t remainder = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if (remainder > halfway || (remainder == halfway && (result & 1)))
+                result++;
+
+            return static_cast<uint16_t>(sign | result);
+        }
+
+        // rebias the exponent, a mantissa carry correctly bumps the exponent
+        uint32_t result = (magnitude - 0x38000000) >> 13;
+        const uint32_t remainder = magnitude & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (result & 1)))
+            result++;
+
+        return static_cast<uint16_t>(sign | result);
+    }
+
+    inline uint16_t toUnorm16(float value)
+    {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    inline int8_t toSnorm8(float value)
+    {
+        return static_cast<int8_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+    }
+
+    // Octahedral mapping of a unit vector onto [-1, 1]^2 (Cigolle et al. 2014)
+    inline glm::vec2 encodeOctahedral(const glm::vec3& direction)
+    {
+        const float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+        if (sum == 0.0f)
+            return glm::vec2(0.0f);
+
+        glm::vec2 projected = glm::vec2(direction) / sum;
+        if (direction.z < 0.0f) {
+            projected = glm::vec2(
+                (1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f));
+        }
+
+        return projected;
+    }
+
+    template<typename T, size_t N>
+    void store(const std::array<T, N>& components, std::byte* dst)
+    {
+        memcpy(dst, components.data(), sizeof(components));
+    }
+}
+
+// Attribute encodings: Vulkan format, byte size/alignment, GLSL input type and the store
+// function. normalized encodings expect positions already mapped to [0, 1] by the quantization.
+// decodeDefine names an extra decoding step the shader has to apply (VERTEX_<SEMANTIC>_<define>).
+struct Float3Encoding {
+    static constexpr VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+    static constexpr uint32_t size = 12;
+    static constexpr uint32_t alignment = 4;
+    static constexpr bool normalized = false;
+    static constexpr const char* glslType = "vec3";
+    static constexpr const char* decodeDefine = nullptr;
+
+    static void store(const glm::vec4& value, std::byte* dst) { vertex_encoding::store(std::array<float, 3>{ value.x, value.y, value.z }, dst); }
+};
+
+struct Float2Encoding {
+    static constexpr VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+    static constexpr uint32_t size = 8;
+    static constexpr uint32_t alignment = 4;
+    static constexpr bool normalized = false;
+    static constexpr const char* glslType = "vec2";
+    static constexpr const char* decodeDefine = nullptr;
+
+    static void store(const glm::vec4& value, std::byte* dst) { vertex_encoding::store(std::array<float, 2>{ value.x, value.y }, dst); }
+};
+
+// Three channels used, the fourth pads to a format every device supports for vertex input
+struct Unorm16x4Encoding {
+    static constexpr VkFormat format = VK_FORMAT_R16G16B16A16_UNORM;
+    static constexpr uint32_t size = 8;
+    static constexpr uint32_t alignment = 2;
+    static constexpr bool normalized = true;
+    static constexpr const char* glslType = "vec4";
+    static constexpr const char* decodeDefine = nullptr;
+
+    static void store(const glm::vec4& value, std::byte* dst)
+    {
+        using vertex_encoding::toUnorm16;
+        vertex_encoding::store(std::array<uint16_t, 4>{ toUnorm16(value.x), toUnorm16(value.y), toUnorm16(value.z), 0 }, dst);
+    }
+};
+
+// Only valid for values inside [0, 1], e.g. non-wrapping UVs
+struct Unorm16x2Encoding {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_UNORM;
+    static constexpr uint32_t size = 4;
+    static constexpr uint32_t alignment = 2;
+    static constexpr bool normalized = false;
+    static constexpr const char* glslType = "vec2";
+    static constexpr const char* decodeDefine = nullptr;
+
+    static void store(const glm::vec4& value, std::byte* dst)
+    {
+        using vertex_encoding::toUnorm16;
+        vertex_encoding::store(std::array<uint16_t, 2>{ toUnorm16(value.x), toUnorm16(value.y) }, dst);
+    }
+};
+
+struct Half2Encoding {
+    static constexpr VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+    static constexpr uint32_t size = 4;
+    static constexpr uint32_t alignment = 2;
+    static constexpr bool normalized = false;
+    static constexpr const char* glslType = "vec2";
+    static constexpr const char* decodeDefine = nullptr;
+
+    static void store(const glm::vec4& value, std::byte* dst)
+    {
+        using vertex_encoding::floatToHalf;
+        vertex_encoding::store(std::array<uint16_t, 2>{ floatToHalf(value.x), floatToHalf(value.y) }, dst);
+    }
+};
+
+// Unit vectors in two snorm8 channels, decoded with decodeOctahedral() in the shader
+struct Octahedral8Encoding {
+    static constexpr VkFormat format = VK_FORMAT_R8G8_SNORM;
+    static constexpr uint32_t size = 2;
+    static constexpr uint32_t alignment = 1;
+    static constexpr bool normalized = false;
+    static constexpr const char* glslType = "vec2";
+    static constexpr const char* decodeDefine = "OCTAHEDRAL";
+
+    static void store(const glm::vec4& value, std::byte* dst)
+    {
+        using vertex_encoding::toSnorm8;
+        glm::vec2 encoded = vertex_encoding::encodeOctahedral(glm::vec3(value));
+        vertex_encoding::store(std::array<int8_t, 2>{ toSnorm8(encoded.x), toSnorm8(encoded.y) }, dst);
+    }
+};
+
+template<VertexSemantic Semantic, typename Encoding_>
+struct VertexAttribute {
+    using Encoding = Encoding_;
+    static constexpr VertexSemantic semantic = Semantic;
+
+    static constexpr const char* getName()
+    {
+        switch (Semantic) {
+        case VertexSemantic::Position: return "Position";
+        case VertexSemantic::Normal: return "Normal";
+        case VertexSemantic::TexCoord: return "TexCoord";
+        }
+        return "";
+    }
+
+    // The value this attribute stores for a vertex, before encoding
+    static glm::vec4 select(const Vertex& vertex, const VertexQuantization& quantization)
+    {
+        if constexpr (Semantic == VertexSemantic::Position) {
+            if constexpr (Encoding::normalized)
+                return glm::vec4((vertex.pos - quantization.offset) / quantization.scale, 0.0f);
+            else
+                return glm::vec4(vertex.pos, 1.0f);
+        }
+        else if constexpr (Semantic == VertexSemantic::Normal) {
+            return glm::vec4(vertex.normal, 0.0f);
+        }
+        else {
+            return glm::vec4(vertex.texCoord, 0.0f, 0.0f);
+        }
+    }
+};
+
+template<typename... Attributes>
+struct VertexLayout {
+    static constexpr uint32_t attributeCount = sizeof...(Attributes);
+
+    static_assert(attributeCount > 0, "a vertex layout needs at least one attribute");
+
+    static constexpr bool hasSemantic(VertexSemantic semantic)
+    {
+        return ((Attributes::semantic == semantic) || ...);
+    }
+
+    static_assert(hasSemantic(VertexSemantic::Position), "every vertex layout needs a position");
+
+    // true when positions are stored relative to a per-mesh VertexQuantization
+    static constexpr bool quantizesPositions = ((Attributes::semantic == VertexSemantic::Position && Attributes::Encoding::normalized) || ...);
+
+private:
+    static constexpr uint32_t alignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Offsets in declaration order, each aligned to its component size as Vulkan requires;
+    // the extra last entry is the unpadded end of the vertex
+    static constexpr std::array<uint32_t, attributeCount + 1> computeOffsets()
+    {
+        std::array<uint32_t, attributeCount + 1> result{};
+        uint32_t offset{};
+        size_t idx{};
+
+        ((offset = alignUp(offset, Attributes::Encoding::alignment), result[idx++] = offset, offset += Attributes::Encoding::size), ...);
+        result[idx] = offset;
+
+        return result;
+    }
+
+    static constexpr std::array<uint32_t, attributeCount + 1> offsets = computeOffsets();
+
+public:
+    static constexpr uint32_t stride = alignUp(offsets[attributeCount], std::max({ Attributes::Encoding::alignment... }));
+
+    static constexpr uint32_t getOffset(size_t attribute) { return offsets[attribute]; }
+
+    static constexpr VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = stride;
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static constexpr std::array<VkVertexInputAttributeDescription, attributeCount> getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, attributeCount> attributeDescriptions{};
+        size_t idx{};
+
+        ((attributeDescriptions[idx] = { static_cast<uint32_t>(Attributes::semantic), 0, Attributes::Encoding::format, offsets[idx] }, idx++), ...);
+
+        return attributeDescriptions;
+    }
+
+    // Writes stride bytes for one vertex
+    static void pack(const Vertex& vertex, const VertexQuantization& quantization, std::byte* dst)
+    {
+        size_t idx{};
+        (Attributes::Encoding::store(Attributes::select(vertex, quantization), dst + offsets[idx++]), ...);
+    }
+
+    // GLSL declarations of the matching vertex shader inputs
+    static std::string getShaderInputs()
+    {
+        std::string source{};
+
+        auto declare = [&source](uint32_t location, const char* glslType, const char* name, const char* decodeDefine) {
+            source += "layout(location = " + std::to_string(location) + ") in " + glslType + " in" + name + ";\n";
+
+            std::string upperName = name;
+            std::transform(upperName.begin(), upperName.end(), upperName.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+
+            source += "#define VERTEX_HAS_" + upperName + " 1\n";
+            if (decodeDefine != nullptr)
+                source += "#define VERTEX_" + upperName + "_" + decodeDefine + " 1\n";
+        };
+
+        (declare(static_cast<uint32_t>(Attributes::semantic), Attributes::Encoding::glslType, Attributes::getName(), Attributes::Encoding::decodeDefine), ...);
+
+        return source;
+    }
+};
+
+// Runtime selector for the layouts below, stored in mesh caches so keep the values stable
+enum class VertexFormat : uint32_t {
+    Float = 0,
+    Packed = 1,
+    PackedHalfUv = 2,
+    PackedNormals = 3,
+};
+
+// The layouts the renderer can use. name selects the vertex shader variant (shaders/vert_<name>.spv).
+struct FloatVertexLayout : VertexLayout<
+    VertexAttribute<VertexSemantic::Position, Float3Encoding>,
+    VertexAttribute<VertexSemantic::TexCoord, Float2Encoding>> {
+    static constexpr const char* name = "float";
+    static constexpr VertexFormat format = VertexFormat::Float;
+};
+
+struct PackedVertexLayout : VertexLayout<
+    VertexAttribute<VertexSemantic::Position, Unorm16x4Encoding>,
+    VertexAttribute<VertexSemantic::TexCoord, Unorm16x2Encoding>> {
+    static constexpr const char* name = "packed";
+    static constexpr VertexFormat format = VertexFormat::Packed;
+};
+
+// For meshes with UVs outside [0, 1]
+struct PackedHalfUvVertexLayout : VertexLayout<
+    VertexAttribute<VertexSemantic::Position, Unorm16x4Encoding>,
+    VertexAttribute<VertexSemantic::TexCoord, Half2Encoding>> {
+    static constexpr const char* name = "packed-half-uv";
+    static constexpr VertexFormat format = VertexFormat::PackedHalfUv;
+};
+
+struct PackedNormalVertexLayout : VertexLayout<
+    VertexAttribute<VertexSemantic::Position, Unorm16x4Encoding>,
+    VertexAttribute<VertexSemantic::TexCoord, Unorm16x2Encoding>,
+    VertexAttribute<VertexSemantic::Normal, Octahedral8Encoding>> {
+    static constexpr const char* name = "packed-normals";
+    static constexpr VertexFormat format = VertexFormat::PackedNormals;
+};
+
+static_assert(FloatVertexLayout::stride == 20);
+static_assert(PackedVertexLayout::stride == 12);
+static_assert(PackedNormalVertexLayout::stride == 14);
+
+// Calls fn with a default constructed instance of the layout type for format
+template<typename Fn>
+decltype(auto) visitVertexLayout(VertexFormat format, Fn&& fn)
+{
+    switch (format) {
+    case VertexFormat::Packed: return fn(PackedVertexLayout{});
+    case VertexFormat::PackedHalfUv: return fn(PackedHalfUvVertexLayout{});
+    case VertexFormat::PackedNormals: return fn(PackedNormalVertexLayout{});
+    case VertexFormat::Float: break;
+    }
+    return fn(FloatVertexLayout{});
+}
+
+// Calls fn once for every layout, in VertexFormat order
+template<typename Fn>
+void forEachVertexLayout(Fn&& fn)
+{
+    fn(FloatVertexLayout{});
+    fn(PackedVertexLayout{});
+    fn(PackedHalfUvVertexLayout{});
+    fn(PackedNormalVertexLayout{});
+}
+
+inline const char* getVertexFormatName(VertexFormat format)
+{
+    return visitVertexLayout(format, [](auto layout) { return decltype(layout)::name; });
+}
+
+inline uint32_t getVertexStride(VertexFormat format)
+{
+    return visitVertexLayout(format, [](auto layout) { return decltype(layout)::stride; });
+}
+
+inline bool hasVertexNormals(VertexFormat format)
+{
+    return visitVertexLayout(format, [](auto layout) { return decltype(layout)::hasSemantic(VertexSemantic::Normal); });
+}
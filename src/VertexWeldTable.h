@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Open-addressing (linear probing) table used to weld identical vertices.
+// Each slot is 8 bytes: the id of the first vertex inserted with a given value
+// and the upper 32 bits of its hash, so most probes are resolved without
+// touching vertex memory. The vertices themselves live outside the table and
+// are fetched through getVertex(id) when the hash tags match.
+// The table is sized up front for the maximum number of insertions and never grows.
+template<typename GetVertex>
+class VertexWeldTable {
+public:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    VertexWeldTable(size_t maxVertexCount, GetVertex getVertex)
+        : getVertex{ getVertex }
+    {
+        // keep the load factor at or below 50%
+        const size_t capacity = std::bit_ceil(std::max<size_t>(maxVertexCount * 2, 16));
+        slots.assign(capacity, Slot{ EMPTY, 0 });
+        mask = capacity - 1;
+    }
+
+    // Returns the id of a previously inserted vertex equal to 'vertex',
+    // or inserts 'vertex' under 'id' and returns 'id'
+    uint32_t findOrInsert(const Vertex& vertex, uint64_t hash, uint32_t id)
+    {
+        const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+
+        for (size_t slotIdx = static_cast<size_t>(hash) & mask; ; slotIdx = (slotIdx + 1) & mask)
+        {
+            Slot& slot = slots[slotIdx];
+
+            if (slot.id == EMPTY) {
+                slot = { id, tag };
+                return id;
+            }
+
+            if (slot.tag == tag && getVertex(slot.id) == vertex)
+                return slot.id;
+        }
+    }
+
+private:
+    struct Slot {
+        uint32_t id;
+        uint32_t tag;
+    };
+
+    std::vector<Slot> slots{};
+    size_t mask{};
+    GetVertex getVertex;
+};
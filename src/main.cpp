@@ -2,10 +2,6 @@
 #include <GLFW/glfw3.h>
 #include <GLFW/glfw3native.h>
 
-#define GLM_FORCE_RADIANS
-#define GLM_FORCE_DEPTH_ZERO_TO_ONE
-#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
-#define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/hash.hpp>
@@ -13,11 +9,37 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
+#define VMA_IMPLEMENTATION
+#include <vk_mem_alloc.h>
+
 #undef max
 
+#include "AppConfig.h"
+#include "Benchmark.h"
+#include "DepthPyramid.h"
+#include "DrawList.h"
+#include "FrameBenchmark.h"
+#include "GpuCulling.h"
+#include "Ktx2Texture.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MipGenerator.h"
+#include "PipelineCache.h"
+#include "Profiler.h"
+#include "QueueTimeline.h"
+#include "SceneGraph.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+#include "UploadEngine.h"
+#include "Vertex.h"
+
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
@@ -31,15 +53,22 @@
 #include <limits>
 #include <optional>
 #include <set>
+#include <span>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <numeric>
 
 const uint32_t WIDTH = 800;
 const uint32_t HEIGHT = 600;
 
-const std::string MODEL_PATH = "./models/viking_room.obj";
-const std::string TEXTURE_PATH = "./textures/viking_room.png";
+// vertex and index buffers are filled by copies and copied out again when defragmenting
+const VkBufferUsageFlags GEOMETRY_BUFFER_USAGE = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// --pipeline-stats: triangles, vertex shader invocations (ACMR) and fragment shader invocations (what culling saves)
+const VkQueryPipelineStatisticFlags STATISTICS_QUERY_FLAGS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
 
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -49,6 +78,39 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+// Needed in every mode, headless included: the material textures are one partially bound array
+const std::vector<const char*> bindlessDeviceExtensions = {
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+};
+
+// Needed in every mode: frames and uploads are synchronized with one timeline semaphore per queue
+const std::vector<const char*> timelineDeviceExtensions = {
+    VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME
+};
+
+// Optional, let --low-latency wait for the previous frame to be presented and measure when frames are shown
+const std::vector<const char*> presentWaitDeviceExtensions = {
+    VK_KHR_PRESENT_ID_EXTENSION_NAME,
+    VK_KHR_PRESENT_WAIT_EXTENSION_NAME
+};
+
+// Vulkan present mode of every --present-mode but auto
+const std::array<std::pair<PresentMode, VkPresentModeKHR>, 4> vulkanPresentModes = { {
+    { PresentMode::Fifo, VK_PRESENT_MODE_FIFO_KHR },
+    { PresentMode::FifoRelaxed, VK_PRESENT_MODE_FIFO_RELAXED_KHR },
+    { PresentMode::Mailbox, VK_PRESENT_MODE_MAILBOX_KHR },
+    { PresentMode::Immediate, VK_PRESENT_MODE_IMMEDIATE_KHR },
+} };
+
+// The instance's version, vkGetPhysicalDeviceFeatures2 for the descriptor indexing features
+const uint32_t VULKAN_API_VERSION = VK_API_VERSION_1_1;
+
+// Upper bound of the texture array in shader.frag, lowered to what the device allows per stage
+const uint32_t MAX_BINDLESS_TEXTURES = 1024;
+
+// Draw lists with fewer objects are keyed on the main thread, splitting them costs more than it saves
+const size_t MIN_PARALLEL_DRAW_KEYS = 4096;
+
 #ifdef NDEBUG
 const bool enableValidationLayers = false;
 #else
@@ -75,6 +137,8 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily{};
     std::optional<uint32_t> presentFamily{};
+    std::optional<uint32_t> transferFamily{}; // preferably a transfer-only family, otherwise the graphics one
+    VkExtent3D transferGranularity{ 1, 1, 1 }; // minImageTransferGranularity of transferFamily
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -87,67 +151,47 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes{};
 };
 
-struct Vertex {
-    glm::vec3 pos;
-    glm::vec3 color;
-    glm::vec2 texCoord;
-
-    static VkVertexInputBindingDescription getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
-
-        attributeDescriptions[0].binding = 0;
-        attributeDescriptions[0].location = 0;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-        attributeDescriptions[1].binding = 0;
-        attributeDescriptions[1].location = 1;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-        attributeDescriptions[2].binding = 0;
-        attributeDescriptions[2].location = 2;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+// Per object data in the object storage buffer, indexed by gl_InstanceIndex in shader.vert
+struct ObjectData {
+    alignas(16) glm::mat4 model;
+};
 
-        return attributeDescriptions;
-    }
+// Per draw data of --draw-data push and dynamic, the PushConstants and DrawData blocks in shader.vert
+struct DrawData {
+    alignas(16) glm::mat4 mvp;
+    alignas(4) uint32_t objectIndex;
+};
 
-    bool operator==(const Vertex& other) const {
-        return pos == other.pos && color == other.color && texCoord == other.texCoord;
-    }
+// One entry of the material storage buffer, Material in shader.frag
+struct MaterialData {
+    alignas(16) glm::vec4 baseColor;
+    alignas(4) uint32_t textureIndex; // into the texture array, NO_TEXTURE for an untextured material
 };
 
-namespace std {
-    template<> struct hash<Vertex> {
-        size_t operator()(Vertex const& vertex) const {
-            return  ((hash<glm::vec3>()(vertex.pos) ^
-                    (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                    (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
+const uint32_t NO_TEXTURE = UINT32_MAX;
 
 struct UniformBufferObject {
     alignas(16) glm::mat4 model;
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
+    alignas(16) glm::mat4 viewProj; // proj * view, so the vertex shader does not multiply matrices
+    alignas(16) glm::vec4 positionOffset; // dequantization of packed positions, see VertexQuantization
+    alignas(16) glm::vec4 positionScale;
 };
 
 class HelloTriangleApplication {
 public:
+    explicit HelloTriangleApplication(const AppConfig& config)
+        : config{ config }
+    {
+    }
+
     void run() 
     {
-		initWindow();
+        launchTime = std::chrono::high_resolution_clock::now();
+
+        if (!config.headless)
+            initWindow();
         initVulkan();
         mainLoop();
         cleanup();
@@ -158,6 +202,12 @@ private:
     // Private class variables
     // =======================
 
+    AppConfig config{};
+    ThreadPool threadPool{ config.workerThreads };
+    std::chrono::high_resolution_clock::time_point launchTime{};
+    double timeToFirstFrameMs{}; // run() to the return of the first drawFrame
+    Profiler profiler{ !config.tracePath.empty() };
+
     GLFWwindow* window{};
 
     VkInstance instance{};
@@ -170,58 +220,211 @@ private:
     
     VkQueue graphicsQueue{};
     VkQueue presentQueue{};
+    VkQueue transferQueue{};
 
+    // --headless renders into one offscreen image per frame in flight instead of swapchain images
     VkSwapchainKHR swapChain{};
     std::vector<VkImage> swapChainImages{};
+    std::vector<VmaAllocation> offscreenImageAllocations{};
     VkFormat swapChainImageFormat{};
     VkExtent2D swapChainExtent{};
     std::vector<VkImageView> swapChainImageViews{};
     std::vector<VkFramebuffer> swapChainFramebuffers{};
 
     VkRenderPass renderPass{};
+    PipelineCache pipelineCache{};
     VkDescriptorSetLayout descriptorSetLayout{};
     VkPipelineLayout pipelineLayout{};
     VkPipeline graphicsPipeline{};
 
+    // every buffer and image is suballocated from VMA blocks, vertex and index buffers from
+    // geometryPool so they can be defragmented without touching anything else
+    VmaAllocator allocator{};
+    VmaPool geometryPool{};
+    uint64_t memoryAllocationCount{}; // vkAllocateMemory calls made by VMA
+    uint64_t uploadAllocationBase{};
+
     VkCommandPool commandPool{};
+    UploadEngine uploadEngine{};
+    VkBuffer stagingBuffer{};
+    VmaAllocation stagingAllocation{};
 
     VkImage colorImage{};
-    VkDeviceMemory colorImageMemory{};
+    VmaAllocation colorImageAllocation{};
     VkImageView colorImageView{};
 
     VkImage depthImage{};
-    VkDeviceMemory depthImageMemory{};
+    VmaAllocation depthImageAllocation{};
     VkImageView depthImageView{};
 
+    // filled in by loadTextureData() on a worker, consumed and released by createTextureImage()
+    std::vector<Ktx2Texture> textureCandidates{}; // mapped KTX2 files in order of preference
+    ImageData textureSource{};                    // decoded source image, if needed
+    std::vector<ImageData> textureMipChain{};     // its CPU mip chain with --cpu-mips
+
     uint32_t mipLevels{};
+    const char* textureMipSource{ "" }; // how the mip chain was built, for the load report
+    VkFormat textureFormat{ VK_FORMAT_R8G8B8A8_SRGB };
+    VkExtent2D textureExtent{};
     VkImage textureImage{};
-    VkDeviceMemory textureImageMemory{};
+    VmaAllocation textureImageAllocation{};
     VkImageView textureImageView{};
 	VkSampler textureSampler{};
 
-    std::vector<Vertex> vertices{};
-    std::vector<uint32_t> indices{};
+    // Bindless materials: the fragment shader looks up the material of its vertex (Vertex::material, from
+    // vertexMaterialBuffer) in materialBuffer and samples textures[material.textureIndex] from one
+    // partially bound descriptor array. Material 0 and texture 0 are the --texture image, used by faces
+    // without a material; the OBJ materials and their textures follow. The whole scene needs one set bind.
+    struct MaterialTexture {
+        VkImage image{};
+        VmaAllocation allocation{};
+        VkImageView view{};
+    };
+    std::vector<MeshMaterial> meshMaterials{};
+    std::span<const uint16_t> vertexMaterialData{}; // views modelData or the meshCache like vertexData
+    std::vector<uint32_t> materialTextureIndices{}; // texture of every mesh material, or NO_TEXTURE
+    std::vector<std::vector<ImageData>> materialTextureMips{}; // filled in by loadMaterialTextureData() on a worker
+    std::vector<MaterialTexture> materialTextures{}; // texture i + 1
+    uint32_t bindlessTextureCapacity{};
+    VkBuffer materialBuffer{};
+    VmaAllocation materialBufferAllocation{};
+    VkBuffer vertexMaterialBuffer{};
+    VmaAllocation vertexMaterialBufferAllocation{};
+
+    // vertexData/indexData view either the packed modelData or the mapped meshCache
+    PackedMesh modelData{};
+    MeshCache meshCache{};
+    VertexFormat vertexFormat{ VertexFormat::Float };
+    VertexQuantization vertexQuantization{};
+    std::span<const std::byte> vertexData{};
+    std::span<const std::byte> indexData{};
+    VkIndexType indexType{ VK_INDEX_TYPE_UINT32 };
+    std::vector<MeshLod> meshLods{};
+    glm::vec4 meshBoundingSphere{ 0.0f };
     VkBuffer vertexBuffer{};
-    VkDeviceMemory vertexBufferMemory{};
+    VmaAllocation vertexBufferAllocation{};
     VkBuffer indexBuffer{};
-    VkDeviceMemory indexBufferMemory{};
+    VmaAllocation indexBufferAllocation{};
 
     std::vector<VkBuffer> uniformBuffers{};
-    std::vector<VkDeviceMemory> uniformBuffersMemory{};
+    std::vector<VmaAllocation> uniformBuffersAllocation{};
     std::vector<void*> uniformBuffersMapped{};
+    UniformBufferObject frameUniforms{}; // last values written by updateUniformBuffer
 
     VkDescriptorPool descriptorPool{};
     std::vector<VkDescriptorSet> descriptorSets{};
 
     std::vector<VkCommandBuffer> commandBuffers{};
 
+    // --record-threads: a command pool and secondary command buffer per slice of the draw list and frame in
+    // flight, indexed [frame][slice]. A slice is only ever recorded by one thread at a time, so no pool is shared
+    // and each one is reset as a whole by the thread that records into it.
+    std::vector<std::vector<VkCommandPool>> secondaryCommandPools{};
+    std::vector<std::vector<VkCommandBuffer>> secondaryCommandBuffers{};
+
+    // Transforms of the scene: the spin every copy of the model applies (ubo.model), the camera and the
+    // objects below gridNode. Updated once per frame by updateUniformBuffer(); the objects are static, so
+    // only the spin and the camera are recomputed.
+    SceneGraph scene{};
+    uint32_t spinNode{};
+    uint32_t cameraNode{};
+    uint32_t gridNode{};
+    std::chrono::high_resolution_clock::time_point animationStartTime{};
+
+    // Copies of the model drawn every frame, their world matrices taken from the scene by createScene(). The
+    // shader reads them from objectBuffer, a draw of object i passes i as its first instance.
+    std::vector<ObjectData> objects{};
+    float sceneScale{ 1.0f }; // radius of the whole scene relative to one model, moves the camera back
+    float sceneRadius{};      // bounds every object around the origin, whichever way it has spun
+    VkBuffer objectBuffer{};
+    VmaAllocation objectBufferAllocation{};
+
+    // --draw-data; Storage whenever the draws are instanced or GPU culled. DynamicUniform writes the
+    // DrawData of object i in frame f to slot f * drawDataCapacity + i of the persistently mapped ring.
+    DrawDataMode drawDataMode{};
+    VkBuffer drawDataBuffer{};
+    VmaAllocation drawDataBufferAllocation{};
+    std::byte* drawDataMapped{};
+    VkDeviceSize drawDataStride{}; // sizeof(DrawData) rounded up to minUniformBufferOffsetAlignment
+    size_t drawDataCapacity{};
+
+    // --gpu-culling, left off when the device cannot draw with the object index as first instance
+    bool gpuCullingEnabled{};
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount{}; // VK_KHR_draw_indirect_count if available
+    GpuCulling gpuCulling{};
+    uint64_t visibleObjects{};
+    uint64_t frustumCulledObjects{};
+    uint64_t occlusionCulledObjects{};
+    uint32_t cullingFrameCount{};
+
+    // --occlusion-culling, left off when the depth format cannot be sampled. The second phase draws with
+    // occlusionRenderPass, which loads what renderPass left behind.
+    bool occlusionCullingEnabled{};
+    VkRenderPass occlusionRenderPass{};
+    DepthPyramid depthPyramid{};
+
     std::vector<VkSemaphore> imageAvailableSemaphores{};
     std::vector<VkSemaphore> renderFinishedSemaphores{};
-    std::vector<VkFence> inFlightFences{};
+    // One counter per queue, see QueueTimeline.h. The culling and depth pyramid compute passes are recorded
+    // into the frame's command buffer and count on the graphics timeline; transferTimeline is only used when
+    // the device has a dedicated transfer queue. A frame in flight waits for the graphics value its last
+    // submission signaled instead of a fence.
+    QueueTimeline graphicsTimeline{};
+    QueueTimeline transferTimeline{};
+    std::vector<uint64_t> frameTimelineValues{};
     uint32_t currentFrame{};
+    uint32_t lastImageIndex{}; // image the most recent frame was rendered into
+    FrameTiming frameTiming{}; // filled in by drawFrame, see FrameBenchmark
+
+    // --present-mode as the swapchain was created with it, never Auto
+    PresentMode presentMode{};
+
+    // Latency of a frame, from sampleInput() to the frame being presented. With VK_KHR_present_id and
+    // VK_KHR_present_wait every present carries the next presentId and waits in pendingPresents until
+    // waitForPresent() reports it shown; without them (or headless) a frame ends when its timeline value is waited for.
+    bool presentWaitEnabled{};
+    PFN_vkWaitForPresentKHR waitForPresent{};
+    uint64_t presentId{};
+    std::deque<std::pair<uint64_t, std::chrono::high_resolution_clock::time_point>> pendingPresents{};
+    std::chrono::high_resolution_clock::time_point inputSampleTime{}; // of the frame being recorded
+    std::vector<std::optional<std::chrono::high_resolution_clock::time_point>> frameInputSampleTimes{}; // per frame in flight, without present wait
+    double latencyMs{};
+    uint64_t latencySampleCount{};
 
     bool framebufferResized{};
 
+    // --pipeline-stats: measured vertex and fragment shader invocations, accumulated over all frames
+    bool pipelineStatisticsSupported{};
+    bool inheritedQueriesSupported{}; // needed to count the draws recorded into secondary command buffers
+    VkQueryPool statisticsQueryPool{};
+    std::vector<bool> statisticsQueryWritten{};
+    uint64_t statisticsPrimitives{};
+    uint64_t vertexShaderInvocations{};
+    uint64_t fragmentShaderInvocations{};
+    uint32_t statisticsFrameCount{};
+
+    // Triangles, draw calls, objects per LOD and command recording time, accumulated over all frames
+    uint64_t submittedTriangles{};
+    uint64_t submittedDraws{};
+    uint64_t renderedFrameCount{};
+    std::vector<uint64_t> lodObjectCounts{};
+    double recordTimeMs{};
+    uint64_t bindsIssued{};
+    uint64_t bindsAvoided{};
+
+    // Triangles, draw calls and objects per LOD of one recordDraws() call. Every slice fills its own,
+    // they are added to the totals above once recording has finished.
+    struct DrawStats {
+        uint64_t triangles{};
+        uint64_t draws{};
+        std::vector<uint64_t> lodCounts{};
+        uint64_t bindsIssued{};
+        uint64_t bindsAvoided{};
+    };
+
+    // The one-draw-per-object path draws the objects in this order, rebuilt every frame by buildDrawList()
+    DrawList drawList{};
+
     // =======================
     // Private class Functions
 	// =======================
@@ -243,6 +446,46 @@ private:
         glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
     }
 
+    // Runs step on a worker thread as part of initVulkan(), or right away with --serial-init.
+    // Every task is added to tasks so initVulkan() can wait for all of them if startup fails.
+    std::shared_future<void> startInitTask(std::vector<std::shared_future<void>>& tasks, const char* name, std::function<void()> step)
+    {
+        auto task = [this, name, step = std::move(step)]() {
+            Profiler::Scope scope = profiler.scope(name);
+            step();
+        };
+
+        std::shared_future<void> future{};
+        if (config.serialInit) {
+            // a packaged_task keeps a throwing step's exception in the future, like a pool job does
+            std::packaged_task<void()> serialTask(std::move(task));
+            future = serialTask.get_future().share();
+            serialTask();
+        }
+        else {
+            future = threadPool.submit(std::move(task)).share();
+        }
+
+        tasks.push_back(future);
+        return future;
+    }
+
+    // Waits for a task from startInitTask() and rethrows what it threw
+    void waitForInitTask(const std::shared_future<void>& task)
+    {
+        threadPool.wait(task);
+        task.get();
+    }
+
+    // Runs initialization steps in order on the calling thread, each one a CPU scope in the --trace output
+    void runInitSteps(std::initializer_list<std::pair<const char*, void (HelloTriangleApplication::*)()>> steps)
+    {
+        for (const auto& [name, step] : steps) {
+            Profiler::Scope scope = profiler.scope(name);
+            (this->*step)();
+        }
+    }
+
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height) 
     {
         auto app = reinterpret_cast<HelloTriangleApplication*>(glfwGetWindowUserPointer(window));
@@ -251,42 +494,262 @@ private:
 
     void initVulkan() 
     {
-        createInstance();
-        setupDebugMessenger();
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapChain();
-        createImageViews();
-        createRenderPass();
-        createDescriptorSetLayout();
-        createGraphicsPipeline();
-        createCommandPool();
-        createColorResources();
-        createDepthResources();
-        createFramebuffers();
-        createTextureImage();
-        createTextureImageView();
-        createTextureSampler();
-        loadModel();
-        createVertexBuffer();
-        createIndexBuffer();
-        createUniformBuffers();
-        createDescriptorPool();
-        createDescriptorSets();
-        createCommandBuffers();
-        createSyncObjects();
+        // Startup is a small dependency graph instead of one chain: the asset loaders need no Vulkan objects and
+        // start on workers right away, the pipeline compiles on a worker once the vertex format is known, and the
+        // main thread creates the device objects meanwhile. Uploads are recorded once the data and device exist.
+        // --serial-init runs every task where it is started, which is the old order for comparison.
+        using App = HelloTriangleApplication;
+        std::vector<std::shared_future<void>> tasks{};
+
+        try {
+            std::shared_future<void> modelLoaded = startInitTask(tasks, "loadModel", [this]() { loadModel(); });
+            std::shared_future<void> textureLoaded = startInitTask(tasks, "loadTextureData", [this]() { loadTextureData(); });
+            // the material textures are only known once the OBJ and its MTL file are parsed
+            std::shared_future<void> materialTexturesLoaded = startInitTask(tasks, "loadMaterialTextureData", [this, modelLoaded]() {
+                waitForInitTask(modelLoaded);
+                loadMaterialTextureData();
+            });
+
+            runInitSteps({
+                { "createInstance", &App::createInstance },
+                { "setupDebugMessenger", &App::setupDebugMessenger },
+                { "createSurface", &App::createSurface },
+                { "pickPhysicalDevice", &App::pickPhysicalDevice },
+                { "createLogicalDevice", &App::createLogicalDevice },
+                { "createAllocator", &App::createAllocator },
+                { "createSwapChain", &App::createSwapChain },
+                { "createImageViews", &App::createImageViews },
+                { "createRenderPass", &App::createRenderPass },
+                { "createDescriptorSetLayout", &App::createDescriptorSetLayout },
+                { "createPipelineCache", &App::createPipelineCache },
+            });
+
+            // the vertex shader depends on the vertex format loadModel ends up with
+            std::shared_future<void> pipelineCreated = startInitTask(tasks, "createGraphicsPipeline", [this, modelLoaded]() {
+                waitForInitTask(modelLoaded);
+                createGraphicsPipeline();
+            });
+            std::shared_future<void> cullingPipelineCreated = startInitTask(tasks, "createCullingPipeline", [this]() { createCullingPipeline(); });
+
+            runInitSteps({
+                { "createCommandPool", &App::createCommandPool },
+                { "createUploadEngine", &App::createUploadEngine },
+                { "createColorResources", &App::createColorResources },
+                { "createDepthResources", &App::createDepthResources },
+                { "createFramebuffers", &App::createFramebuffers },
+                { "createUniformBuffers", &App::createUniformBuffers },
+                { "createDescriptorPool", &App::createDescriptorPool },
+                { "createCommandBuffers", &App::createCommandBuffers },
+                { "createSyncObjects", &App::createSyncObjects },
+                { "createStatisticsQueryPool", &App::createStatisticsQueryPool },
+            });
+
+            waitForInitTask(modelLoaded);
+            runInitSteps({
+                { "createScene", &App::createScene },
+                { "createObjectBuffer", &App::createObjectBuffer },
+                { "createDrawDataBuffer", &App::createDrawDataBuffer },
+                { "createCullingBuffers", &App::createCullingBuffers },
+                { "createVertexBuffer", &App::createVertexBuffer },
+                { "createIndexBuffer", &App::createIndexBuffer },
+            });
+
+            waitForInitTask(textureLoaded);
+            waitForInitTask(materialTexturesLoaded);
+            runInitSteps({
+                { "createTextureImage", &App::createTextureImage },
+                { "createTextureImageView", &App::createTextureImageView },
+                { "createTextureSampler", &App::createTextureSampler },
+                { "createMaterialTextures", &App::createMaterialTextures },
+                { "createMaterialBuffers", &App::createMaterialBuffers },
+                { "createDescriptorSets", &App::createDescriptorSets },
+                { "createCullingDescriptorSets", &App::createCullingDescriptorSets },
+                { "submitUploads", &App::submitUploads },
+                { "createTimestampQueryPool", &App::createTimestampQueryPool },
+            });
+
+            waitForInitTask(pipelineCreated);
+            waitForInitTask(cullingPipelineCreated);
+        }
+        catch (...) {
+            // the tasks reference this object, none may outlive a failed startup
+            for (const std::shared_future<void>& task : tasks)
+                threadPool.wait(task);
+            throw;
+        }
+
+        if (config.defragmentMemory)
+            defragmentGeometry();
+        printMemoryStatistics("startup");
+
+        // all pipelines exist now, a crash later on still leaves the next launch a warm cache
+        savePipelineCache();
     }
 
     void mainLoop() 
     {
-		// Loop until the user closes the window
-        while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+        std::optional<FrameBenchmark> frameBenchmark{};
+        if (!config.frameBenchmarkPath.empty())
+            frameBenchmark.emplace(config.warmupFrames, config.frameCount == 0 ? DEFAULT_FRAME_COUNT : config.frameCount);
+
+        uint32_t frameCount = config.headless && config.frameCount == 0 ? DEFAULT_FRAME_COUNT : config.frameCount;
+        if (frameBenchmark)
+            frameCount = frameBenchmark->getFrameCount();
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        animationStartTime = startTime;
+
+		// Loop until the user closes the window or frameCount frames were rendered
+        uint32_t frame = 0;
+        for (; frameCount == 0 || frame < frameCount; frame++) {
+            const auto frameStart = std::chrono::high_resolution_clock::now();
+            frameTiming = {};
+
+            if (!config.headless && glfwWindowShouldClose(window))
+                break;
+            // --low-latency samples input in drawFrame(), once the previous frame was presented
+            if (!config.lowLatency)
+                sampleInput();
+            uploadEngine.collect();
             drawFrame();
+
+            if (frame == 0) {
+                timeToFirstFrameMs = millisecondsSince(launchTime);
+                std::cout << "Time to first frame: " << timeToFirstFrameMs << " ms (" << (config.serialInit ? "serial" : "parallel") << " init)" << std::endl;
+            }
+
+            frameTiming.frameMs = millisecondsSince(frameStart);
+            if (frameBenchmark)
+                frameBenchmark->record(frameTiming);
         }
 
         vkDeviceWaitIdle(device);
+        for (uint32_t frame = 0; frame < config.framesInFlight; frame++)
+            collectCullingStatistics(frame);
+
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+        if (frame > 0) {
+            std::cout << "Rendered " << frame << " frames " << (config.headless ? "offscreen " : "") << "in " << elapsedMs << " ms ("
+                << elapsedMs / frame << " ms per frame)" << std::endl;
+        }
+
+        if (!config.screenshotPath.empty() && frame > 0)
+            saveScreenshot(config.screenshotPath);
+
+        if (frameBenchmark)
+            writeFrameBenchmark(*frameBenchmark);
+
+        if (profiler.isEnabled()) {
+            for (uint32_t frame = 0; frame < config.framesInFlight; frame++)
+                profiler.collectGpuFrame(frame);
+            profiler.writeTrace(config.tracePath);
+            std::cout << "Trace written to " << config.tracePath << std::endl;
+        }
+
+        if (statisticsQueryPool != VK_NULL_HANDLE && statisticsFrameCount > 0) {
+            std::cout << "Pipeline statistics over " << statisticsFrameCount << " frames: "
+                << static_cast<double>(vertexShaderInvocations) / static_cast<double>(statisticsPrimitives)
+                << " vertex shader invocations per triangle (ACMR), "
+                << fragmentShaderInvocations / statisticsFrameCount << " fragment shader invocations per frame" << std::endl;
+        }
+
+        if (gpuCullingEnabled && cullingFrameCount > 0) {
+            std::cout << "GPU culling: " << visibleObjects / cullingFrameCount << " of " << objects.size() << " objects drawn per frame on average, "
+                << frustumCulledObjects / cullingFrameCount << " outside the frustum";
+            if (occlusionCullingEnabled)
+                std::cout << ", " << occlusionCulledObjects / cullingFrameCount << " occluded";
+            std::cout << " (" << (gpuCulling.isCompacting() ? "vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirect") << ")" << std::endl;
+        }
+
+        if (latencySampleCount > 0) {
+            std::cout << "Latency: " << latencyMs / static_cast<double>(latencySampleCount) << " ms from input to "
+                << (presentWaitEnabled ? "present" : "GPU completion") << " on average (" << getActivePresentModeName() << ", "
+                << config.framesInFlight << " frames in flight, low latency " << (config.lowLatency ? "on" : "off") << ")" << std::endl;
+        }
+
+        if (renderedFrameCount > 0) {
+            const uint64_t drawnObjects = std::accumulate(lodObjectCounts.begin(), lodObjectCounts.end(), uint64_t{ 0 });
+            std::cout << "Submitted " << submittedTriangles / renderedFrameCount << " triangles per frame on average, LOD usage:";
+            for (size_t lod = 0; lod < lodObjectCounts.size(); lod++)
+                std::cout << " " << lod << ": " << 100.0 * static_cast<double>(lodObjectCounts[lod]) / static_cast<double>(std::max(drawnObjects, uint64_t{ 1 })) << "%";
+            std::cout << std::endl;
+
+            // the keys' pipeline and material fields are always 0, see buildDrawList()
+            std::cout << "Binds per frame: " << bindsIssued / renderedFrameCount << " issued, " << bindsAvoided / renderedFrameCount
+                << " avoided (pipeline and descriptor set, one pipeline and no per draw materials)" << std::endl;
+
+            // blocking waits of the frames and uploads, transferTimeline counts nothing without its own queue
+            const uint64_t hostWaits = graphicsTimeline.getStats().hostWaits + transferTimeline.getStats().hostWaits;
+            std::cout << "Host waits: " << static_cast<double>(hostWaits) / static_cast<double>(renderedFrameCount) << " per frame on "
+                << (transferQueue != graphicsQueue ? 2 : 1) << " timeline semaphores" << std::endl;
+
+            const uint32_t sliceCount = getRecordSliceCount();
+            std::cout << "Recorded " << objects.size() << " objects in " << submittedDraws / renderedFrameCount << " draws per frame in " << recordTimeMs / static_cast<double>(renderedFrameCount) << " ms on average";
+            if (sliceCount > 1)
+                std::cout << " (" << sliceCount << " secondary command buffers, " << std::min(sliceCount, threadPool.getThreadCount()) << " threads)";
+            std::cout << std::endl;
+        }
+
+        printMemoryStatistics("shutdown");
+    }
+
+    static double millisecondsSince(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // Ends a drawFrame phase that began at start: adds it to the trace and returns its duration for frameTiming
+    double endFramePhase(const char* name, std::chrono::high_resolution_clock::time_point start)
+    {
+        const auto end = std::chrono::high_resolution_clock::now();
+        profiler.addCpuEvent(name, start, end);
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Writes the --frame-bench report together with what is needed to tell runs apart
+    void writeFrameBenchmark(const FrameBenchmark& frameBenchmark)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        const std::vector<std::pair<std::string, std::string>> info = {
+            { "device", properties.deviceName },
+            { "driverVersion", std::to_string(properties.driverVersion) },
+            { "mode", config.headless ? "headless" : "windowed" },
+            { "resolution", std::to_string(swapChainExtent.width) + "x" + std::to_string(swapChainExtent.height) },
+            { "msaaSamples", std::to_string(msaaSamples) },
+            { "framesInFlight", std::to_string(config.framesInFlight) },
+            { "presentMode", getActivePresentModeName() },
+            { "lowLatency", config.lowLatency ? "on" : "off" },
+            { "latencyMs", std::to_string(latencyMs / static_cast<double>(std::max(latencySampleCount, uint64_t{ 1 }))) },
+            { "latencyEnd", presentWaitEnabled ? "present" : "gpu" },
+            { "model", config.modelPath },
+            { "objects", std::to_string(objects.size()) },
+            { "materials", std::to_string(meshMaterials.size()) },
+            { "instancing", config.instancing ? "on" : "off" },
+            { "drawData", getDrawDataModeName(drawDataMode) },
+            { "drawSort", config.sortDraws ? "on" : "off" },
+            { "gpuCulling", gpuCullingEnabled ? (gpuCulling.isCompacting() ? "indirect-count" : "indirect") : "off" },
+            { "occlusionCulling", occlusionCullingEnabled ? "on" : "off" },
+            { "recordThreads", std::to_string(getRecordSliceCount()) },
+            { "vertexFormat", getVertexFormatName(vertexFormat) },
+            { "textureFormat", std::to_string(textureFormat) },
+            { "meshLods", config.meshLods ? "on" : "off" },
+            { "pipelineCache", PipelineCache::getLoadResultName(pipelineCache.getLoadResult()) },
+            { "init", config.serialInit ? "serial" : "parallel" },
+            { "timeToFirstFrameMs", std::to_string(timeToFirstFrameMs) },
+        };
+
+        if (config.frameBenchmarkPath == "-") {
+            frameBenchmark.writeJson(std::cout, info);
+            return;
+        }
+
+        std::ofstream file(config.frameBenchmarkPath);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open frame benchmark report!");
+
+        frameBenchmark.writeJson(file, info);
+        std::cout << "Frame benchmark written to " << config.frameBenchmarkPath << std::endl;
     }
 
     void cleanup() 
@@ -296,36 +759,58 @@ private:
         vkDestroySampler(device, textureSampler, nullptr);
         vkDestroyImageView(device, textureImageView, nullptr);
 
-        vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, textureImageMemory, nullptr);
+        vmaDestroyImage(allocator, textureImage, textureImageAllocation);
 
-        for (size_t idx{}; idx < MAX_FRAMES_IN_FLIGHT; idx++)
-        {
-            vkDestroyBuffer(device, uniformBuffers[idx], nullptr);
-            vkFreeMemory(device, uniformBuffersMemory[idx], nullptr);
+        for (const MaterialTexture& texture : materialTextures) {
+            vkDestroyImageView(device, texture.view, nullptr);
+            vmaDestroyImage(allocator, texture.image, texture.allocation);
         }
+        vmaDestroyBuffer(allocator, materialBuffer, materialBufferAllocation);
+        vmaDestroyBuffer(allocator, vertexMaterialBuffer, vertexMaterialBufferAllocation);
+
+        for (size_t idx{}; idx < config.framesInFlight; idx++)
+            vmaDestroyBuffer(allocator, uniformBuffers[idx], uniformBuffersAllocation[idx]);
 
         vkDestroyDescriptorPool(device, descriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
 
-        vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, indexBufferMemory, nullptr);
-
-        vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, vertexBufferMemory, nullptr);
+        vmaDestroyBuffer(allocator, indexBuffer, indexBufferAllocation);
+        vmaDestroyBuffer(allocator, vertexBuffer, vertexBufferAllocation);
+        vmaDestroyBuffer(allocator, objectBuffer, objectBufferAllocation);
+        vmaDestroyBuffer(allocator, drawDataBuffer, drawDataBufferAllocation);
+        gpuCulling.destroy();
+        depthPyramid.destroy();
 
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 
+        savePipelineCache();
+        pipelineCache.destroy();
+
         vkDestroyRenderPass(device, renderPass, nullptr);
+        vkDestroyRenderPass(device, occlusionRenderPass, nullptr);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < config.framesInFlight; i++) {
             vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
             vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
-            vkDestroyFence(device, inFlightFences[i], nullptr);
         }
 
+        for (const std::vector<VkCommandPool>& pools : secondaryCommandPools)
+            for (VkCommandPool pool : pools)
+                vkDestroyCommandPool(device, pool, nullptr);
+
         vkDestroyCommandPool(device, commandPool, nullptr);
+        uploadEngine.destroy();
+        vmaDestroyBuffer(allocator, stagingBuffer, stagingAllocation);
+        graphicsTimeline.destroy();
+        transferTimeline.destroy();
+
+        vmaDestroyPool(allocator, geometryPool);
+        vmaDestroyAllocator(allocator);
+
+        if (statisticsQueryPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
+        profiler.destroyGpu();
 
         vkDestroyDevice(device, nullptr); // logical device
 
@@ -336,6 +821,9 @@ private:
         vkDestroySurfaceKHR(instance, surface, nullptr);
         vkDestroyInstance(instance, nullptr); // vulkan instance
 
+        if (config.headless)
+            return;
+
         glfwDestroyWindow(window);
 
         // Terminate GLFW library
@@ -345,12 +833,11 @@ private:
     void cleanupSwapChain() 
     {
         vkDestroyImageView(device, colorImageView, nullptr);
-        vkDestroyImage(device, colorImage, nullptr);
-        vkFreeMemory(device, colorImageMemory, nullptr);
+        vmaDestroyImage(allocator, colorImage, colorImageAllocation);
 
+        depthPyramid.destroyResources();
         vkDestroyImageView(device, depthImageView, nullptr);
-        vkDestroyImage(device, depthImage, nullptr);
-        vkFreeMemory(device, depthImageMemory, nullptr);
+        vmaDestroyImage(allocator, depthImage, depthImageAllocation);
 
         for (size_t i = 0; i < swapChainFramebuffers.size(); i++) {
             vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
@@ -360,6 +847,10 @@ private:
             vkDestroyImageView(device, swapChainImageViews[i], nullptr);
         }
 
+        for (size_t i = 0; i < offscreenImageAllocations.size(); i++)
+            vmaDestroyImage(allocator, swapChainImages[i], offscreenImageAllocations[i]);
+        offscreenImageAllocations.clear();
+
         vkDestroySwapchainKHR(device, swapChain, nullptr);
     }
 
@@ -374,6 +865,8 @@ private:
 
         vkDeviceWaitIdle(device);
 
+        // present ids belong to the swapchain about to be destroyed
+        pendingPresents.clear();
         cleanupSwapChain();
 
         createSwapChain();
@@ -397,7 +890,7 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = VULKAN_API_VERSION;
 
 		// (global extensions and validation layers we want to use)
         VkInstanceCreateInfo createInfo{};
@@ -456,6 +949,9 @@ private:
 
     void createSurface()
     {
+        if (config.headless)
+            return;
+
         if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
             throw std::runtime_error("failed to create window surface!");
         }
@@ -493,7 +989,8 @@ private:
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = {
             indices.graphicsFamily.value(),
-            indices.presentFamily.value()
+            indices.presentFamily.value(),
+            indices.transferFamily.value()
         };
 
         float queuePriority = 1.0f;
@@ -510,6 +1007,38 @@ private:
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading feature for the device
 
+        // optional, --pipeline-stats is silently ignored where it is missing
+        VkPhysicalDeviceFeatures supportedFeatures{};
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+        deviceFeatures.pipelineStatisticsQuery = config.pipelineStatistics ? supportedFeatures.pipelineStatisticsQuery : VK_FALSE;
+        pipelineStatisticsSupported = deviceFeatures.pipelineStatisticsQuery == VK_TRUE;
+        deviceFeatures.inheritedQueries = pipelineStatisticsSupported && getRecordSliceCount() > 1 ? supportedFeatures.inheritedQueries : VK_FALSE;
+        inheritedQueriesSupported = deviceFeatures.inheritedQueries == VK_TRUE;
+
+        // --gpu-culling draws many objects per indirect call, each with its index as first instance
+        gpuCullingEnabled = config.gpuCulling && supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+        if (config.gpuCulling && !gpuCullingEnabled)
+            std::cerr << "Multi draw indirect with a first instance is not supported by this device, drawing without GPU culling" << std::endl;
+        deviceFeatures.multiDrawIndirect = gpuCullingEnabled ? VK_TRUE : VK_FALSE;
+        deviceFeatures.drawIndirectFirstInstance = gpuCullingEnabled ? VK_TRUE : VK_FALSE;
+
+        // --occlusion-culling builds its depth pyramid by sampling the depth attachment
+        VkFormatProperties depthFormatProperties{};
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, findDepthFormat(), &depthFormatProperties);
+        occlusionCullingEnabled = gpuCullingEnabled && config.occlusionCulling && (depthFormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+        if (gpuCullingEnabled && config.occlusionCulling && !occlusionCullingEnabled)
+            std::cerr << "The depth format cannot be sampled on this device, culling without occlusion culling" << std::endl;
+
+        // --draw-data only applies to one draw per object
+        drawDataMode = config.instancing || gpuCullingEnabled ? DrawDataMode::Storage : config.drawData;
+        if (drawDataMode != config.drawData)
+            std::cerr << "Instanced and GPU culled draws read the object buffer, ignoring --draw-data " << getDrawDataModeName(config.drawData) << std::endl;
+
+        // block compressed textures are only picked when their format family is available
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+        deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
@@ -518,10 +1047,44 @@ private:
 
         createInfo.pEnabledFeatures = &deviceFeatures;
 
-        createInfo.enabledExtensionCount = 0;
-
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        // the texture array is indexed per fragment and only as many descriptors as textures are written,
+        // isDeviceSuitable() checked all three
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+        descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        // isDeviceSuitable() checked it too
+        VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+        timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+        timelineSemaphoreFeatures.pNext = &descriptorIndexingFeatures;
+        timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+        createInfo.pNext = &timelineSemaphoreFeatures;
+
+        // optional, without it the culling keeps one indirect command per object
+        std::vector<const char*> extensions = getDeviceExtensions();
+        const bool drawIndirectCountSupported = gpuCullingEnabled && hasDeviceExtension(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (drawIndirectCountSupported)
+            extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+        // optional, without it --low-latency waits for the previous frame's timeline value instead
+        presentWaitEnabled = !config.headless && supportsPresentWait(physicalDevice);
+        if (config.lowLatency && !config.headless && !presentWaitEnabled)
+            std::cerr << "Present wait is not supported by this device, --low-latency waits for the previous frame's GPU work instead" << std::endl;
+
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        presentWaitFeatures.presentWait = VK_TRUE;
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        presentIdFeatures.presentId = VK_TRUE;
+        if (presentWaitEnabled) {
+            descriptorIndexingFeatures.pNext = &presentIdFeatures;
+            extensions.insert(extensions.end(), presentWaitDeviceExtensions.begin(), presentWaitDeviceExtensions.end());
+        }
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         if (enableValidationLayers) {
             createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -537,9 +1100,166 @@ private:
 
         vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
         vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+
+        if (drawIndirectCountSupported)
+            drawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+        if (presentWaitEnabled)
+            waitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(device, "vkWaitForPresentKHR");
+
+        graphicsTimeline.init(device, graphicsQueue);
+        if (transferQueue != graphicsQueue)
+            transferTimeline.init(device, transferQueue);
+    }
+
+    void createAllocator()
+    {
+        // counts the device memory blocks VMA allocates, everything else is suballocated from them
+        VmaDeviceMemoryCallbacks callbacks{};
+        callbacks.pfnAllocate = [](VmaAllocator, uint32_t, VkDeviceMemory, VkDeviceSize, void* userData) {
+            static_cast<HelloTriangleApplication*>(userData)->memoryAllocationCount++;
+        };
+        callbacks.pUserData = this;
+
+        // VMA may use what the instance enabled, but no more than the device supports
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        VmaAllocatorCreateInfo allocatorInfo{};
+        allocatorInfo.instance = instance;
+        allocatorInfo.physicalDevice = physicalDevice;
+        allocatorInfo.device = device;
+        allocatorInfo.vulkanApiVersion = std::min(VULKAN_API_VERSION, properties.apiVersion);
+        allocatorInfo.pDeviceMemoryCallbacks = &callbacks;
+
+        if (vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS)
+            throw std::runtime_error("failed to create memory allocator!");
+
+        // the pool's memory type is the one VMA would pick for any vertex or index buffer
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = 65536;
+        bufferInfo.usage = GEOMETRY_BUFFER_USAGE | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        VmaPoolCreateInfo poolInfo{};
+        if (vmaFindMemoryTypeIndexForBufferInfo(allocator, &bufferInfo, &allocInfo, &poolInfo.memoryTypeIndex) != VK_SUCCESS)
+            throw std::runtime_error("failed to find memory type for geometry buffers!");
+
+        if (vmaCreatePool(allocator, &poolInfo, &geometryPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create geometry memory pool!");
+    }
+
+    // Prints VMA's view of device memory: blocks, suballocations and the block bytes no allocation uses
+    void printMemoryStatistics(const char* when)
+    {
+        VmaTotalStatistics statistics{};
+        vmaCalculateStatistics(allocator, &statistics);
+
+        VmaDetailedStatistics geometry{};
+        vmaCalculatePoolStatistics(allocator, geometryPool, &geometry);
+
+        const VmaStatistics& total = statistics.total.statistics;
+        std::cout << "Memory at " << when << ": " << total.blockCount << " blocks, " << total.allocationCount << " allocations, "
+            << total.allocationBytes / 1024 << " KiB used, " << (total.blockBytes - total.allocationBytes) / 1024 << " KiB unused in "
+            << statistics.total.unusedRangeCount << " free ranges, geometry pool " << geometry.statistics.allocationBytes / 1024 << "/"
+            << geometry.statistics.blockBytes / 1024 << " KiB, " << memoryAllocationCount << " vkAllocateMemory calls" << std::endl;
+    }
+
+    // Compacts the geometry pool: VMA proposes moves, each moved buffer is recreated on the new memory,
+    // its contents copied on the graphics queue and the old buffer destroyed once the copy completed.
+    // Waits for the device to idle first since in-flight frames may read the buffers being moved.
+    void defragmentGeometry()
+    {
+        struct GeometryBuffer {
+            VkBuffer* buffer;
+            VmaAllocation* allocation;
+            VkDeviceSize size;
+            VkBufferUsageFlags usage;
+        };
+        const std::array<GeometryBuffer, 2> geometryBuffers{ {
+            { &vertexBuffer, &vertexBufferAllocation, vertexData.size_bytes(), GEOMETRY_BUFFER_USAGE | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT },
+            { &indexBuffer, &indexBufferAllocation, indexData.size_bytes(), GEOMETRY_BUFFER_USAGE | VK_BUFFER_USAGE_INDEX_BUFFER_BIT },
+        } };
+
+        vkDeviceWaitIdle(device);
+        uploadEngine.collect();
+
+        VmaDefragmentationInfo defragmentationInfo{};
+        defragmentationInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FULL_BIT;
+        defragmentationInfo.pool = geometryPool;
+
+        VmaDefragmentationContext context{};
+        if (vmaBeginDefragmentation(allocator, &defragmentationInfo, &context) != VK_SUCCESS)
+            throw std::runtime_error("failed to begin defragmentation!");
+
+        for (;;) {
+            VmaDefragmentationPassMoveInfo pass{};
+            if (vmaBeginDefragmentationPass(allocator, context, &pass) == VK_SUCCESS)
+                break;
+
+            std::vector<VkBuffer> oldBuffers{};
+            VkCommandBuffer commandBuffer = uploadEngine.getGraphicsCommands();
+            for (uint32_t idx = 0; idx < pass.moveCount; idx++) {
+                VmaDefragmentationMove& move = pass.pMoves[idx];
+                auto geometryBuffer = std::find_if(geometryBuffers.begin(), geometryBuffers.end(), [&](const GeometryBuffer& candidate) { return *candidate.allocation == move.srcAllocation; });
+                if (geometryBuffer == geometryBuffers.end()) {
+                    move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+                    continue;
+                }
+
+                VkBufferCreateInfo bufferInfo{};
+                bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+                bufferInfo.size = geometryBuffer->size;
+                bufferInfo.usage = geometryBuffer->usage;
+                bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                VkBuffer movedBuffer{};
+                if (vkCreateBuffer(device, &bufferInfo, nullptr, &movedBuffer) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create buffer!");
+                if (vmaBindBufferMemory(allocator, move.dstTmpAllocation, movedBuffer) != VK_SUCCESS)
+                    throw std::runtime_error("failed to bind buffer memory!");
+
+                VkBufferCopy copyRegion{};
+                copyRegion.size = geometryBuffer->size;
+                vkCmdCopyBuffer(commandBuffer, *geometryBuffer->buffer, movedBuffer, 1, &copyRegion);
+                uploadEngine.countOperation();
+
+                // the allocation handle stays valid and refers to the new memory once the pass ends
+                oldBuffers.push_back(*geometryBuffer->buffer);
+                *geometryBuffer->buffer = movedBuffer;
+            }
+
+            // later frames on this queue read the copies
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+            uploadEngine.wait(uploadEngine.submit());
+            for (VkBuffer oldBuffer : oldBuffers)
+                vkDestroyBuffer(device, oldBuffer, nullptr);
+
+            if (vmaEndDefragmentationPass(allocator, context, &pass) == VK_SUCCESS)
+                break;
+        }
+
+        VmaDefragmentationStats statistics{};
+        vmaEndDefragmentation(allocator, context, &statistics);
+        std::cout << "Defragmentation: moved " << statistics.allocationsMoved << " allocations (" << statistics.bytesMoved / 1024
+            << " KiB), freed " << statistics.deviceMemoryBlocksFreed << " blocks (" << statistics.bytesFreed / 1024 << " KiB)" << std::endl;
     }
 
     void createSwapChain() {
+        if (config.headless) {
+            createOffscreenTargets();
+            return;
+        }
+
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -594,6 +1314,68 @@ private:
 
     }
 
+    // Headless stand-in for the swapchain: the render pass resolves into these images and leaves them
+    // in TRANSFER_SRC_OPTIMAL, a frame renders into the image of its frame in flight
+    void createOffscreenTargets()
+    {
+        swapChainImageFormat = VK_FORMAT_R8G8B8A8_SRGB; // color attachment support is mandatory for it
+        swapChainExtent = { WIDTH, HEIGHT };
+
+        swapChainImages.resize(config.framesInFlight);
+        offscreenImageAllocations.resize(config.framesInFlight);
+        for (size_t i = 0; i < config.framesInFlight; i++) {
+            createImage(swapChainExtent.width, swapChainExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageAllocations[i]);
+        }
+    }
+
+    // Copies the last rendered offscreen image into a readback buffer and writes it as a PNG
+    void saveScreenshot(const std::string& path)
+    {
+        const VkDeviceSize size = VkDeviceSize{ swapChainExtent.width } * swapChainExtent.height * 4;
+        VkBuffer readbackBuffer{};
+        VmaAllocation readbackAllocation{};
+        void* data{};
+        createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackAllocation, &data);
+
+        VkCommandBuffer commandBuffer = uploadEngine.getGraphicsCommands();
+
+        // the resolve already left the image in TRANSFER_SRC_OPTIMAL, only its writes have to be made visible
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = swapChainImages[lastImageIndex];
+        barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+        vkCmdCopyImageToBuffer(commandBuffer, swapChainImages[lastImageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+        uploadEngine.countOperation();
+
+        uploadEngine.wait(uploadEngine.submit());
+        vmaInvalidateAllocation(allocator, readbackAllocation, 0, VK_WHOLE_SIZE);
+
+        // the cleared background may carry any alpha, the PNG should not be see-through
+        auto* pixels = static_cast<uint8_t*>(data);
+        for (VkDeviceSize idx = 3; idx < size; idx += 4)
+            pixels[idx] = 255;
+
+        const int stride = static_cast<int>(swapChainExtent.width * 4);
+        const bool written = stbi_write_png(path.c_str(), static_cast<int>(swapChainExtent.width), static_cast<int>(swapChainExtent.height), 4, pixels, stride) != 0;
+        vmaDestroyBuffer(allocator, readbackBuffer, readbackAllocation);
+
+        if (!written)
+            throw std::runtime_error("failed to write screenshot!");
+        std::cout << "Screenshot written to " << path << std::endl;
+    }
+
     void createImageViews()
     {
         swapChainImageViews.resize(swapChainImages.size());
@@ -604,27 +1386,38 @@ private:
     }
 
     void createRenderPass()
+    {
+        // occlusion culling draws the frame in two passes, the first one keeps its depth for the depth pyramid
+        renderPass = createRenderPass(false, !occlusionCullingEnabled);
+        if (occlusionCullingEnabled)
+            occlusionRenderPass = createRenderPass(true, true);
+    }
+
+    // loadAttachments continues what an earlier pass drew, only the last pass of a frame
+    // discards the depth and hands the resolved image on
+    VkRenderPass createRenderPass(bool loadAttachments, bool lastPass)
     {
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = swapChainImageFormat;
         colorAttachment.samples = msaaSamples;
-        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.loadOp = loadAttachments ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.initialLayout = loadAttachments ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
         VkAttachmentDescription depthAttachment{};
         depthAttachment.format = findDepthFormat();
         depthAttachment.samples = msaaSamples;
-        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.loadOp = loadAttachments ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = lastPass ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.initialLayout = loadAttachments ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
         depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+        // resolved again by every pass
         VkAttachmentDescription colorAttachmentResolve{};
         colorAttachmentResolve.format = swapChainImageFormat;
         colorAttachmentResolve.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -632,8 +1425,11 @@ private:
         colorAttachmentResolve.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachmentResolve.initialLayout = loadAttachments ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        if (!lastPass)
+            colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        else
+            colorAttachmentResolve.finalLayout = config.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -662,6 +1458,10 @@ private:
         dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
         dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        if (loadAttachments) {
+            dependency.srcAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        }
 
         std::array<VkAttachmentDescription, 3> attachments = { colorAttachment, depthAttachment, colorAttachmentResolve };
         VkRenderPassCreateInfo renderPassInfo{};
@@ -673,9 +1473,27 @@ private:
         renderPassInfo.dependencyCount = 1;
         renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        VkRenderPass pass{};
+        if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &pass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
         }
+        return pass;
+    }
+
+    void createPipelineCache()
+    {
+        pipelineCache.create(physicalDevice, device, config.pipelineCachePath);
+    }
+
+    void savePipelineCache()
+    {
+        try {
+            pipelineCache.save();
+        }
+        catch (const std::exception& e) {
+            // not fatal, the next launch simply compiles the pipelines again
+            std::cerr << "Pipeline cache: " << e.what() << std::endl;
+        }
     }
 
     // Provide details about every descriptor binding used in shaders for pipeline creation
@@ -687,28 +1505,95 @@ private:
         uboLayoutBinding.descriptorCount = 1; // nr of values in array
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; // specify in which shader stage descriptor will be referenced
 
-        // combined image sampler descriptor
+        // the texture array of the bindless materials, only the first descriptors are written
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bindlessTextureCapacity = std::min({ MAX_BINDLESS_TEXTURES, properties.limits.maxPerStageDescriptorSamplers,
+            properties.limits.maxPerStageDescriptorSampledImages, properties.limits.maxDescriptorSetSamplers, properties.limits.maxDescriptorSetSampledImages });
+
         VkDescriptorSetLayoutBinding samplerLayoutBinding{};
         samplerLayoutBinding.binding = 1;
-        samplerLayoutBinding.descriptorCount = 1;
+        samplerLayoutBinding.descriptorCount = bindlessTextureCapacity;
         samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+        // per object data, see ObjectData
+        VkDescriptorSetLayoutBinding objectLayoutBinding{};
+        objectLayoutBinding.binding = 2;
+        objectLayoutBinding.descriptorCount = 1;
+        objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        objectLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        // per draw data of --draw-data dynamic, see DrawData
+        VkDescriptorSetLayoutBinding drawDataLayoutBinding{};
+        drawDataLayoutBinding.binding = 3;
+        drawDataLayoutBinding.descriptorCount = 1;
+        drawDataLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        drawDataLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        // the bindless materials, see MaterialData
+        VkDescriptorSetLayoutBinding materialLayoutBinding{};
+        materialLayoutBinding.binding = 4;
+        materialLayoutBinding.descriptorCount = 1;
+        materialLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        materialLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        // the material of every vertex, see PackedMesh::vertexMaterials
+        VkDescriptorSetLayoutBinding vertexMaterialLayoutBinding{};
+        vertexMaterialLayoutBinding.binding = 5;
+        vertexMaterialLayoutBinding.descriptorCount = 1;
+        vertexMaterialLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        vertexMaterialLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+        std::array<VkDescriptorSetLayoutBinding, 6> bindings = { uboLayoutBinding, samplerLayoutBinding, objectLayoutBinding, drawDataLayoutBinding, materialLayoutBinding, vertexMaterialLayoutBinding };
+        std::array<VkDescriptorBindingFlagsEXT, 6> bindingFlags = { 0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT, 0, 0, 0, 0 };
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
         // descriptor set layout has to be specified during pipeline creation to set which descriptors the shaders will be using
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
         layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
         layoutInfo.pBindings = bindings.data();
 
         if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
             throw std::runtime_error("failed to create descriptor set layout!");
+
+        // the culling pass has its own set, the pipeline can compile on a worker once its layout exists
+        if (gpuCullingEnabled)
+            gpuCulling.init(device, allocator, config.framesInFlight, drawIndexedIndirectCount, occlusionCullingEnabled);
+        if (occlusionCullingEnabled)
+            depthPyramid.init(device, allocator);
+    }
+
+    void createCullingPipeline()
+    {
+        if (!gpuCullingEnabled)
+            return;
+
+        VkShaderModule shaderModule = createShaderModule(readFile(occlusionCullingEnabled ? "./shaders/cull_occlusion.spv" : "./shaders/cull.spv"));
+        gpuCulling.createPipeline(shaderModule, pipelineCache.get());
+        vkDestroyShaderModule(device, shaderModule, nullptr);
+
+        if (!occlusionCullingEnabled)
+            return;
+
+        // a multisampled depth attachment is read through a sampler2DMS
+        VkShaderModule depthShaderModule = createShaderModule(readFile(msaaSamples != VK_SAMPLE_COUNT_1_BIT ? "./shaders/depth_pyramid_depth_ms.spv" : "./shaders/depth_pyramid_depth.spv"));
+        VkShaderModule reduceShaderModule = createShaderModule(readFile("./shaders/depth_pyramid_reduce.spv"));
+        depthPyramid.createPipelines(depthShaderModule, reduceShaderModule, pipelineCache.get());
+        vkDestroyShaderModule(device, depthShaderModule, nullptr);
+        vkDestroyShaderModule(device, reduceShaderModule, nullptr);
     }
 
     void createGraphicsPipeline()
     {
-        auto vertShaderCode = readFile("./shaders/vert.spv");
+        auto vertShaderCode = readFile("./shaders/vert_" + std::string(getVertexFormatName(vertexFormat)) + ".spv");
         auto fragShaderCode = readFile("./shaders/frag.spv");
 
 
@@ -721,6 +1606,28 @@ private:
         vertShaderStageInfo.module = vertShaderModule;
         vertShaderStageInfo.pName = "main";
 
+        // DRAW_DATA_MODE and HAS_VERTEX_MATERIALS in shader.vert, the driver drops the paths not taken
+        struct VertexConstants {
+            int32_t drawDataMode;
+            VkBool32 hasVertexMaterials;
+        };
+        const VertexConstants vertexConstants{ static_cast<int32_t>(drawDataMode), vertexMaterialData.empty() ? VK_FALSE : VK_TRUE };
+
+        std::array<VkSpecializationMapEntry, 2> specializationEntries{};
+        specializationEntries[0].constantID = 0;
+        specializationEntries[0].offset = offsetof(VertexConstants, drawDataMode);
+        specializationEntries[0].size = sizeof(vertexConstants.drawDataMode);
+        specializationEntries[1].constantID = 1;
+        specializationEntries[1].offset = offsetof(VertexConstants, hasVertexMaterials);
+        specializationEntries[1].size = sizeof(vertexConstants.hasVertexMaterials);
+
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(specializationEntries.size());
+        specializationInfo.pMapEntries = specializationEntries.data();
+        specializationInfo.dataSize = sizeof(vertexConstants);
+        specializationInfo.pData = &vertexConstants;
+        vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
         VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -733,8 +1640,12 @@ private:
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+        VkVertexInputBindingDescription bindingDescription = visitVertexLayout(vertexFormat, [&](auto layout) {
+            auto attributes = decltype(layout)::getAttributeDescriptions();
+            attributeDescriptions.assign(attributes.begin(), attributes.end());
+            return decltype(layout)::getBindingDescription();
+        });
 
         vertexInputInfo.vertexBindingDescriptionCount = 1;
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -805,6 +1716,14 @@ private:
         pipelineLayoutInfo.setLayoutCount = 1;
         pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout; // referencing layout object
 
+        // --draw-data push
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawData);
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
         if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to create pipeline layout!");
@@ -829,11 +1748,16 @@ private:
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
 
-        if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) 
+        const auto start = std::chrono::high_resolution_clock::now();
+        if (vkCreateGraphicsPipelines(device, pipelineCache.get(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) 
         {
             throw std::runtime_error("failed to create graphics pipeline!");
         }
 
+        // runs on a worker during startup, one string keeps the line from interleaving with the main thread's output
+        std::cout << "Pipeline: created in " + std::to_string(millisecondsSince(start)) + " ms (pipeline cache "
+            + PipelineCache::getLoadResultName(pipelineCache.getLoadResult()) + ")\n";
+
         vkDestroyShaderModule(device, fragShaderModule, nullptr);
         vkDestroyShaderModule(device, vertShaderModule, nullptr);
     }
@@ -881,11 +1805,48 @@ private:
 
     }
 
+    // The counter of the queue uploads are copied on, the graphics one without a dedicated transfer queue
+    QueueTimeline& getTransferTimeline()
+    {
+        return transferQueue != graphicsQueue ? transferTimeline : graphicsTimeline;
+    }
+
+    void createUploadEngine()
+    {
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+        uploadEngine.init(device, queueFamilyIndices.graphicsFamily.value(), graphicsTimeline, queueFamilyIndices.transferFamily.value(), getTransferTimeline(),
+            queueFamilyIndices.transferGranularity);
+
+        // one persistently mapped ring serves every upload
+        const VkDeviceSize stagingSize = VkDeviceSize{ config.stagingBufferMiB } * 1024 * 1024;
+        void* data{};
+        createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingAllocation, &data);
+        uploadEngine.setStagingBuffer(stagingBuffer, data, stagingSize);
+
+        uploadAllocationBase = memoryAllocationCount;
+    }
+
+    // Submits the texture, vertex and index uploads recorded during init as one batch.
+    // Nothing waits for it: frames are submitted to the graphics queue after it and the
+    // staging buffers are freed by uploadEngine.collect() once its timeline value is reached.
+    void submitUploads()
+    {
+        uploadEngine.submit();
+
+        const UploadEngine::Stats& stats = uploadEngine.getStats();
+        std::cout << "Uploads: " << stats.operations << " operations in " << stats.submissions << " submissions ("
+            << (uploadEngine.hasDedicatedTransferQueue() ? "dedicated transfer queue" : "graphics queue") << "), "
+            << stats.hostWaits << " host waits" << std::endl;
+        std::cout << "Staging: " << stats.stagingBytes / 1024 << " KiB in " << stats.stagingChunks << " chunks through a "
+            << uploadEngine.getStagingCapacity() / 1024 << " KiB ring (" << stats.stagingWraps << " wraps, " << stats.stagingStalls << " stalls), "
+            << memoryAllocationCount - uploadAllocationBase << " vkAllocateMemory calls for the destinations" << std::endl;
+    }
+
     void createColorResources()
     {
         VkFormat colorFormat = swapChainImageFormat;
 
-        createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageMemory);
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, colorFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, colorImage, colorImageAllocation);
         colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
     }
 
@@ -893,9 +1854,19 @@ private:
     {
         VkFormat depthFormat = findDepthFormat();
 
-        createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+        // occlusion culling reduces the depth into the depth pyramid
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        if (occlusionCullingEnabled)
+            usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+        createImage(swapChainExtent.width, swapChainExtent.height, 1, msaaSamples, depthFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageAllocation);
 		// transition image layout to depth stencil attachment
         depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+
+        if (occlusionCullingEnabled) {
+            depthPyramid.createResources(depthImage, depthImageView, depthFormat, swapChainExtent, msaaSamples);
+            gpuCulling.setDepthPyramid(depthPyramid);
+        }
     }
 
     VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) 
@@ -927,57 +1898,181 @@ private:
         return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
     }
 
-    void createTextureImage()
+    // CPU half of the texture, runs on a worker during startup: maps the KTX2 files written by TextureConverter
+    // and, when there are none, decodes the source image. Which file is used depends on the device, see createTextureImage().
+    void loadTextureData()
     {
-        // loading in image with stb library
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
-        mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+        if (config.compressedTextures) {
+            for (TextureCompression compression : TEXTURE_COMPRESSIONS) {
+                if (config.textureCompression && *config.textureCompression != compression)
+                    continue;
+
+                Ktx2Texture texture{};
+                if (texture.open(getCompressedTexturePath(config.texturePath, compression)))
+                    textureCandidates.push_back(std::move(texture));
+            }
+        }
+
+        if (textureCandidates.empty())
+            decodeTextureSource();
+    }
 
+    // Decodes the source image with stb, and builds its mip chain if --cpu-mips asks for one
+    void decodeTextureSource()
+    {
+        int texWidth, texHeight, texChannels;
+        stbi_uc* pixels = stbi_load(config.texturePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
         if (!pixels) 
             throw std::runtime_error("failed to load texture image!");
 
-        // create buffer in host visible memory which allows vkMapMemory
-        VkBuffer stagingBuffer{};
-        VkDeviceMemory stagingBufferMemory{};
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        textureSource = ImageData{ static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight) };
+        textureSource.pixels.assign(pixels, pixels + size_t{ textureSource.width } * textureSource.height * 4);
+        stbi_image_free(pixels);
+
+        if (config.cpuMipGeneration)
+            textureMipChain = generateMipChain(textureSource, true, config.mipFilter, &threadPool);
+    }
 
-        // directly copy pixel values to buffer
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-            memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBufferMemory);
+    // GPU half of the texture, needs the data from loadTextureData()
+    void createTextureImage()
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!createCompressedTextureImage())
+            createUncompressedTextureImage();
+        auto end = std::chrono::high_resolution_clock::now();
 
-        stbi_image_free(pixels); // clean up original pixel array
-        createImage(texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-		
-        // copy staging buffer to texture image
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
-        copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-        //transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+        // the data was copied into the staging ring, the mappings and decoded pixels are no longer needed
+        textureCandidates.clear();
+        textureSource = {};
+        textureMipChain.clear();
 
-        // cleaning up staging buffer and its memory
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        // the uncompressed path keeps 4 bytes per texel in every level
+        uint64_t imageSize = 0;
+        uint64_t uncompressedSize = 0;
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            const uint32_t levelWidth = std::max(textureExtent.width >> level, 1u);
+            const uint32_t levelHeight = std::max(textureExtent.height >> level, 1u);
+            uncompressedSize += uint64_t{ levelWidth } * levelHeight * 4;
+            imageSize += textureFormat == VK_FORMAT_R8G8B8A8_SRGB ? uint64_t{ levelWidth } * levelHeight * 4 : getCompressedLevelSize(textureFormat, levelWidth, levelHeight);
+        }
 
-        generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
+        std::cout << "Texture: " << textureExtent.width << "x" << textureExtent.height << ", " << mipLevels << " levels, "
+            << imageSize / 1024 << " KiB (RGBA8: " << uncompressedSize / 1024 << " KiB), " << textureMipSource << " mips, uploaded in "
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms" << std::endl;
     }
 
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) 
+    bool isSampledFormatSupported(VkFormat format)
     {
-        // Check if image format supports linear blitting
         VkFormatProperties formatProperties;
-        vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
 
-        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
-            throw std::runtime_error("texture image format does not support linear blitting!");
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (formatProperties.optimalTilingFeatures & required) == required;
+    }
 
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    // Uploads the first KTX2 file whose format the device can sample.
+    // All mips are precomputed, so one copy fills the whole chain. Returns false if there is none.
+    bool createCompressedTextureImage()
+    {
+        auto found = std::find_if(textureCandidates.begin(), textureCandidates.end(),
+            [&](const Ktx2Texture& candidate) { return isSampledFormatSupported(candidate.getFormat()); });
 
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.image = image;
+        if (found == textureCandidates.end()) {
+            if (config.compressedTextures && config.textureCompression)
+                std::cerr << "Texture: no usable " << getTextureCompressionName(*config.textureCompression) << " KTX2 file, falling back to RGBA8" << std::endl;
+            return false;
+        }
+
+        const Ktx2Texture& texture = *found;
+        textureFormat = texture.getFormat();
+        textureExtent = { texture.getWidth(), texture.getHeight() };
+        mipLevels = texture.getLevelCount();
+
+        std::vector<std::span<const std::byte>> levels(mipLevels);
+        for (uint32_t level = 0; level < mipLevels; level++)
+            levels[level] = texture.getLevelData(level);
+
+        // every format TextureConverter writes uses 4x4 blocks
+        uploadTextureLevels(levels, getCompressedBlockSize(textureFormat), 4);
+        textureMipSource = "precomputed";
+        return true;
+    }
+
+    // Creates textureImage from textureFormat, textureExtent and mipLevels and fills every level
+    // through the staging ring, leaving it ready for sampling.
+    // Levels are stored in blockExtent x blockExtent blocks of blockSize bytes.
+    void uploadTextureLevels(const std::vector<std::span<const std::byte>>& levels, uint32_t blockSize, uint32_t blockExtent)
+    {
+        createImage(textureExtent.width, textureExtent.height, mipLevels, VK_SAMPLE_COUNT_1_BIT, textureFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+
+        transitionImageLayout(uploadEngine.getTransferCommands(), textureImage, textureFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+        uploadEngine.uploadImage(textureImage, textureExtent, levels, blockSize, blockExtent);
+        uploadEngine.releaseImage(textureImage, mipLevels, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    bool isLinearBlitSupported(VkFormat format)
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (formatProperties.optimalTilingFeatures & required) == required;
+    }
+
+    // Uploads the decoded source image and builds the mip chain with GPU blits,
+    // or on the CPU if requested or the format cannot be blitted
+    void createUncompressedTextureImage()
+    {
+        // only decoded up front when no KTX2 file exists, a device that supports none of them pays for it here
+        if (textureSource.pixels.empty())
+            decodeTextureSource();
+
+        const VkDeviceSize imageSize = VkDeviceSize{ textureSource.width } * textureSource.height * 4;
+        mipLevels = getMipLevelCount(textureSource.width, textureSource.height);
+        textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        textureExtent = { textureSource.width, textureSource.height };
+
+        if (config.cpuMipGeneration || !isLinearBlitSupported(textureFormat)) {
+            if (textureMipChain.empty())
+                textureMipChain = generateMipChain(textureSource, true, config.mipFilter, &threadPool);
+
+            std::vector<std::span<const std::byte>> levels{};
+            for (const ImageData& level : textureMipChain)
+                levels.push_back(std::as_bytes(std::span{ level.pixels }));
+
+            uploadTextureLevels(levels, 4, 1);
+            textureMipSource = getMipFilterName(config.mipFilter);
+            return;
+        }
+
+        createImage(textureExtent.width, textureExtent.height, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageAllocation);
+		
+        // copy the pixels to level 0 through the staging ring
+        transitionImageLayout(uploadEngine.getTransferCommands(), textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels);
+        uploadEngine.uploadImage(textureImage, textureExtent, { std::as_bytes(std::span{ textureSource.pixels }).first(static_cast<size_t>(imageSize)) }, 4, 1);
+        //transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
+
+        // blits need the graphics queue, hand the image over in TRANSFER_DST_OPTIMAL
+        uploadEngine.releaseImage(textureImage, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+
+        generateMipmaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, static_cast<int32_t>(textureExtent.width), static_cast<int32_t>(textureExtent.height), mipLevels);
+        textureMipSource = "blit";
+    }
+
+    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) 
+    {
+        // Check if image format supports linear blitting
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, imageFormat, &formatProperties);
+
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+            throw std::runtime_error("texture image format does not support linear blitting!");
+
+        VkCommandBuffer commandBuffer = uploadEngine.getGraphicsCommands();
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image;
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -1021,6 +2116,7 @@ private:
                 image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                 1, &blit,
                 VK_FILTER_LINEAR);
+            uploadEngine.countOperation();
 
             barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
             barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
@@ -1048,8 +2144,6 @@ private:
             0, nullptr,
             0, nullptr,
             1, &barrier);
-
-        endSingleTimeCommands(commandBuffer);
     }
 
     VkSampleCountFlagBits getMaxUsableSampleCount() {
@@ -1069,7 +2163,7 @@ private:
 
     void createTextureImageView()
     {
-        textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+        textureImageView = createImageView(textureImage, textureFormat, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
     }
 
     void createTextureSampler() {
@@ -1091,7 +2185,7 @@ private:
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>(mipLevels);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE; // shared by all textures, each with its own mip count
         samplerInfo.mipLodBias = 0.0f;
 
         if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS)
@@ -1119,7 +2213,7 @@ private:
         return imageView;
     }
 
-    void createImage(uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+    void createImage(uint32_t texWidth, uint32_t texHeight, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VmaAllocation& imageAllocation)
     {
         // parameters for an image
         VkImageCreateInfo imageInfo{};
@@ -1137,27 +2231,23 @@ private:
         imageInfo.samples = numSamples;
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
-            throw std::runtime_error("failed to create image!");
-
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.requiredFlags = properties;
 
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate image memory!");
+        // render targets are large and recreated with the swapchain, they get their own memory instead of
+        // punching holes into the shared blocks; transient ones may live in lazily allocated tile memory
+        if (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT))
+            allocInfo.flags |= VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+        if (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+            allocInfo.preferredFlags |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 
-        vkBindImageMemory(device, image, imageMemory, 0);
+        if (vmaCreateImage(allocator, &imageInfo, &allocInfo, &image, &imageAllocation, nullptr) != VK_SUCCESS)
+            throw std::runtime_error("failed to create image!");
     }
 
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) 
+    void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) 
     {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = oldLayout;
@@ -1201,114 +2291,202 @@ private:
             0, nullptr,
             1, &barrier
         );
-
-        endSingleTimeCommands(commandBuffer);
+        uploadEngine.countOperation();
     }
 
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    void loadModel()
+    {
+        const std::string cachePath = MeshCache::getCachePath(config.modelPath);
+
+        // a valid cache is mapped and later copied straight into the staging buffers
+        const uint32_t cacheFlags = (config.optimizeMeshes ? uint32_t{ MESH_CACHE_OPTIMIZED } : 0u) | (config.meshLods ? uint32_t{ MESH_CACHE_LODS } : 0u);
+        if (config.useMeshCache && meshCache.open(cachePath, config.modelPath, config.vertexFormat, cacheFlags)) {
+            vertexFormat = meshCache.getVertexFormat();
+            vertexQuantization = meshCache.getQuantization();
+            vertexData = meshCache.getVertexData();
+            indexData = meshCache.getIndexData();
+            indexType = meshCache.getIndexType();
+            meshLods.assign(meshCache.getLods().begin(), meshCache.getLods().end());
+            meshBoundingSphere = meshCache.getBoundingSphere();
+            meshMaterials = meshCache.getMaterials();
+            vertexMaterialData = meshCache.getVertexMaterials();
+            lodObjectCounts.assign(meshLods.size(), 0);
+            return;
+        }
 
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-
-        region.imageOffset = { 0, 0, 0 };
-        region.imageExtent = {
-            width,
-            height,
-            1
-        };
+        MeshData mesh = loadObjMesh(config.modelPath, &threadPool, hasVertexNormals(config.vertexFormat));
+        if (config.meshLods)
+            generateMeshLods(mesh);
+        if (config.optimizeMeshes)
+            optimizeMesh(mesh);
+
+        modelData = packMesh(mesh, config.vertexFormat, &threadPool);
+        vertexFormat = modelData.vertexFormat;
+        vertexQuantization = modelData.quantization;
+        vertexData = modelData.vertexData;
+        indexData = modelData.indexData;
+        indexType = modelData.indexType;
+        meshLods = modelData.lods;
+        meshBoundingSphere = modelData.boundingSphere;
+        meshMaterials = modelData.materials;
+        vertexMaterialData = modelData.vertexMaterials;
+        lodObjectCounts.assign(meshLods.size(), 0);
+
+        if (config.useMeshCache) {
+            try {
+                MeshCache::write(cachePath, config.modelPath, modelData, config.vertexFormat, cacheFlags);
+            }
+            catch (const std::exception& e) {
+                // not fatal, the next launch simply parses the OBJ again
+                std::cerr << "Mesh cache: " << e.what() << std::endl;
+            }
+        }
+    }
 
-        vkCmdCopyBufferToImage( commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    void createVertexBuffer()
+    {
+        VkDeviceSize bufferSize = vertexData.size_bytes();
 
-        endSingleTimeCommands(commandBuffer);
+        createBuffer(bufferSize, GEOMETRY_BUFFER_USAGE | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferAllocation, nullptr, geometryPool);
+        uploadEngine.uploadBuffer(vertexBuffer, 0, vertexData);
+        uploadEngine.releaseBuffer(vertexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
     }
 
-    void loadModel()
+    void createIndexBuffer()
     {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+        VkDeviceSize bufferSize = indexData.size_bytes();
 
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str())) {
-            throw std::runtime_error(warn + err);
-        }
+        createBuffer(bufferSize, GEOMETRY_BUFFER_USAGE | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferAllocation, nullptr, geometryPool);
+        uploadEngine.uploadBuffer(indexBuffer, 0, indexData);
+        uploadEngine.releaseBuffer(indexBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT);
+    }
 
-        std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+    // CPU half of the material textures, runs on a worker once loadModel() has the materials: decodes every
+    // distinct map_Kd once and builds its mip chain. A texture that cannot be loaded leaves its materials untextured.
+    void loadMaterialTextureData()
+    {
+        std::unordered_map<std::string, uint32_t> textureIndices{};
+        materialTextureIndices.assign(meshMaterials.size(), NO_TEXTURE);
+
+        for (size_t material{}; material < meshMaterials.size(); material++) {
+            const std::string& path = meshMaterials[material].texturePath;
+            if (path.empty())
+                continue;
+
+            auto found = textureIndices.find(path);
+            if (found != textureIndices.end()) {
+                materialTextureIndices[material] = found->second;
+                continue;
+            }
 
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                Vertex vertex{};
+            int texWidth, texHeight, texChannels;
+            stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (!pixels) {
+                std::cerr << "Material texture " << path << ": failed to load, drawing its materials untextured" << std::endl;
+                textureIndices.emplace(path, NO_TEXTURE);
+                continue;
+            }
 
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-                };
+            ImageData image{ static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight) };
+            image.pixels.assign(pixels, pixels + size_t{ image.width } * image.height * 4);
+            stbi_image_free(pixels);
 
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                };
+            // texture 0 is the --texture image
+            const uint32_t textureIndex = static_cast<uint32_t>(materialTextureMips.size()) + 1;
+            materialTextureMips.push_back(generateMipChain(image, true, config.mipFilter, &threadPool));
+            textureIndices.emplace(path, textureIndex);
+            materialTextureIndices[material] = textureIndex;
+        }
+    }
 
-                vertex.color = { 1.0f, 1.0f, 1.0f };
+    // GPU half of the material textures, every level of their CPU mip chains goes through the staging ring
+    void createMaterialTextures()
+    {
+        if (1 + materialTextureMips.size() > bindlessTextureCapacity)
+            throw std::runtime_error("too many material textures for the texture array!");
 
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                    vertices.push_back(vertex);
-                }
+        materialTextures.resize(materialTextureMips.size());
+        for (size_t idx{}; idx < materialTextureMips.size(); idx++) {
+            const std::vector<ImageData>& mips = materialTextureMips[idx];
+            MaterialTexture& texture = materialTextures[idx];
+            const VkExtent2D extent{ mips[0].width, mips[0].height };
+            const uint32_t levelCount = static_cast<uint32_t>(mips.size());
 
-                indices.push_back(uniqueVertices[vertex]);
-            }
+            std::vector<std::span<const std::byte>> levels{};
+            for (const ImageData& level : mips)
+                levels.push_back(std::as_bytes(std::span{ level.pixels }));
+
+            createImage(extent.width, extent.height, levelCount, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, texture.image, texture.allocation);
+            transitionImageLayout(uploadEngine.getTransferCommands(), texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount);
+            uploadEngine.uploadImage(texture.image, extent, levels, 4, 1);
+            uploadEngine.releaseImage(texture.image, levelCount, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+            texture.view = createImageView(texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
         }
+
+        // the data was copied into the staging ring
+        materialTextureMips.clear();
+
+        if (!meshMaterials.empty())
+            std::cout << "Materials: " << meshMaterials.size() << ", " << materialTextures.size() << " textures" << std::endl;
     }
 
-    void createVertexBuffer()
+    // Material 0 is the one of faces without a material: white and the --texture image. The vertex material
+    // buffer is bound even when the mesh has none, shader.vert then never reads it.
+    void createMaterialBuffers()
     {
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+        std::vector<MaterialData> materials{ { glm::vec4(1.0f), 0 } };
+        for (size_t material{}; material < meshMaterials.size(); material++)
+            materials.push_back({ meshMaterials[material].baseColor, materialTextureIndices[material] });
 
-        VkBuffer stagingBuffer{};
-        VkDeviceMemory stagingBufferMemory{};
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        const std::span<const std::byte> materialData = std::as_bytes(std::span(materials));
+        createBuffer(materialData.size_bytes(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, materialBuffer, materialBufferAllocation);
+        uploadEngine.uploadBuffer(materialBuffer, 0, materialData);
+        uploadEngine.releaseBuffer(materialBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        const uint32_t noVertexMaterials{};
+        const std::span<const std::byte> vertexMaterialBytes = vertexMaterialData.empty()
+            ? std::as_bytes(std::span(&noVertexMaterials, 1)) : std::as_bytes(vertexMaterialData);
+        createBuffer(vertexMaterialBytes.size_bytes(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexMaterialBuffer, vertexMaterialBufferAllocation);
+        uploadEngine.uploadBuffer(vertexMaterialBuffer, 0, vertexMaterialBytes);
+        uploadEngine.releaseBuffer(vertexMaterialBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
-        copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    // The object placement never changes, it is uploaded once like the geometry
+    void createObjectBuffer()
+    {
+        const std::span<const std::byte> objectData = std::as_bytes(std::span(objects));
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+        createBuffer(objectData.size_bytes(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, objectBuffer, objectBufferAllocation);
+        uploadEngine.uploadBuffer(objectBuffer, 0, objectData);
+        uploadEngine.releaseBuffer(objectBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
     }
 
-    void createIndexBuffer()
+    // The ring --draw-data dynamic writes every frame. The binding has to be valid in every mode, the
+    // others get a ring of one slot per frame that is never written.
+    void createDrawDataBuffer()
     {
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        const VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
 
-        void* data;
-        vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, stagingBufferMemory);
+        drawDataStride = (sizeof(DrawData) + alignment - 1) / alignment * alignment;
+        drawDataCapacity = drawDataMode == DrawDataMode::DynamicUniform ? std::max<size_t>(objects.size(), 1) : 1;
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+        void* mapped{};
+        createBuffer(config.framesInFlight * drawDataCapacity * drawDataStride, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, drawDataBuffer, drawDataBufferAllocation, &mapped);
+        drawDataMapped = static_cast<std::byte*>(mapped);
+    }
 
-        copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    void createCullingBuffers()
+    {
+        if (gpuCullingEnabled)
+            gpuCulling.createBuffers(uploadEngine, static_cast<uint32_t>(objects.size()), meshLods);
+    }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, stagingBufferMemory, nullptr);
+    void createCullingDescriptorSets()
+    {
+        if (gpuCullingEnabled)
+            gpuCulling.createDescriptorSets(objectBuffer);
     }
 
     // Function that allocates the buffers
@@ -1316,35 +2494,36 @@ private:
     {
         VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
-        uniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-		uniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
-        uniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
+        uniformBuffers.resize(config.framesInFlight);
+		uniformBuffersAllocation.resize(config.framesInFlight);
+        uniformBuffersMapped.resize(config.framesInFlight);
 
-        for (size_t idx{}; idx < MAX_FRAMES_IN_FLIGHT; idx++)
+        for (size_t idx{}; idx < config.framesInFlight; idx++)
         {
-            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[idx], uniformBuffersMemory[idx]);
-
-            // mapping of buffer to get a pointer to which we can write data
-            // => persistent mapping
-            vkMapMemory(device, uniformBuffersMemory[idx], 0, bufferSize, 0, &uniformBuffersMapped[idx]);
+            // persistently mapped, uniformBuffersMapped receives a pointer to which we can write data
+            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[idx], uniformBuffersAllocation[idx], &uniformBuffersMapped[idx]);
         }
     }
 
 	// Function to create pool for descriptor sets
     void createDescriptorPool()
     {
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
+        std::array<VkDescriptorPoolSize, 4> poolSizes{};
         poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[0].descriptorCount = config.framesInFlight;
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+        poolSizes[1].descriptorCount = config.framesInFlight * bindlessTextureCapacity;
+        poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[2].descriptorCount = config.framesInFlight * 3;
+        poolSizes[3].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[3].descriptorCount = config.framesInFlight;
 
         // pool size structure
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT); // max nr of descriptor sets that may be allocated
+        poolInfo.maxSets = config.framesInFlight; // max nr of descriptor sets that may be allocated
 
         if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
         {
@@ -1355,22 +2534,22 @@ private:
 	// Function to allocate descriptor sets
     void createDescriptorSets()
     {
-        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, descriptorSetLayout);
+        std::vector<VkDescriptorSetLayout> layouts(config.framesInFlight, descriptorSetLayout);
 
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocInfo.descriptorPool = descriptorPool; // Specify pool to allocate from
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT); // Number of sets to allocate
+        allocInfo.descriptorSetCount = config.framesInFlight; // Number of sets to allocate
 		allocInfo.pSetLayouts = layouts.data(); // Layout to base them on
 
 		// vector that holds the descriptor sets
-        descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
+        descriptorSets.resize(config.framesInFlight);
         if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to allocate descriptor sets!");
         }
 
-        for (size_t idx{}; idx < MAX_FRAMES_IN_FLIGHT; idx++) 
+        for (size_t idx{}; idx < config.framesInFlight; idx++) 
         {
             VkDescriptorBufferInfo bufferInfo{};
             bufferInfo.buffer = uniformBuffers[idx]; // specify buffer to bind
@@ -1378,12 +2557,36 @@ private:
             bufferInfo.offset = 0;
             bufferInfo.range = sizeof(UniformBufferObject);
 
-            VkDescriptorImageInfo imageInfo{};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = textureImageView;
-            imageInfo.sampler = textureSampler;
+            // texture 0 is the --texture image, the material textures follow
+            std::vector<VkDescriptorImageInfo> imageInfos(1 + materialTextures.size());
+            for (size_t texture{}; texture < imageInfos.size(); texture++) {
+                imageInfos[texture].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                imageInfos[texture].imageView = texture == 0 ? textureImageView : materialTextures[texture - 1].view;
+                imageInfos[texture].sampler = textureSampler;
+            }
+
+            VkDescriptorBufferInfo materialBufferInfo{};
+            materialBufferInfo.buffer = materialBuffer;
+            materialBufferInfo.offset = 0;
+            materialBufferInfo.range = VK_WHOLE_SIZE;
+
+            VkDescriptorBufferInfo vertexMaterialBufferInfo{};
+            vertexMaterialBufferInfo.buffer = vertexMaterialBuffer;
+            vertexMaterialBufferInfo.offset = 0;
+            vertexMaterialBufferInfo.range = VK_WHOLE_SIZE;
+
+            VkDescriptorBufferInfo objectBufferInfo{};
+            objectBufferInfo.buffer = objectBuffer;
+            objectBufferInfo.offset = 0;
+            objectBufferInfo.range = VK_WHOLE_SIZE;
 
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+            // the dynamic offset picks the slot
+            VkDescriptorBufferInfo drawDataBufferInfo{};
+            drawDataBufferInfo.buffer = drawDataBuffer;
+            drawDataBufferInfo.offset = 0;
+            drawDataBufferInfo.range = sizeof(DrawData);
+
+            std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
 
             descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
             descriptorWrites[0].dstSet = descriptorSets[idx]; // specify descriptor set to update
@@ -1398,15 +2601,49 @@ private:
             descriptorWrites[1].dstBinding = 1;
             descriptorWrites[1].dstArrayElement = 0;
             descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1;
-            descriptorWrites[1].pImageInfo = &imageInfo;
+            descriptorWrites[1].descriptorCount = static_cast<uint32_t>(imageInfos.size());
+            descriptorWrites[1].pImageInfo = imageInfos.data();
+
+            descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[2].dstSet = descriptorSets[idx];
+            descriptorWrites[2].dstBinding = 2;
+            descriptorWrites[2].dstArrayElement = 0;
+            descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[2].descriptorCount = 1;
+            descriptorWrites[2].pBufferInfo = &objectBufferInfo;
+
+            descriptorWrites[3].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[3].dstSet = descriptorSets[idx];
+            descriptorWrites[3].dstBinding = 3;
+            descriptorWrites[3].dstArrayElement = 0;
+            descriptorWrites[3].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            descriptorWrites[3].descriptorCount = 1;
+            descriptorWrites[3].pBufferInfo = &drawDataBufferInfo;
+
+            descriptorWrites[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[4].dstSet = descriptorSets[idx];
+            descriptorWrites[4].dstBinding = 4;
+            descriptorWrites[4].dstArrayElement = 0;
+            descriptorWrites[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[4].descriptorCount = 1;
+            descriptorWrites[4].pBufferInfo = &materialBufferInfo;
+
+            descriptorWrites[5].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[5].dstSet = descriptorSets[idx];
+            descriptorWrites[5].dstBinding = 5;
+            descriptorWrites[5].dstArrayElement = 0;
+            descriptorWrites[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[5].descriptorCount = 1;
+            descriptorWrites[5].pBufferInfo = &vertexMaterialBufferInfo;
 
             // update descriptor set
             vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
         }
     }
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) 
+    // Host visible buffers are persistently mapped and mapped receives the pointer.
+    // pool places the buffer in a custom VMA pool instead of the default blocks of its memory type.
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VmaAllocation& bufferAllocation, void** mapped = nullptr, VmaPool pool = nullptr) 
     {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1414,88 +2651,68 @@ private:
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create buffer!");
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.requiredFlags = properties;
+        allocInfo.pool = pool;
+        // readback buffers are only ever read on the CPU, all other mapped buffers only written
+        if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            allocInfo.flags |= usage == VK_BUFFER_USAGE_TRANSFER_DST_BIT ? VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT : VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+            allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate buffer memory!");
+        VmaAllocationInfo allocationInfo{};
+        if (vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &buffer, &bufferAllocation, &allocationInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create buffer!");
         }
 
-        vkBindBufferMemory(device, buffer, bufferMemory, 0);
+        if (mapped)
+            *mapped = allocationInfo.pMappedData;
     }
 
-    VkCommandBuffer beginSingleTimeCommands()
+    // Places config.objectCount copies of the model on a square grid around the origin, far enough apart
+    // that their bounding spheres never overlap
+    void createScene()
     {
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool;
-        allocInfo.commandBufferCount = 1;
+        const uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(config.objectCount))));
+        const float radius = std::max(meshBoundingSphere.w, 1e-3f);
+        const float spacing = 2.5f * radius;
+        const float halfExtent = 0.5f * spacing * static_cast<float>(columns - 1);
 
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+        scene = SceneGraph{};
+        scene.reserve(3 + size_t{ config.objectCount });
+        spinNode = scene.addNode(glm::mat4(1.0f));
+        cameraNode = scene.addNode(glm::mat4(1.0f));
+        gridNode = scene.addNode(glm::mat4(1.0f));
 
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        return commandBuffer;
-    }
-
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer)
-    {
-        vkEndCommandBuffer(commandBuffer);
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
-
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-    }
-
-    void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) 
-    {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        const uint32_t firstObjectNode = gridNode + 1;
+        for (uint32_t idx = 0; idx < config.objectCount; idx++) {
+            const glm::vec3 position{ spacing * static_cast<float>(idx % columns) - halfExtent, spacing * static_cast<float>(idx / columns) - halfExtent, 0.0f };
+            scene.addNode(glm::translate(glm::mat4(1.0f), position), gridNode);
+        }
+        scene.update(&threadPool);
 
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        objects.clear();
+        objects.reserve(config.objectCount);
+        for (uint32_t idx = 0; idx < config.objectCount; idx++)
+            objects.push_back({ scene.getWorld(firstObjectNode + idx) });
 
-        endSingleTimeCommands(commandBuffer);
+        sceneScale = (std::sqrt(2.0f) * halfExtent + radius) / radius;
+        sceneRadius = std::sqrt(2.0f) * halfExtent + glm::length(glm::vec3(meshBoundingSphere)) + radius;
     }
 
-    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) 
+    // Slices the draw list is recorded in, 1 = inline into the primary command buffer
+    uint32_t getRecordSliceCount() const
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
+        if (gpuCullingEnabled)
+            return 1;
 
-        throw std::runtime_error("failed to find suitable memory type!");
+        return std::min(config.recordThreads, config.objectCount);
     }
 
     void createCommandBuffers()
     {
-        commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        commandBuffers.resize(config.framesInFlight);
 
         VkCommandBufferAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -1506,6 +2723,36 @@ private:
         if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
             throw std::runtime_error("failed to allocate command buffers!");
         }
+
+        const uint32_t sliceCount = getRecordSliceCount();
+        if (sliceCount <= 1)
+            return;
+
+        QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+        // secondaries are re-recorded every frame, the pools are reset instead of the individual buffers
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+        secondaryCommandPools.assign(config.framesInFlight, std::vector<VkCommandPool>(sliceCount, VK_NULL_HANDLE));
+        secondaryCommandBuffers.assign(config.framesInFlight, std::vector<VkCommandBuffer>(sliceCount, VK_NULL_HANDLE));
+        for (uint32_t frame = 0; frame < config.framesInFlight; frame++) {
+            for (uint32_t slice = 0; slice < sliceCount; slice++) {
+                if (vkCreateCommandPool(device, &poolInfo, nullptr, &secondaryCommandPools[frame][slice]) != VK_SUCCESS)
+                    throw std::runtime_error("failed to create command pool!");
+
+                VkCommandBufferAllocateInfo secondaryAllocInfo{};
+                secondaryAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                secondaryAllocInfo.commandPool = secondaryCommandPools[frame][slice];
+                secondaryAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+                secondaryAllocInfo.commandBufferCount = 1;
+
+                if (vkAllocateCommandBuffers(device, &secondaryAllocInfo, &secondaryCommandBuffers[frame][slice]) != VK_SUCCESS)
+                    throw std::runtime_error("failed to allocate command buffers!");
+            }
+        }
     }
 
     void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) 
@@ -1530,56 +2777,291 @@ private:
         renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassInfo.pClearValues = clearValues.data();
 
-        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        if (statisticsQueryPool != VK_NULL_HANDLE)
+            vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, currentFrame, 1);
 
-            VkViewport viewport{};
-            viewport.x = 0.0f;
-            viewport.y = 0.0f;
-            viewport.width = static_cast<float>(swapChainExtent.width);
-            viewport.height = static_cast<float>(swapChainExtent.height);
-            viewport.minDepth = 0.0f;
-            viewport.maxDepth = 1.0f;
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        profiler.resetGpuFrame(commandBuffer, currentFrame);
+        const uint32_t frameRange = profiler.beginGpuRange(commandBuffer, currentFrame, "frame");
 
-            VkRect2D scissor{};
-            scissor.offset = { 0, 0 };
-            scissor.extent = swapChainExtent;
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        if (gpuCullingEnabled) {
+            const uint32_t cullRange = profiler.beginGpuRange(commandBuffer, currentFrame, "cull");
+            gpuCulling.recordCulling(commandBuffer, currentFrame, 0);
+            profiler.endGpuRange(commandBuffer, currentFrame, cullRange);
+        }
 
-            VkBuffer vertexBuffers[] = { vertexBuffer };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        const uint32_t renderPassRange = profiler.beginGpuRange(commandBuffer, currentFrame, "renderPass");
 
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        // outside the render pass, a subpass whose contents are secondary command buffers only takes vkCmdExecuteCommands
+        if (statisticsQueryPool != VK_NULL_HANDLE)
+            vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrame, 0);
 
-            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[currentFrame], 0, nullptr);
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+        if (!config.instancing && !gpuCullingEnabled)
+            buildDrawList();
 
-        vkCmdEndRenderPass(commandBuffer);
+        const uint32_t sliceCount = getRecordSliceCount();
+        std::vector<DrawStats> sliceStats(sliceCount);
+        if (sliceCount <= 1) {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+                recordDraws(commandBuffer, 0, objects.size(), sliceStats[0]);
+            vkCmdEndRenderPass(commandBuffer);
+
+            if (occlusionCullingEnabled)
+                recordOcclusionPhase(commandBuffer, renderPassInfo, sliceStats[0]);
+        }
+        else {
+            // the calling thread records a share of the slices too, see ThreadPool::parallelFor
+            threadPool.parallelFor(sliceCount, [&](size_t begin, size_t end) {
+                for (size_t slice = begin; slice < end; slice++)
+                    recordSlice(static_cast<uint32_t>(slice), imageIndex, sliceStats[slice]);
+            });
+
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                vkCmdExecuteCommands(commandBuffer, sliceCount, secondaryCommandBuffers[currentFrame].data());
+            vkCmdEndRenderPass(commandBuffer);
+        }
+
+        if (statisticsQueryPool != VK_NULL_HANDLE) {
+            vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrame);
+            statisticsQueryWritten[currentFrame] = true;
+        }
+
+        if (gpuCullingEnabled)
+            gpuCulling.recordReadback(commandBuffer, currentFrame);
+
+        profiler.endGpuRange(commandBuffer, currentFrame, renderPassRange);
+        profiler.endGpuRange(commandBuffer, currentFrame, frameRange);
 
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to record command buffer!");
         }
+
+        for (const DrawStats& stats : sliceStats) {
+            submittedTriangles += stats.triangles;
+            submittedDraws += stats.draws;
+            for (size_t lod = 0; lod < stats.lodCounts.size(); lod++)
+                lodObjectCounts[lod] += stats.lodCounts[lod];
+            bindsIssued += stats.bindsIssued;
+            bindsAvoided += stats.bindsAvoided;
+        }
+        renderedFrameCount++;
+    }
+
+    // Keys every object by its LOD and view depth and sorts them, so the draws of each LOD are recorded
+    // together, front to back. There is one pipeline and materials are per vertex, so both fields stay 0:
+    // sorting by pipeline and material is untested in this tree, the binds recordDraws() avoids are the
+    // repeated pipeline and descriptor set binds of consecutive draws.
+    // With --no-draw-sort the objects keep their order, to compare overdraw with --pipeline-stats.
+    void buildDrawList()
+    {
+        Profiler::Scope scope = profiler.scope("buildDrawList");
+
+        // the far plane of updateUniformBuffer()
+        const float farPlane = 10.0f * sceneScale;
+        drawList.resize(objects.size());
+
+        auto keyObjects = [&](size_t begin, size_t end) {
+            for (size_t idx = begin; idx < end; idx++) {
+                glm::mat4 model{};
+                multiplyTransforms(objects[idx].model, frameUniforms.model, model);
+                const glm::vec4 center = frameUniforms.view * (model * glm::vec4(glm::vec3(meshBoundingSphere), 1.0f));
+
+                // the view looks down -z
+                const uint64_t key = DrawList::makeKey(0, 0, selectLod(model), -center.z / farPlane);
+                drawList.setDraw(idx, key, static_cast<uint32_t>(idx));
+            }
+        };
+
+        if (objects.size() >= MIN_PARALLEL_DRAW_KEYS)
+            threadPool.parallelFor(objects.size(), keyObjects, MIN_PARALLEL_DRAW_KEYS / 4);
+        else
+            keyObjects(0, objects.size());
+
+        if (config.sortDraws)
+            drawList.sort();
+    }
+
+    // Second phase of --occlusion-culling, after the first render pass drew what was visible last frame: builds
+    // the depth pyramid from it, culls every object against it and draws the ones that just became visible
+    void recordOcclusionPhase(VkCommandBuffer commandBuffer, VkRenderPassBeginInfo renderPassInfo, DrawStats& stats)
+    {
+        const uint32_t pyramidRange = profiler.beginGpuRange(commandBuffer, currentFrame, "depthPyramid");
+        depthPyramid.record(commandBuffer);
+        profiler.endGpuRange(commandBuffer, currentFrame, pyramidRange);
+
+        const uint32_t cullRange = profiler.beginGpuRange(commandBuffer, currentFrame, "occlusionCull");
+        gpuCulling.recordCulling(commandBuffer, currentFrame, 1);
+        profiler.endGpuRange(commandBuffer, currentFrame, cullRange);
+
+        renderPassInfo.renderPass = occlusionRenderPass;
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordDraws(commandBuffer, 0, objects.size(), stats, 1);
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    // Records one slice of the draw list into its secondary command buffer for the current frame.
+    // Runs on worker threads: it only touches the slice's own pool, command buffer and stats.
+    void recordSlice(uint32_t slice, uint32_t imageIndex, DrawStats& stats)
+    {
+        Profiler::Scope scope = profiler.scope("recordSlice");
+
+        // the frame's timeline value has been reached, nothing recorded from this pool is still in use
+        vkResetCommandPool(device, secondaryCommandPools[currentFrame][slice], 0);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
+        if (statisticsQueryPool != VK_NULL_HANDLE)
+            inheritanceInfo.pipelineStatistics = STATISTICS_QUERY_FLAGS;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+        VkCommandBuffer commandBuffer = secondaryCommandBuffers[currentFrame][slice];
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+            throw std::runtime_error("failed to begin recording command buffer!");
+
+        // contiguous, near equal shares of the objects
+        const uint32_t sliceCount = getRecordSliceCount();
+        const size_t begin = objects.size() * slice / sliceCount;
+        const size_t end = objects.size() * (slice + 1) / sliceCount;
+        recordDraws(commandBuffer, begin, end, stats);
+
+        if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+            throw std::runtime_error("failed to record command buffer!");
+    }
+
+    // Records the draws [begin, end) of the draw list inside the render pass, or of the objects when instanced.
+    // Sets all the state they need because secondary command buffers inherit none of it. Each draw of the
+    // list binds its pipeline and descriptor set through a DrawStateTracker, which skips the binds repeating
+    // what is bound, and picks its LOD's index range with firstIndex. cullingPhase picks the GPU culling
+    // commands to draw.
+    void recordDraws(VkCommandBuffer commandBuffer, size_t begin, size_t end, DrawStats& stats, uint32_t cullingPhase = 0) const
+    {
+        DrawStateTracker state{ commandBuffer };
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(swapChainExtent.width);
+        viewport.height = static_cast<float>(swapChainExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = swapChainExtent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        VkBuffer vertexBuffers[] = { vertexBuffer };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+
+        // the first slot of this frame's part of the draw data ring, moved per draw by --draw-data dynamic
+        const uint32_t frameDrawDataOffset = static_cast<uint32_t>(currentFrame * drawDataCapacity * drawDataStride);
+
+        stats.lodCounts.resize(meshLods.size(), 0);
+
+        if (gpuCullingEnabled || (config.instancing && begin != end)) {
+            state.bindPipeline(graphicsPipeline);
+            state.bindDescriptorSet(pipelineLayout, descriptorSets[currentFrame], frameDrawDataOffset);
+        }
+
+        // what is drawn is only known on the GPU, see collectCullingStatistics()
+        if (gpuCullingEnabled) {
+            gpuCulling.recordDraw(commandBuffer, currentFrame, cullingPhase);
+            stats.draws++;
+            addBindCounts(state, stats);
+            return;
+        }
+
+        if (begin == end) {
+            addBindCounts(state, stats);
+            return;
+        }
+
+        // one draw for the whole range, objects[begin] is its first instance
+        if (config.instancing) {
+            const uint32_t lodIndex = selectSceneLod();
+            const MeshLod& lod = meshLods[lodIndex];
+            const uint32_t instanceCount = static_cast<uint32_t>(end - begin);
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, instanceCount, lod.indexOffset, 0, static_cast<uint32_t>(begin));
+
+            stats.triangles += static_cast<uint64_t>(lod.indexCount / 3) * instanceCount;
+            stats.draws++;
+            stats.lodCounts[lodIndex] += instanceCount;
+            addBindCounts(state, stats);
+            return;
+        }
+
+        // the pipelines a key can select, only the one so far
+        const VkPipeline keyPipelines[] = { graphicsPipeline };
+
+        for (size_t draw = begin; draw < end; draw++) {
+            const uint64_t key = drawList.getKey(draw);
+            const uint32_t idx = drawList.getObject(draw);
+            const uint32_t lodIndex = DrawList::getMesh(key);
+            const MeshLod& lod = meshLods[lodIndex];
+
+            DrawData drawData{};
+            uint32_t drawDataOffset = frameDrawDataOffset;
+            if (drawDataMode != DrawDataMode::Storage) {
+                // every copy spins in place, as in shader.vert
+                glm::mat4 model{};
+                multiplyTransforms(objects[idx].model, frameUniforms.model, model);
+
+                multiplyTransforms(frameUniforms.viewProj, model, drawData.mvp);
+                drawData.objectIndex = idx;
+
+                if (drawDataMode == DrawDataMode::DynamicUniform) {
+                    // every object owns its slot, the slices recorded in parallel never write the same one
+                    drawDataOffset += static_cast<uint32_t>(idx * drawDataStride);
+                    memcpy(drawDataMapped + drawDataOffset, &drawData, sizeof(drawData));
+                }
+            }
+
+            state.bindPipeline(keyPipelines[DrawList::getPipeline(key)]);
+            state.bindDescriptorSet(pipelineLayout, descriptorSets[currentFrame], drawDataOffset);
+
+            if (drawDataMode == DrawDataMode::PushConstants)
+                vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(drawData), &drawData);
+
+            vkCmdDrawIndexed(commandBuffer, lod.indexCount, 1, lod.indexOffset, 0, idx);
+
+            stats.triangles += lod.indexCount / 3;
+            stats.draws++;
+            stats.lodCounts[lodIndex]++;
+        }
+
+        addBindCounts(state, stats);
+    }
+
+    static void addBindCounts(const DrawStateTracker& state, DrawStats& stats)
+    {
+        stats.bindsIssued += state.getBindsIssued();
+        stats.bindsAvoided += state.getBindsAvoided();
     }
 
     void createSyncObjects()
     {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+        imageAvailableSemaphores.resize(config.framesInFlight);
+        renderFinishedSemaphores.resize(config.framesInFlight);
+        frameTimelineValues.assign(config.framesInFlight, 0);
+        frameInputSampleTimes.assign(config.framesInFlight, std::nullopt);
 
+        // the swapchain only takes binary semaphores, everything else waits on graphicsTimeline
         VkSemaphoreCreateInfo semaphoreInfo{};
         semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-        VkFenceCreateInfo fenceInfo{};
-        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < config.framesInFlight; i++) {
             if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(device, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+                vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) != VK_SUCCESS) {
 
                 throw std::runtime_error("failed to create synchronization objects for a frame!");
             }
@@ -1587,78 +3069,259 @@ private:
 
     }
 
+    // One pipeline statistics query per frame in flight, read back once its timeline value has been reached
+    void createStatisticsQueryPool()
+    {
+        if (!config.pipelineStatistics)
+            return;
+
+        if (!pipelineStatisticsSupported) {
+            std::cerr << "Pipeline statistics queries are not supported by this device" << std::endl;
+            return;
+        }
+
+        if (getRecordSliceCount() > 1 && !inheritedQueriesSupported) {
+            std::cerr << "Pipeline statistics of secondary command buffers are not supported by this device" << std::endl;
+            return;
+        }
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = config.framesInFlight;
+        poolInfo.pipelineStatistics = STATISTICS_QUERY_FLAGS;
+
+        if (vkCreateQueryPool(device, &poolInfo, nullptr, &statisticsQueryPool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+
+        statisticsQueryWritten.assign(config.framesInFlight, false);
+    }
+
+    // --trace: timestamps around the passes of every frame in flight, calibrated against the CPU clock once
+    void createTimestampQueryPool()
+    {
+        if (!profiler.isEnabled())
+            return;
+
+        QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        if (!profiler.initGpu(physicalDevice, device, indices.graphicsFamily.value(), config.framesInFlight)) {
+            std::cerr << "Timestamp queries are not supported by the graphics queue, the trace only has CPU events" << std::endl;
+            return;
+        }
+
+        profiler.writeCalibration(uploadEngine.getGraphicsCommands());
+        uploadEngine.countOperation();
+        uploadEngine.wait(uploadEngine.submit());
+        profiler.finishCalibration();
+    }
+
+    // Must be called after the frame's timeline value was waited for
+    void collectPipelineStatistics()
+    {
+        if (statisticsQueryPool == VK_NULL_HANDLE || !statisticsQueryWritten[currentFrame])
+            return;
+
+        // results come in bit order: input assembly primitives, vertex shader invocations, fragment shader invocations
+        std::array<uint64_t, 3> results{};
+        if (vkGetQueryPoolResults(device, statisticsQueryPool, currentFrame, 1, sizeof(results), results.data(), sizeof(results), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            statisticsPrimitives += results[0];
+            vertexShaderInvocations += results[1];
+            fragmentShaderInvocations += results[2];
+            statisticsFrameCount++;
+        }
+
+        statisticsQueryWritten[currentFrame] = false;
+    }
+
+    // Adds what the culling pass of frame drew to the totals, must be called after its timeline value was waited for
+    void collectCullingStatistics(uint32_t frame)
+    {
+        if (!gpuCullingEnabled)
+            return;
+
+        GpuCulling::Counts counts{};
+        if (!gpuCulling.collect(frame, counts))
+            return;
+
+        for (size_t lod = 0; lod < counts.lodObjects.size(); lod++) {
+            lodObjectCounts[lod] += counts.lodObjects[lod];
+            visibleObjects += counts.lodObjects[lod];
+            submittedTriangles += counts.lodObjects[lod] * (meshLods[lod].indexCount / 3);
+        }
+        frustumCulledObjects += counts.frustumCulled;
+        occlusionCulledObjects += counts.occlusionCulled;
+        cullingFrameCount++;
+    }
+
     // Generate a new transformation every frame to make geometry spin around
     void updateUniformBuffer(uint32_t currentImage)
     {
         // Calculate time in seconds
-        static auto startTime = std::chrono::high_resolution_clock::now();
-
 		auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - animationStartTime).count();
+        // headless and measured runs animate at a fixed 60 frames per second so every run renders the same frames
+        const bool fixedTimestep = config.headless || !config.frameBenchmarkPath.empty();
+        if (fixedTimestep)
+            time = static_cast<float>(renderedFrameCount) / 60.0f;
+
+        // --frame-bench follows a fixed path around the model that moves in and out, so LODs and fill rate vary
+        glm::vec3 cameraPosition{ 2.0f, 2.0f, 2.0f };
+        if (!config.frameBenchmarkPath.empty()) {
+            const float angle = time * glm::radians(45.0f);
+            const float distance = 3.5f + 1.5f * std::sin(time * 0.5f);
+            cameraPosition = distance * glm::normalize(glm::vec3(std::cos(angle), std::sin(angle), 1.0f));
+        }
+        // back far enough to see the whole --objects grid
+        cameraPosition *= sceneScale;
         
+        // only the spin and the camera move, the objects below gridNode are not touched
+        scene.setLocal(spinNode, glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+        scene.setLocal(cameraNode, glm::inverse(glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f))));
+        scene.update(&threadPool);
+
         // Define model, view and projection transformations in UBO
         UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
+        ubo.model = scene.getWorld(spinNode);
+        ubo.view = glm::inverse(scene.getWorld(cameraNode));
+        ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f * sceneScale);
         ubo.proj[1][1] *= -1;
+        multiplyTransforms(ubo.proj, ubo.view, ubo.viewProj);
+        ubo.positionOffset = glm::vec4(vertexQuantization.offset, 0.0f);
+        ubo.positionScale = glm::vec4(vertexQuantization.scale, 1.0f);
 
         // Copy data in UBO to current uniform buffer (! without staging buffer)
         memcpy(uniformBuffersMapped[currentImage], &ubo, sizeof(ubo));
+        frameUniforms = ubo;
+
+        if (gpuCullingEnabled)
+            gpuCulling.update(currentImage, { ubo.model, ubo.view, ubo.proj, meshBoundingSphere, static_cast<float>(swapChainExtent.height), config.lodErrorPixels });
+    }
+
+    // Picks the coarsest LOD of an object drawn with model whose error, projected at the point of the
+    // bounding sphere closest to the camera, stays below config.lodErrorPixels
+    uint32_t selectLod(const glm::mat4& model) const
+    {
+        const glm::mat4 modelView = frameUniforms.view * model;
+        const glm::vec3 center = glm::vec3(modelView * glm::vec4(glm::vec3(meshBoundingSphere), 1.0f));
+        const float scale = std::max({ glm::length(glm::vec3(model[0])),
+            glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+
+        // the view looks down -z
+        return selectLod(-center.z - meshBoundingSphere.w * scale, scale);
+    }
+
+    // LOD for drawing every object at once: the one the closest possible object needs, at the point of the
+    // scene's bounding sphere nearest to the camera
+    uint32_t selectSceneLod() const
+    {
+        const float centerDepth = -(frameUniforms.view * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).z;
+        return selectLod(centerDepth - sceneRadius, 1.0f);
+    }
+
+    // Coarsest LOD whose error, for a model drawn with scale at distance in front of the camera, stays below
+    // config.lodErrorPixels. A camera inside the bounding sphere always gets full detail.
+    uint32_t selectLod(float distance, float scale) const
+    {
+        if (distance <= 1e-4f)
+            return 0;
+
+        // proj[1][1] is cot(fov / 2), half the viewport height covers one unit at distance 1
+        const float pixelsPerUnit = std::abs(frameUniforms.proj[1][1]) * 0.5f * static_cast<float>(swapChainExtent.height) / distance;
+
+        uint32_t selected = 0;
+        for (uint32_t lod = 1; lod < meshLods.size(); lod++)
+            if (meshLods[lod].error * scale * pixelsPerUnit <= config.lodErrorPixels)
+                selected = lod;
+
+        return selected;
     }
 
     void drawFrame()
     {
-        vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        Profiler::Scope frameScope = profiler.scope("drawFrame");
+
+        auto start = std::chrono::high_resolution_clock::now();
+        graphicsTimeline.wait(frameTimelineValues[currentFrame]);
+        frameTiming.fenceWaitMs = endFramePhase("waitForFrame", start);
+        collectFrameLatency(currentFrame);
+        collectPipelineStatistics();
+        collectCullingStatistics(currentFrame);
+        profiler.collectGpuFrame(currentFrame);
         
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            recreateSwapChain();
-            return;
+        // offscreen targets are not shared with a presentation engine, the timeline wait above is enough
+        uint32_t imageIndex = currentFrame;
+        if (!config.headless) {
+            start = std::chrono::high_resolution_clock::now();
+            VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            frameTiming.acquireMs = endFramePhase("acquireImage", start);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                recreateSwapChain();
+                return;
+            }
+            else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error("failed to acquire swap chain image!");
+            }
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw std::runtime_error("failed to acquire swap chain image!");
+
+        if (config.lowLatency) {
+            start = std::chrono::high_resolution_clock::now();
+            waitForPreviousFrame();
+            frameTiming.pacingMs = endFramePhase("pacing", start);
+            sampleInput();
         }
 
+        start = std::chrono::high_resolution_clock::now();
         updateUniformBuffer(currentFrame);
 
-        vkResetFences(device, 1, &inFlightFences[currentFrame]);
-
         vkResetCommandBuffer(commandBuffers[currentFrame], 0);
         recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
-
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
-
-        VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+        frameTiming.recordMs = endFramePhase("recordCommands", start);
+        recordTimeMs += frameTiming.recordMs;
+
+        // headless frames have no image to wait for and nothing to present
+        VkSemaphore imageAvailable = config.headless ? VK_NULL_HANDLE : imageAvailableSemaphores[currentFrame];
+        VkSemaphore renderFinished = config.headless ? VK_NULL_HANDLE : renderFinishedSemaphores[currentFrame];
+
+        start = std::chrono::high_resolution_clock::now();
+        frameTimelineValues[currentFrame] = graphicsTimeline.submit({ &commandBuffers[currentFrame], 1 }, {},
+            imageAvailable, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, renderFinished);
+        frameTiming.submitMs = endFramePhase("submit", start);
+
+        lastImageIndex = imageIndex;
+        if (!presentWaitEnabled)
+            frameInputSampleTimes[currentFrame] = inputSampleTime;
+        if (config.headless) {
+            currentFrame = (currentFrame + 1) % config.framesInFlight;
+            return;
         }
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &renderFinished;
 
         VkSwapchainKHR swapChains[] = { swapChain };
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapChains;
         presentInfo.pImageIndices = &imageIndex;
 
-        result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        // lets waitForPresent() find this frame again, see collectPresentLatency()
+        const uint64_t framePresentId = presentId + 1;
+        VkPresentIdKHR presentIdInfo{};
+        presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &framePresentId;
+        if (presentWaitEnabled)
+            presentInfo.pNext = &presentIdInfo;
+
+        start = std::chrono::high_resolution_clock::now();
+        VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
+        frameTiming.presentMs = endFramePhase("present", start);
+        if (presentWaitEnabled && (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR)) {
+            presentId = framePresentId;
+            pendingPresents.push_back({ presentId, inputSampleTime });
+        }
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
             framebufferResized = false;
             recreateSwapChain();
@@ -1667,7 +3330,68 @@ private:
             throw std::runtime_error("failed to present swap chain image!");
         }
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        currentFrame = (currentFrame + 1) % config.framesInFlight;
+    }
+
+    // Polls window events, the point a frame's latency is measured from
+    void sampleInput()
+    {
+        if (!config.headless)
+            glfwPollEvents();
+        inputSampleTime = std::chrono::high_resolution_clock::now();
+    }
+
+    // --low-latency: blocks until the previous frame was presented, or until its GPU work is done without present
+    // wait, so the input sampled next is shown as soon as possible instead of queuing behind earlier frames
+    void waitForPreviousFrame()
+    {
+        if (presentWaitEnabled) {
+            collectPresentLatency(UINT64_MAX);
+            return;
+        }
+
+        const uint32_t previousFrame = (currentFrame + config.framesInFlight - 1) % config.framesInFlight;
+        graphicsTimeline.wait(frameTimelineValues[previousFrame]);
+        collectFrameLatency(previousFrame);
+    }
+
+    // Adds the latency of the frame last submitted in frame, whose timeline value has just been waited for. That can be
+    // later than its GPU work finished, so this is an upper bound; with present wait the frames are collected
+    // once they are presented instead.
+    void collectFrameLatency(uint32_t frame)
+    {
+        if (presentWaitEnabled) {
+            collectPresentLatency(0);
+            return;
+        }
+
+        if (frameInputSampleTimes[frame]) {
+            addLatencySample(*frameInputSampleTimes[frame]);
+            frameInputSampleTimes[frame].reset();
+        }
+    }
+
+    // Adds the latency of every frame presented by now, waiting up to timeout nanoseconds for each. Without
+    // --low-latency this is polled once a frame and may count up to a frame more than the actual latency.
+    void collectPresentLatency(uint64_t timeout)
+    {
+        while (!pendingPresents.empty()) {
+            const auto [id, sampleTime] = pendingPresents.front();
+            const VkResult result = waitForPresent(device, swapChain, id, timeout);
+            if (result == VK_TIMEOUT)
+                return;
+
+            // an out of date swapchain never reports the present, the frame is dropped from the average
+            pendingPresents.pop_front();
+            if (result == VK_SUCCESS)
+                addLatencySample(sampleTime);
+        }
+    }
+
+    void addLatencySample(std::chrono::high_resolution_clock::time_point sampleTime)
+    {
+        latencyMs += millisecondsSince(sampleTime);
+        latencySampleCount++;
     }
 
     VkShaderModule createShaderModule(const std::vector<char>& code) 
@@ -1696,17 +3420,35 @@ private:
         return availableFormats[0];
     }
 
+    // Picks config.presentMode and remembers the choice in presentMode. FIFO is the one mode every
+    // surface supports, so it replaces a requested mode that is missing.
     VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) 
     {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                return availablePresentMode;
-            }
+        auto isAvailable = [&](PresentMode mode) {
+            const auto vulkanMode = std::find_if(vulkanPresentModes.begin(), vulkanPresentModes.end(), [mode](const auto& entry) { return entry.first == mode; });
+            return std::find(availablePresentModes.begin(), availablePresentModes.end(), vulkanMode->second) != availablePresentModes.end();
+        };
+
+        presentMode = config.presentMode;
+        if (presentMode == PresentMode::Auto)
+            presentMode = isAvailable(PresentMode::Mailbox) ? PresentMode::Mailbox : PresentMode::Fifo;
+        else if (!isAvailable(presentMode)) {
+            std::cerr << "Present mode " << getPresentModeName(presentMode) << " is not supported by the surface, using fifo" << std::endl;
+            presentMode = PresentMode::Fifo;
         }
 
+        for (const auto& [mode, vulkanMode] : vulkanPresentModes)
+            if (mode == presentMode)
+                return vulkanMode;
+
         return VK_PRESENT_MODE_FIFO_KHR;
     }
 
+    const char* getActivePresentModeName() const
+    {
+        return config.headless ? "offscreen" : getPresentModeName(presentMode);
+    }
+
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) 
     {
         if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
@@ -1734,8 +3476,9 @@ private:
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        // headless devices only need to render
+        bool swapChainAdequate = config.headless;
+        if (extensionsSupported && !config.headless) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -1743,7 +3486,63 @@ private:
         VkPhysicalDeviceFeatures supportedFeatures;
         vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+        return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy
+            && supportsBindlessTextures(device) && supportsTimelineSemaphores(device);
+    }
+
+    bool supportsTimelineSemaphores(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphoreFeatures{};
+        timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &timelineSemaphoreFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return timelineSemaphoreFeatures.timelineSemaphore;
+    }
+
+    // The descriptor indexing features the texture array in shader.frag relies on
+    bool supportsBindlessTextures(VkPhysicalDevice device)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device, &properties);
+        if (properties.apiVersion < VK_API_VERSION_1_1)
+            return false;
+
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+        descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &descriptorIndexingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing
+            && descriptorIndexingFeatures.descriptorBindingPartiallyBound
+            && descriptorIndexingFeatures.runtimeDescriptorArray;
+    }
+
+    // VK_KHR_present_id and VK_KHR_present_wait with both of their features
+    bool supportsPresentWait(VkPhysicalDevice device)
+    {
+        for (const char* extension : presentWaitDeviceExtensions)
+            if (!hasDeviceExtension(device, extension))
+                return false;
+
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+
+        return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
     }
 
     bool checkDeviceExtensionSupport(VkPhysicalDevice device) 
@@ -1754,7 +3553,8 @@ private:
         std::vector<VkExtensionProperties> availableExtensions(extensionCount);
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+        const std::vector<const char*> extensions = getDeviceExtensions();
+        std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
         for (const auto& extension : availableExtensions) {
             requiredExtensions.erase(extension.extensionName);
@@ -1764,6 +3564,29 @@ private:
 
     }
 
+    bool hasDeviceExtension(VkPhysicalDevice device, const char* name)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        return std::any_of(availableExtensions.begin(), availableExtensions.end(),
+            [name](const VkExtensionProperties& extension) { return strcmp(extension.extensionName, name) == 0; });
+    }
+
+    // The swapchain extension is only needed when there is something to present to
+    std::vector<const char*> getDeviceExtensions() const
+    {
+        std::vector<const char*> extensions = bindlessDeviceExtensions;
+        extensions.insert(extensions.end(), timelineDeviceExtensions.begin(), timelineDeviceExtensions.end());
+        if (!config.headless)
+            extensions.insert(extensions.end(), deviceExtensions.begin(), deviceExtensions.end());
+
+        return extensions;
+    }
+
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) 
     {
         QueueFamilyIndices indices;
@@ -1783,8 +3606,12 @@ private:
                 indices.graphicsFamily = i;
             }
 
+            // without a surface nothing is presented, the graphics family stands in for the present one
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (config.headless)
+                presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            else
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
             if (presentSupport) {
                 indices.presentFamily = i;
@@ -1797,6 +3624,28 @@ private:
             i++;
         }
 
+        // dedicated transfer families (DMA engines) copy without occupying the graphics queue;
+        // prefer one with neither graphics nor compute, then any without graphics. A granularity of
+        // (0, 0, 0) only copies whole levels, which would have to fit into the staging ring at once.
+        for (int pass = 0; pass < 2 && !indices.transferFamily; pass++) {
+            const VkQueueFlags excluded = pass == 0 ? VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT : VK_QUEUE_GRAPHICS_BIT;
+            for (uint32_t family = 0; family < queueFamilyCount; family++) {
+                const VkQueueFamilyProperties& properties = queueFamilies[family];
+                if (properties.minImageTransferGranularity.height == 0)
+                    continue;
+
+                if ((properties.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(properties.queueFlags & excluded)) {
+                    indices.transferFamily = family;
+                    indices.transferGranularity = properties.minImageTransferGranularity;
+                    break;
+                }
+            }
+        }
+
+        // graphics families always report (1, 1, 1)
+        if (!indices.transferFamily)
+            indices.transferFamily = indices.graphicsFamily;
+
         return indices;
     }
 
@@ -1828,11 +3677,15 @@ private:
 	// Function that will return required list of extensions based on whether validation layers are enabled
     std::vector<const char*> getRequiredExtensions() 
     {
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions{};
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        // headless mode never initializes GLFW and needs no surface extensions
+        if (!config.headless) {
+		    uint32_t glfwExtensionCount = 0;
+		    const char** glfwExtensions;
+		    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1898,10 +3751,28 @@ private:
     }
 };
 
-int main() {
-    HelloTriangleApplication app;
+int main(int argc, char** argv) {
+    AppConfig config{};
+    try {
+        config = parseCommandLine(argc, argv);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return EXIT_FAILURE;
+    }
 
     try {
+        if (!config.benchmark.empty()) {
+            if (!runBenchmark(config)) {
+                std::cerr << "unknown benchmark: " << config.benchmark << std::endl;
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+
+        HelloTriangleApplication app{ config };
         app.run();
     }
     catch (const std::exception& e) {
@@ -0,0 +1,160 @@
+// Encodes an image into block compressed KTX2 files with a precomputed mip chain, one file per format.
+// Run by the build; the renderer picks the first format the device can sample, see getCompressedTexturePath().
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "Ktx2Texture.h"
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    void printUsage()
+    {
+        std::cerr <<
+            "usage: TextureConverter <image> [options]\n"
+            "  --formats <list>   comma separated, any of bc7, astc, etc2, bc3, bc1\n"
+            "                     (default: all, bc3 only for translucent and bc1 only for opaque images)\n"
+            "  --linear           treat the color channels as linear data instead of sRGB\n"
+            "  --mip-filter <f>   box or kaiser (default: kaiser)\n"
+            "  --threads <n>      worker threads (0 = all cores)\n";
+    }
+
+    std::vector<TextureCompression> parseFormats(const std::string& list)
+    {
+        std::vector<TextureCompression> formats{};
+        std::stringstream stream{ list };
+        std::string name{};
+        while (std::getline(stream, name, ',')) {
+            std::optional<TextureCompression> compression = findTextureCompression(name);
+            if (!compression)
+                throw std::invalid_argument("unknown texture format: " + name);
+
+            formats.push_back(*compression);
+        }
+
+        return formats;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    const std::string sourcePath = argv[1];
+    std::vector<TextureCompression> formats{};
+    bool srgb = true;
+    MipFilter mipFilter = MipFilter::Kaiser;
+    uint32_t threadCount = 0;
+
+    try {
+        for (int idx = 2; idx < argc; idx++) {
+            const std::string option = argv[idx];
+            if (option == "--formats" && idx + 1 < argc)
+                formats = parseFormats(argv[++idx]);
+            else if (option == "--linear")
+                srgb = false;
+            else if (option == "--mip-filter" && idx + 1 < argc) {
+                const std::string name = argv[++idx];
+                std::optional<MipFilter> filter = findMipFilter(name);
+                if (!filter)
+                    throw std::invalid_argument("unknown mip filter: " + name);
+                mipFilter = *filter;
+            }
+            else if (option == "--threads" && idx + 1 < argc)
+                threadCount = static_cast<uint32_t>(std::stoul(argv[++idx]));
+            else
+                throw std::invalid_argument("unknown option: " + option);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    int width{}, height{}, channels{};
+    stbi_uc* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cerr << "failed to load " << sourcePath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ImageData image{ static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    image.pixels.assign(pixels, pixels + size_t{ image.width } * image.height * 4);
+    stbi_image_free(pixels);
+
+    const bool hasAlpha = hasTranslucentTexels(image);
+    if (formats.empty()) {
+        for (TextureCompression compression : TEXTURE_COMPRESSIONS) {
+            if (compression == (hasAlpha ? TextureCompression::Bc1 : TextureCompression::Bc3))
+                continue;
+            formats.push_back(compression);
+        }
+    }
+
+    ThreadPool threadPool{ threadCount };
+    auto mipStart = std::chrono::high_resolution_clock::now();
+    const std::vector<ImageData> mipChain = generateMipChain(image, srgb, mipFilter, &threadPool);
+    auto mipEnd = std::chrono::high_resolution_clock::now();
+
+    size_t uncompressedSize = 0;
+    for (const ImageData& level : mipChain)
+        uncompressedSize += level.pixels.size();
+
+    // the timings below are printed in fixed point, the stream gets its own formatting back at the end
+    const std::ios::fmtflags flags = std::cout.flags();
+    const std::streamsize precision = std::cout.precision();
+
+    std::cout << sourcePath << ": " << image.width << "x" << image.height << ", " << mipChain.size() << " levels, "
+        << (hasAlpha ? "translucent" : "opaque") << ", RGBA8 " << uncompressedSize / 1024 << " KiB, " << getMipFilterName(mipFilter) << " mips in " << std::fixed
+        << std::setprecision(1) << std::chrono::duration<double, std::milli>(mipEnd - mipStart).count() << " ms\n";
+
+    int status = EXIT_SUCCESS;
+    try {
+        for (TextureCompression compression : formats) {
+            if (compression == TextureCompression::Bc1 && hasAlpha)
+                std::cerr << "warning: bc1 drops the alpha channel of " << sourcePath << std::endl;
+
+            const VkFormat format = getCompressedFormat(compression, hasAlpha, srgb);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::vector<std::byte>> levels{};
+            size_t compressedSize = 0;
+            for (const ImageData& level : mipChain) {
+                levels.push_back(compressImage(level, format, &threadPool));
+                compressedSize += levels.back().size();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+
+            const std::string outputPath = getCompressedTexturePath(sourcePath, compression);
+            Ktx2Texture::write(outputPath, format, image.width, image.height, levels);
+
+            std::cout << "  " << std::left << std::setw(6) << getTextureCompressionName(compression) << std::right
+                << std::setw(8) << compressedSize / 1024 << " KiB (" << std::fixed << std::setprecision(1)
+                << 100.0 * static_cast<double>(compressedSize) / static_cast<double>(uncompressedSize) << "%) in "
+                << std::chrono::duration<double, std::milli>(end - start).count() << " ms -> " << outputPath << "\n";
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        status = EXIT_FAILURE;
+    }
+
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+
+    return status;
+}
@@ -0,0 +1,58 @@
+// Writes the vertex shader inputs for every layout in src/VertexLayout.h, and the list of layouts as
+// "<define> <name>" lines. Run by the build into the build directory; shader.vert includes the inputs
+// and picks a block with -DVERTEX_FORMAT_<NAME>, compile.bat compiles it once per line of the list.
+
+#include "VertexLayout.h"
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+    std::string toDefineName(const std::string& name)
+    {
+        std::string define = "VERTEX_FORMAT_";
+        for (char c : name)
+            define += c == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+
+        return define;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cerr << "usage: VertexLayoutGen <output.glsl> <layouts.txt>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string source = "// Generated by tools/VertexLayoutGen.cpp from src/VertexLayout.h, do not edit\n\n";
+    std::string layouts{};
+
+    bool first = true;
+    forEachVertexLayout([&](auto layout) {
+        using Layout = decltype(layout);
+
+        source += std::string(first ? "#if" : "#elif") + " defined(" + toDefineName(Layout::name) + ")\n";
+        source += "// " + std::string(Layout::name) + ": " + std::to_string(Layout::stride) + " bytes per vertex\n";
+        source += Layout::getShaderInputs();
+        layouts += toDefineName(Layout::name) + " " + std::string(Layout::name) + "\n";
+        first = false;
+    });
+
+    source += "#else\n#error \"no VERTEX_FORMAT_* defined\"\n#endif\n";
+
+    const std::string outputs[] = { source, layouts };
+    for (int output = 0; output < 2; output++) {
+        std::ofstream file(argv[1 + output], std::ios::binary | std::ios::trunc);
+        file << outputs[output];
+
+        if (!file) {
+            std::cerr << "failed to write " << argv[1 + output] << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}